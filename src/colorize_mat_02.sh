@@ -1,7 +1,9 @@
 #!/bin/bash
 #
-#	@(#)	[MB] 	Version 1.1 du 23/07/08 - 
+#	@(#)	[MB] 	Version 1.2 du 24/08/08 - 
 #
 
 # ./matrix_02 15 10 | hl -e -3b '\([^)]+\)' -T1,0,30,60,90,100,120,140 '([0-9]+\.[0-9]+)'
-./matrix_02 15 10 | hl -e -2b '\([^)]+\)' -T1,0,30,60,90,100,120,140 '([0-9]+\.[0-9]+)'
+# ./matrix_02 15 10 | hl -e -2b '\([^)]+\)' -T1,0,30,60,90,100,120,140 '([0-9]+\.[0-9]+)'
+
+./matrix_02 --color 15 10
@@ -1,9 +1,11 @@
 #!/bin/bash
 #
-#	@(#)	[MB] 	Version 1.1 du 23/07/08 - 
+#	@(#)	[MB] 	Version 1.2 du 24/08/08 - 
 #
 
-./matrix_04 15 15 | hl -e		\
-	-3c '\( *([0-9]+), *(\1)\)'	\
-	-2b '\([^)]+\)'			\
-	-T1,0,30,60,90,100,120,140 '([0-9]+\.[0-9]+)'
+# ./matrix_04 15 15 | hl -e		\
+# 	-3c '\( *([0-9]+), *(\1)\)'	\
+# 	-2b '\([^)]+\)'			\
+# 	-T1,0,30,60,90,100,120,140 '([0-9]+\.[0-9]+)'
+
+./matrix_04 --color 15 15
@@ -0,0 +1,191 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_ansi.c Version 1.2 du 24/08/10 -
+ *
+ *   ANSI colored output of the matrix dumpers.
+ *
+ *   The items are colored as hl colors the output of the dumpers in the
+ *   colorize_mat_*.sh scripts : the padding of a number stays uncolored,
+ *   and only the numbers of the coordinates of a diagonal element get the
+ *   color of the diagonal. The buffer of the caller must hold at least
+ *   (FD_FMT_MAX_LEN + width + FD_ANSI_MAX_LEN + 8) characters.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "fd_format.h"
+#include "fd_ansi.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_ANSI_RESET       "\033[0m"
+#define   FD_ANSI_NB_COLORS   ((int) (sizeof(fd_ansi_sgr) / sizeof(fd_ansi_sgr[0])))
+
+// }}}
+// Global variables {{{
+/* Escape sequences of the colors, numbered as the letters of FD_ANSI_PALETTE
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static const char             *fd_ansi_sgr[] = {
+     "",
+     "",
+     "\033[34m",   "\033[36m",   "\033[32m",   "\033[33m",
+     "\033[31m",   "\033[35m",   "\033[37m",
+     "\033[1;34m", "\033[1;36m", "\033[1;32m", "\033[1;33m",
+     "\033[1;31m", "\033[1;35m", "\033[1;37m",
+};
+
+// }}}
+
+// fd_ansi_put() {{{
+/******************************************************************************
+
+                         FD_ANSI_PUT
+
+     Write len characters of text in the specified color, followed by the
+     reset sequence. Return the number of characters written.
+
+******************************************************************************/
+int fd_ansi_put(char *buf, const char *text, int len, int color)
+{
+     int                  _len = 0, _sgr;
+
+     if (color <= 1 || color >= FD_ANSI_NB_COLORS) {
+          memcpy(buf, text, len);
+          return len;
+     }
+
+     _sgr           = strlen(fd_ansi_sgr[color]);
+     memcpy(buf, fd_ansi_sgr[color], _sgr);
+     _len          += _sgr;
+     memcpy(buf + _len, text, len);
+     _len          += len;
+     memcpy(buf + _len, FD_ANSI_RESET, sizeof(FD_ANSI_RESET) - 1);
+     _len          += sizeof(FD_ANSI_RESET) - 1;
+
+     return _len;
+}
+
+// }}}
+// fd_ansi_number() {{{
+/******************************************************************************
+
+                         FD_ANSI_NUMBER
+
+     Write a padded number, its padding being uncolored.
+
+******************************************************************************/
+static int fd_ansi_number(char *buf, const char *text, int len, int color)
+{
+     int                  _pad;
+
+     _pad           = strspn(text, " ");
+     memcpy(buf, text, _pad);
+
+     return _pad + fd_ansi_put(buf + _pad, text + _pad, len - _pad, color);
+}
+
+// }}}
+// fd_ansi_coords() {{{
+/******************************************************************************
+
+                         FD_ANSI_COORDS
+
+     Write the coordinates "(i, j)" of an element, its numbers being padded
+     to width : the whole coordinates are in color, except on the diagonal,
+     where only their numbers are in diag_color.
+     Return the number of characters written.
+
+******************************************************************************/
+int fd_ansi_coords(char *buf, int64_t i, int64_t j, int width, int color, int diag_color)
+{
+     char                 _text[FD_FMT_MAX_LEN + 256];
+     int                  _len = 0, _l;
+
+     if (i != j || diag_color <= 1) {
+          _l             = 0;
+          _text[_l++]    = '(';
+          _l            += fd_fmt_int(_text + _l, i, width);
+          _text[_l++]    = ',';
+          _text[_l++]    = ' ';
+          _l            += fd_fmt_int(_text + _l, j, width);
+          _text[_l++]    = ')';
+
+          return fd_ansi_put(buf, _text, _l, color);
+     }
+
+     buf[_len++]    = '(';
+     _l             = fd_fmt_int(_text, i, width);
+     _len          += fd_ansi_number(buf + _len, _text, _l, diag_color);
+     buf[_len++]    = ',';
+     buf[_len++]    = ' ';
+     _l             = fd_fmt_int(_text, j, width);
+     _len          += fd_ansi_number(buf + _len, _text, _l, diag_color);
+     buf[_len++]    = ')';
+
+     return _len;
+}
+
+// }}}
+// fd_ansi_double() {{{
+/******************************************************************************
+
+                         FD_ANSI_DOUBLE
+
+     Write a value as "%*f", in the specified color.
+     Return the number of characters written.
+
+******************************************************************************/
+int fd_ansi_double(char *buf, double value, int width, int color)
+{
+     char                 _text[FD_FMT_MAX_LEN + 256];
+     int                  _l;
+
+     _l             = fd_fmt_double(_text, value, width, FD_FMT_PREC);
+
+     return fd_ansi_number(buf, _text, _l, color);
+}
+
+// }}}
+// fd_ansi_scale() {{{
+/******************************************************************************
+
+                         FD_ANSI_SCALE
+
+     Read the scale of the values given by the argument of --color : the
+     default scale if arg is NULL, the scale of a file if arg is "@file".
+     Return 0 if the scale is valid, -1 otherwise (errno being set).
+
+******************************************************************************/
+int fd_ansi_scale(fd_ref_scale scale, const char *arg)
+{
+     if (arg == NULL) {
+          arg            = FD_ANSI_SCALE;
+     }
+     if (*arg == '@') {
+          return fd_scale_load(scale, arg + 1, FD_ANSI_PALETTE);
+     }
+     if (fd_scale_parse(scale, arg, FD_ANSI_PALETTE) < 0) {
+          errno          = EINVAL;
+          return -1;
+     }
+
+     return 0;
+}
+
+// }}}
@@ -0,0 +1,59 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_ansi.h Version 1.2 du 24/08/10 -
+ *
+ *   ANSI colored output of the matrix dumpers.
+ */
+
+#ifndef FD_ANSI_H
+#define FD_ANSI_H
+
+// Includes {{{
+#include "fd_scale.h"
+
+// }}}
+// Macros definitions {{{
+/* Letters of the colors, as in the scales of fd_scale : '-' is the default
+   color, lowercase letters are normal colors, uppercase letters are bold
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ANSI_PALETTE     "-bcgyrmwBCGYRMW"
+
+/* Colors of fd_ansi_coords()
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ANSI_NONE        (0)
+#define   FD_ANSI_BLUE        (2)
+#define   FD_ANSI_BOLD_CYAN   (10)
+
+/* Scale of the values, as the thresholds passed to hl by the
+   colorize_mat_*.sh scripts
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ANSI_SCALE       "-,0,b,30,c,60,g,90,y,100,r,120,m,140,M"
+
+/* Maximum length of the escape sequences of a formatted item
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ANSI_MAX_LEN     (32)
+
+// }}}
+// Functions prototypes {{{
+int       fd_ansi_put(char *buf, const char *text, int len, int color);
+int       fd_ansi_coords(char *buf, int64_t i, int64_t j, int width, int color, int diag_color);
+int       fd_ansi_double(char *buf, double value, int width, int color);
+int       fd_ansi_scale(fd_ref_scale scale, const char *arg);
+
+// }}}
+
+#endif	/* FD_ANSI_H */
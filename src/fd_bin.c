@@ -0,0 +1,414 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_bin.c Version 1.1 du 24/08/10 -
+ *
+ *   Binary output of the matrix dumpers : matrix files and NPY files.
+ *
+ *   The values are written in their native representation, after a header
+ *   which is a multiple of 64 bytes : the lines stay aligned. When the
+ *   output is a regular file, it is extended to its final size and mapped,
+ *   and the threads compute the lines in place. Otherwise (pipe, terminal,
+ *   socket), the lines are computed into the chunks of fd_output_run(),
+ *   which writes them in order.
+ */
+
+#define   _GNU_SOURCE
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fd_elt.h"
+#include "fd_mmap.h"
+#include "fd_output.h"
+#include "fd_bin.h"
+
+// }}}
+// Macros definitions {{{
+/* Number of lines of a block computed in a mapped file, and maximum number
+   of threads
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_BIN_LINES        (64)
+#define   FD_BIN_MAX_THREADS  (256)
+
+/* Byte order of the NPY types
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define   FD_BIN_ORDER        ">"
+#else
+#define   FD_BIN_ORDER        "<"
+#endif
+
+// }}}
+// Structures definitions {{{
+struct fd_bin {
+     fd_bin_line          line;    // Computing function of the dumper
+     void                *data;    // Its data
+     int                  elt_type; // Type of the elements
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     size_t               stride;  // Size of a line (in bytes)
+     char                *dst;     // First element of a mapped file
+     int64_t              next;    // Next block of lines to compute
+};
+typedef struct fd_bin               fd_bin;
+typedef struct fd_bin              *fd_ref_bin;
+
+// }}}
+// Global variables {{{
+/* NPY types of the elements, indexed by FD_ELT_*
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static const char             *fd_bin_descr[FD_ELT_NB_TYPES] = {
+     [FD_ELT_INT8]       = "|i1",
+     [FD_ELT_INT16]      = FD_BIN_ORDER "i2",
+     [FD_ELT_INT32]      = FD_BIN_ORDER "i4",
+     [FD_ELT_FLOAT32]    = FD_BIN_ORDER "f4",
+     [FD_ELT_FLOAT64]    = FD_BIN_ORDER "f8",
+     [FD_ELT_COMPLEX128] = FD_BIN_ORDER "c16",
+};
+
+// }}}
+
+// fd_bin_format() {{{
+/******************************************************************************
+
+                         FD_BIN_FORMAT
+
+     Return the output format whose name is specified ("text", "raw" or
+     "npy"), -1 for an unknown name.
+
+******************************************************************************/
+int fd_bin_format(const char *name)
+{
+     if (strcmp(name, "text") == 0) {
+          return FD_BIN_TEXT;
+     }
+     if (strcmp(name, "raw") == 0) {
+          return FD_BIN_RAW;
+     }
+     if (strcmp(name, "npy") == 0) {
+          return FD_BIN_NPY;
+     }
+
+     return -1;
+}
+
+// }}}
+// fd_bin_fits() {{{
+/******************************************************************************
+
+                         FD_BIN_FITS
+
+     Return 1 if the integers from min to max are all exactly represented
+     by the specified type, 0 otherwise.
+
+******************************************************************************/
+int fd_bin_fits(int elt_type, double min, double max)
+{
+     double               _max;
+
+     switch (elt_type) {
+
+     case FD_ELT_INT8:
+          _max           = INT8_MAX;
+          break;
+
+     case FD_ELT_INT16:
+          _max           = INT16_MAX;
+          break;
+
+     case FD_ELT_INT32:
+          _max           = INT32_MAX;
+          break;
+
+     case FD_ELT_FLOAT32:
+          _max           = 1 << 24;
+          break;
+
+     default:
+          _max           = 1LL << 53;
+          break;
+     }
+
+     return min >= -_max && max <= _max;
+}
+
+// }}}
+// fd_bin_header() {{{
+/******************************************************************************
+
+                         FD_BIN_HEADER
+
+     Write the header of a binary output of n x p elements into buf, which
+     holds at least FD_BIN_MAX_HEADER bytes. Return the size of the header.
+
+******************************************************************************/
+int fd_bin_header(char *buf, int format, int elt_type, int64_t n, int64_t p)
+{
+     fd_mat_header        _hdr;
+     int                  _len;
+
+     memset(buf, 0, FD_BIN_MAX_HEADER);
+
+     if (format == FD_BIN_RAW) {
+          memset(&_hdr, 0, sizeof(_hdr));
+          memcpy(_hdr.magic, FD_MAT_MAGIC, sizeof(_hdr.magic));
+          _hdr.version   = FD_MAT_VERSION;
+          _hdr.elt_type  = elt_type;
+          _hdr.n         = n;
+          _hdr.p         = p;
+          _hdr.stride    = p * fd_elt_size(elt_type);
+          _hdr.offset    = FD_MAT_OFFSET;
+          _hdr.ready     = n;
+          memcpy(buf, &_hdr, sizeof(_hdr));
+
+          return FD_MAT_OFFSET;
+     }
+
+     /* NPY : magic string, version 1.0, length of the dictionary
+        (little endian), then the dictionary padded with spaces and
+        ended by a newline
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _len           = 10 + sprintf(buf + 10,
+                                   "{'descr': '%s', 'fortran_order': False, 'shape': (%lld, %lld), }",
+                                   fd_bin_descr[elt_type], (long long) n, (long long) p);
+     for ( ; (_len + 1) % 64 != 0; _len++) {
+          buf[_len]      = ' ';
+     }
+     buf[_len++]    = '\n';
+
+     memcpy(buf, "\x93NUMPY\x01\x00", 8);
+     buf[8]         = (_len - 10) & 0xFF;
+     buf[9]         = (_len - 10) >> 8;
+
+     return _len;
+}
+
+// }}}
+// fd_bin_thread() {{{
+/******************************************************************************
+
+                         FD_BIN_THREAD
+
+     Compute blocks of lines into a mapped file. Elements other than
+     doubles are computed in a line of doubles, then converted.
+
+******************************************************************************/
+static void *fd_bin_thread(void *arg)
+{
+     fd_ref_bin           _bin = arg;
+     double              *_line = NULL;
+     int64_t              _i, _i0;
+     char                *_dst;
+
+     if (_bin->elt_type != FD_ELT_FLOAT64
+     &&  (_line = malloc(_bin->p * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     while ((_i0 = __atomic_fetch_add(&_bin->next, FD_BIN_LINES, __ATOMIC_RELAXED)) < _bin->n) {
+          for (_i = _i0; _i < _i0 + FD_BIN_LINES && _i < _bin->n; _i++) {
+               _dst           = _bin->dst + (_i * _bin->stride);
+               if (_line == NULL) {
+                    _bin->line(_bin->data, (double *) _dst, _i + 1);
+               }
+               else {
+                    _bin->line(_bin->data, _line, _i + 1);
+                    fd_elt_from_double(_bin->elt_type, _line, _bin->p, _dst);
+               }
+          }
+     }
+
+     free(_line);
+
+     return NULL;
+}
+
+// }}}
+// fd_bin_lines() {{{
+/******************************************************************************
+
+                         FD_BIN_LINES
+
+     Compute lines i1 to i2 into a chunk of fd_output_run().
+
+******************************************************************************/
+static void fd_bin_lines(void *data, fd_ref_out_buf buf, int64_t i1, int64_t i2)
+{
+     fd_ref_bin           _bin = data;
+     double              *_line = NULL;
+     int64_t              _i;
+
+     if (_bin->elt_type != FD_ELT_FLOAT64
+     &&  (_line = malloc(_bin->p * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     FD_OUT_RESERVE(buf, (i2 - i1 + 1) * _bin->stride);
+     for (_i = i1; _i <= i2; _i++) {
+          if (_line == NULL) {
+               _bin->line(_bin->data, (double *) (buf->data + buf->len), _i);
+          }
+          else {
+               _bin->line(_bin->data, _line, _i);
+               fd_elt_from_double(_bin->elt_type, _line, _bin->p, buf->data + buf->len);
+          }
+          buf->len      += _bin->stride;
+     }
+
+     free(_line);
+}
+
+// }}}
+// fd_bin_mmap() {{{
+/******************************************************************************
+
+                         FD_BIN_MMAP
+
+     Write the output into the regular file open on fd, from its current
+     offset, through a shared mapping of the file.
+     Return 0, -1 on error (errno being set), or 1 if the file cannot be
+     mapped : the output must then be written by write().
+
+******************************************************************************/
+static int fd_bin_mmap(int fd, const char *hdr, int hdr_len, fd_ref_bin bin, int nb_threads)
+{
+     pthread_t            _threads[FD_BIN_MAX_THREADS];
+     char                 _path[64];
+     struct stat          _st;
+     off_t                _off;
+     size_t               _size;
+     char                *_base;
+     int                  _rw, _t, _flags;
+
+     if (fstat(fd, &_st) < 0 || !S_ISREG(_st.st_mode)
+     ||  (_flags = fcntl(fd, F_GETFL)) < 0 || (_flags & O_APPEND)
+     ||  (_off = lseek(fd, 0, SEEK_CUR)) < 0
+     ||  (_off + hdr_len) % sizeof(double) != 0) {
+          return 1;
+     }
+
+     /* Standard output is usually open write-only : a shared writable
+        mapping needs the file to be reopened for reading and writing
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     sprintf(_path, "/proc/self/fd/%d", fd);
+     if ((_rw = open(_path, O_RDWR)) < 0) {
+          return 1;
+     }
+
+     /* The blocks are allocated first : a full disk is reported here,
+        instead of a SIGBUS on the access to a page of the mapping
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _size          = _off + hdr_len + (bin->n * bin->stride);
+     if ((_size > (size_t) _off && fallocate(_rw, 0, _off, _size - _off) < 0
+          && errno != EOPNOTSUPP)
+     ||  ftruncate(_rw, _size) < 0) {
+          _t             = errno;
+          close(_rw);
+          errno          = _t;
+          return -1;
+     }
+
+     _base          = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _rw, 0);
+     close(_rw);
+     if (_base == MAP_FAILED) {
+          return 1;
+     }
+
+     memcpy(_base + _off, hdr, hdr_len);
+     bin->dst       = _base + _off + hdr_len;
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          if (pthread_create(&_threads[_t], NULL, fd_bin_thread, bin) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+     for (_t = 0; _t < nb_threads; _t++) {
+          pthread_join(_threads[_t], NULL);
+     }
+
+     munmap(_base, _size);
+     lseek(fd, _size, SEEK_SET);
+
+     return 0;
+}
+
+// }}}
+// fd_bin_run() {{{
+/******************************************************************************
+
+                         FD_BIN_RUN
+
+     Write a matrix of n x p elements of the specified type to fd, in a
+     binary format, its lines being computed by line() with nb_threads
+     threads.
+     Return 0, or -1 on a write error (errno being set).
+
+******************************************************************************/
+int fd_bin_run(int fd, int format, int elt_type, int64_t n, int64_t p,
+               fd_bin_line line, void *data, int nb_threads)
+{
+     fd_bin               _bin;
+     char                 _hdr[FD_BIN_MAX_HEADER];
+     ssize_t              _len;
+     int                  _hdr_len, _ret, _off;
+
+     if (nb_threads < 1) {
+          nb_threads     = 1;
+     }
+     if (nb_threads > FD_BIN_MAX_THREADS) {
+          nb_threads     = FD_BIN_MAX_THREADS;
+     }
+
+     _bin.line      = line;
+     _bin.data      = data;
+     _bin.elt_type  = elt_type;
+     _bin.n         = n;
+     _bin.p         = p;
+     _bin.stride    = p * fd_elt_size(elt_type);
+     _bin.dst       = NULL;
+     _bin.next      = 0;
+
+     _hdr_len       = fd_bin_header(_hdr, format, elt_type, n, p);
+
+     if ((_ret = fd_bin_mmap(fd, _hdr, _hdr_len, &_bin, nb_threads)) <= 0) {
+          return _ret;
+     }
+
+     for (_off = 0; _off < _hdr_len; _off += _len) {
+          if ((_len = write(fd, _hdr + _off, _hdr_len - _off)) < 0) {
+               if (errno == EINTR) {
+                    _len           = 0;
+                    continue;
+               }
+               return -1;
+          }
+     }
+
+     return fd_output_run(fd, n, _bin.stride, fd_bin_lines, &_bin, nb_threads);
+}
+
+// }}}
@@ -0,0 +1,56 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_bin.h Version 1.1 du 24/08/10 -
+ *
+ *   Binary output of the matrix dumpers : matrix files and NPY files.
+ */
+
+#ifndef FD_BIN_H
+#define FD_BIN_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Macros definitions {{{
+/* Output formats of the dumpers
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_BIN_TEXT         (0)
+#define   FD_BIN_RAW          (1)       // Matrix file, see fd_mmap.h
+#define   FD_BIN_NPY          (2)       // NumPy file, version 1.0
+
+/* Maximum size of a header
+   ~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_BIN_MAX_HEADER   (128)
+
+// }}}
+// Structures definitions {{{
+/* Compute the p values of line i of the matrix (from 1) into dst
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+typedef void            (*fd_bin_line)(void *data, double *dst, int64_t i);
+
+// }}}
+// Functions prototypes {{{
+int       fd_bin_format(const char *name);
+int       fd_bin_fits(int elt_type, double min, double max);
+int       fd_bin_header(char *buf, int format, int elt_type, int64_t n, int64_t p);
+int       fd_bin_run(int fd, int format, int elt_type, int64_t n, int64_t p,
+                     fd_bin_line line, void *data, int nb_threads);
+
+// }}}
+
+#endif	/* FD_BIN_H */
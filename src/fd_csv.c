@@ -0,0 +1,325 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_csv.c Version 1.2 du 24/08/10 - 
+ *
+ *   Parsing of CSV / TSV matrices.
+ *
+ *   The input is not NUL terminated (it is usually a mapped file) : all
+ *   the functions receive the address of the end of the text.
+ */
+
+// Includes {{{
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fd_csv.h"
+
+// }}}
+// Macros definitions {{{
+/* Limits of the exact conversion (mantissa < 2^53, |exponent| <= 22)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CSV_MAX_MANT     (1ULL << 53)
+#define   FD_CSV_MAX_EXP      (22)
+
+/* Maximum number of significant digits kept in the mantissa
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CSV_MAX_DIGITS   (19)
+
+/* Maximum length of a number given to strtod()
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CSV_MAX_LEN      (512)
+
+#define   FD_IS_DIGIT(c)      ((unsigned) ((c) - '0') < 10)
+
+// }}}
+// Global variables {{{
+static const double            fd_csv_pow10[FD_CSV_MAX_EXP + 1] = {
+     1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// }}}
+
+// fd_csv_parse_double() {{{
+/******************************************************************************
+
+                         FD_CSV_PARSE_DOUBLE
+
+     Convert the number at str, like strtod() in the "C" locale, and set
+     *stop to the first character after the number (or to str if there is
+     no number : the result is then NaN).
+
+     Decimal numbers with at most 19 significant digits, a mantissa below
+     2^53 and a decimal exponent in [-22, 22] are exactly converted with a
+     single multiplication or division (Clinger's fast path). The other
+     numbers, and the special values, are given to strtod().
+
+******************************************************************************/
+double fd_csv_parse_double(const char *str, const char *end, const char **stop)
+{
+     const char      *_ptr = str, *_start;
+     uint64_t         _mant = 0;
+     int              _neg = 0, _nb_digits = 0, _exp = 0, _exp_val = 0,
+                      _exp_neg = 0, _any = 0;
+     char             _buf[FD_CSV_MAX_LEN + 1];
+     char            *_end;
+     double           _value;
+
+     /* Skip leading blanks
+        ~~~~~~~~~~~~~~~~~~~ */
+     while (_ptr < end && (*_ptr == ' ')) {
+          _ptr++;
+     }
+     _start         = _ptr;
+
+     if (_ptr < end && (*_ptr == '-' || *_ptr == '+')) {
+          _neg           = (*_ptr == '-');
+          _ptr++;
+     }
+
+     /* Integer part
+        ~~~~~~~~~~~~ */
+     for ( ; _ptr < end && FD_IS_DIGIT(*_ptr); _ptr++) {
+          _any           = 1;
+          if (_nb_digits < FD_CSV_MAX_DIGITS) {
+               _mant          = (_mant * 10) + (*_ptr - '0');
+               if (_mant != 0) {
+                    _nb_digits++;
+               }
+          }
+          else {
+               _exp++;
+               _nb_digits++;
+          }
+     }
+
+     if (_ptr < end && (*_ptr == 'x' || *_ptr == 'X')) {
+          goto slow;                              // Hexadecimal number
+     }
+
+     /* Fractional part
+        ~~~~~~~~~~~~~~~ */
+     if (_ptr < end && *_ptr == '.') {
+          for (_ptr++; _ptr < end && FD_IS_DIGIT(*_ptr); _ptr++) {
+               _any           = 1;
+               if (_nb_digits < FD_CSV_MAX_DIGITS) {
+                    _mant          = (_mant * 10) + (*_ptr - '0');
+                    _exp--;
+                    if (_mant != 0) {
+                         _nb_digits++;
+                    }
+               }
+               else {
+                    _nb_digits++;
+               }
+          }
+     }
+
+     if (!_any) {
+          goto slow;
+     }
+
+     /* Exponent
+        ~~~~~~~~ */
+     if (_ptr < end && (*_ptr == 'e' || *_ptr == 'E')) {
+          const char          *_e = _ptr + 1;
+
+          if (_e < end && (*_e == '-' || *_e == '+')) {
+               _exp_neg       = (*_e == '-');
+               _e++;
+          }
+          if (_e < end && FD_IS_DIGIT(*_e)) {
+               for ( ; _e < end && FD_IS_DIGIT(*_e); _e++) {
+                    if (_exp_val < 100000) {
+                         _exp_val       = (_exp_val * 10) + (*_e - '0');
+                    }
+               }
+               _exp          += _exp_neg ? -_exp_val : _exp_val;
+               _ptr           = _e;
+          }
+     }
+
+     /* Exact conversion
+        ~~~~~~~~~~~~~~~~ */
+     if (_nb_digits <= FD_CSV_MAX_DIGITS && _mant < FD_CSV_MAX_MANT
+     &&  -FD_CSV_MAX_EXP <= _exp && _exp <= FD_CSV_MAX_EXP) {
+          _value         = (double) _mant;
+          if (_exp < 0) {
+               _value        /= fd_csv_pow10[-_exp];
+          }
+          else {
+               _value        *= fd_csv_pow10[_exp];
+          }
+          *stop          = _ptr;
+
+          return _neg ? -_value : _value;
+     }
+
+slow:
+     /* Other numbers : NUL terminated copy for strtod()
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     {
+          size_t          _len;
+
+          for (_ptr = _start; _ptr < end && _ptr - _start < FD_CSV_MAX_LEN
+                              && *_ptr != '\n' && *_ptr != ','
+                              && *_ptr != '\t' && *_ptr != ';'; _ptr++) {
+               ;
+          }
+          _len           = _ptr - _start;
+          memcpy(_buf, _start, _len);
+          _buf[_len]     = 0;
+
+          _value         = strtod(_buf, &_end);
+          if (_end == _buf) {
+               *stop          = str;
+               return NAN;
+          }
+          *stop          = _start + (_end - _buf);
+     }
+
+     return _value;
+}
+
+// }}}
+// fd_csv_next_line() {{{
+/******************************************************************************
+
+                         FD_CSV_NEXT_LINE
+
+     Return the address of the beginning of the next line.
+
+******************************************************************************/
+const char *fd_csv_next_line(const char *str, const char *end)
+{
+     const char      *_nl;
+
+     if ((_nl = memchr(str, '\n', end - str)) == NULL) {
+          return end;
+     }
+
+     return _nl + 1;
+}
+
+// }}}
+// fd_csv_count_lines() {{{
+/******************************************************************************
+
+                         FD_CSV_COUNT_LINES
+
+     Return the number of lines of a text (a last line without a newline
+     is counted).
+
+******************************************************************************/
+int64_t fd_csv_count_lines(const char *str, const char *end)
+{
+     int64_t         _nb = 0;
+
+     while (str < end) {
+          str            = fd_csv_next_line(str, end);
+          _nb++;
+     }
+
+     return _nb;
+}
+
+// }}}
+// fd_csv_trim_end() {{{
+/******************************************************************************
+
+                         FD_CSV_TRIM_END
+
+     Return the end of the text without its trailing empty lines (and the
+     newline of its last line), so that they are neither counted nor
+     parsed as lines of NaN.
+
+******************************************************************************/
+const char *fd_csv_trim_end(const char *str, const char *end)
+{
+     while (end > str && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ')) {
+          end--;
+     }
+
+     return end;
+}
+
+// }}}
+// fd_csv_count_fields() {{{
+/******************************************************************************
+
+                         FD_CSV_COUNT_FIELDS
+
+     Return the number of fields of the line at str.
+
+******************************************************************************/
+int64_t fd_csv_count_fields(const char *str, const char *end, char delim)
+{
+     int64_t         _nb = 1;
+
+     for ( ; str < end && *str != '\n' && *str != '\r'; str++) {
+          if (*str == delim) {
+               _nb++;
+          }
+     }
+
+     return _nb;
+}
+
+// }}}
+// fd_csv_parse_line() {{{
+/******************************************************************************
+
+                         FD_CSV_PARSE_LINE
+
+     Convert the first p fields of the line at str into values. Fields may
+     be surrounded by double quotes ; missing or invalid fields are NaN.
+     Return the address of the beginning of the next line.
+
+******************************************************************************/
+const char *fd_csv_parse_line(const char *str, const char *end, char delim,
+                              double *values, int64_t p)
+{
+     const char      *_eol, *_stop;
+     int64_t          _j;
+
+     _eol           = fd_csv_next_line(str, end);
+
+     for (_j = 0; _j < p; _j++) {
+          if (str >= _eol || *str == '\n' || *str == '\r') {
+               values[_j]     = NAN;
+               continue;
+          }
+
+          if (*str == '"') {
+               str++;
+          }
+          values[_j]     = fd_csv_parse_double(str, _eol, &_stop);
+
+          /* Skip the rest of the field
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          for (str = _stop; str < _eol && *str != delim && *str != '\n'; str++) {
+               ;
+          }
+          if (str < _eol && *str == delim) {
+               str++;
+          }
+     }
+
+     return _eol;
+}
+
+// }}}
@@ -0,0 +1,41 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_csv.h Version 1.2 du 24/08/10 - 
+ *
+ *   Parsing of CSV / TSV matrices.
+ */
+
+#ifndef FD_CSV_H
+#define FD_CSV_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Functions prototypes {{{
+double         fd_csv_parse_double(const char *str, const char *end,
+                                   const char **stop);
+const char    *fd_csv_next_line(const char *str, const char *end);
+int64_t        fd_csv_count_lines(const char *str, const char *end);
+const char    *fd_csv_trim_end(const char *str, const char *end);
+int64_t        fd_csv_count_fields(const char *str, const char *end, char delim);
+const char    *fd_csv_parse_line(const char *str, const char *end, char delim,
+                                 double *values, int64_t p);
+
+// }}}
+
+#endif	/* FD_CSV_H */
@@ -0,0 +1,383 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_csv_import.c Version 1.2 du 24/08/10 - 
+ *
+ *   Import of a CSV / TSV matrix into a binary matrix file for rectangle.
+ *
+ *   The input is mapped and split into chunks on line boundaries. The
+ *   lines of the chunks are first counted in parallel, which gives the
+ *   dimensions of the matrix and the first line of each chunk ; then the
+ *   chunks are parsed in parallel, in the order of the file, directly into
+ *   the mapped output file. The number of leading lines already written is
+ *   kept up to date in the header, so that rectangle can display the first
+ *   lines while the rest of the file is parsed.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fd_csv.h"
+#include "fd_mmap.h"
+
+// }}}
+// Macros definitions {{{
+/* Chunks size (in bytes) and minimum number of chunks per thread
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CHUNK_SIZE       (4 * 1024 * 1024)
+#define   FD_CHUNKS_PER_THR   (4)
+
+/* Maximum number of threads
+   ~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_MAX_THREADS      (256)
+
+// }}}
+// Structures definitions {{{
+struct fd_chunk {
+     const char          *start;   // First character
+     const char          *end;     // Character following the last one
+     int64_t              first;   // Index of the first line (from 0)
+     int64_t              nb;      // Number of lines
+     int                  done;    // Lines are written
+};
+typedef struct fd_chunk             fd_chunk;
+typedef struct fd_chunk            *fd_ref_chunk;
+
+struct fd_import {
+     char                 delim;   // Fields delimiter
+     int                  elt_type; // Type of the elements of the output
+     int64_t              p;       // Matrix columns number
+     fd_chunk            *chunks;  // Chunks of the input
+     int                  nb_chunks;
+     int                  next;    // Next chunk to process
+     int                  ready;   // Number of leading chunks written
+     fd_mmap              out;     // Output file
+     pthread_mutex_t      lock;
+};
+typedef struct fd_import            fd_import;
+typedef struct fd_import           *fd_ref_import;
+
+// }}}
+
+// fd_count_thread() {{{
+/******************************************************************************
+
+                         FD_COUNT_THREAD
+
+     Count the lines of the chunks.
+
+******************************************************************************/
+void *fd_count_thread(void *arg)
+{
+     fd_ref_import   _import = arg;
+     fd_ref_chunk    _chunk;
+     int             _k;
+
+     while ((_k = __atomic_fetch_add(&_import->next, 1, __ATOMIC_RELAXED))
+            < _import->nb_chunks) {
+          _chunk         = &_import->chunks[_k];
+          _chunk->nb     = fd_csv_count_lines(_chunk->start, _chunk->end);
+     }
+
+     return NULL;
+}
+
+// }}}
+// fd_parse_thread() {{{
+/******************************************************************************
+
+                         FD_PARSE_THREAD
+
+     Parse the lines of the chunks into the output file, in the order of
+     the file.
+
+******************************************************************************/
+void *fd_parse_thread(void *arg)
+{
+     fd_ref_import   _import = arg;
+     fd_ref_chunk    _chunk;
+     fd_ref_mmap     _out;
+     const char     *_ptr;
+     double         *_line = NULL;
+     int64_t         _i;
+     int             _k;
+
+     _out           = &_import->out;
+
+     /* Elements other than doubles are parsed in a line of doubles, then
+        converted into the output file
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (_import->elt_type != FD_ELT_FLOAT64
+     &&  (_line = malloc(_import->p * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     while ((_k = __atomic_fetch_add(&_import->next, 1, __ATOMIC_RELAXED))
+            < _import->nb_chunks) {
+          _chunk         = &_import->chunks[_k];
+
+          _ptr           = _chunk->start;
+          for (_i = _chunk->first; _i < _chunk->first + _chunk->nb; _i++) {
+               if (_line == NULL) {
+                    _ptr           = fd_csv_parse_line(_ptr, _chunk->end, _import->delim,
+                                                       (double *) (_out->data + (_i * _out->stride)),
+                                                       _import->p);
+               }
+               else {
+                    _ptr           = fd_csv_parse_line(_ptr, _chunk->end, _import->delim,
+                                                       _line, _import->p);
+                    fd_elt_from_double(_import->elt_type, _line, _import->p,
+                                       _out->data + (_i * _out->stride));
+               }
+          }
+
+          /* Publish the leading lines already written
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          pthread_mutex_lock(&_import->lock);
+          _chunk->done   = 1;
+          while (_import->ready < _import->nb_chunks
+          &&     _import->chunks[_import->ready].done) {
+               _import->ready++;
+          }
+          if (_import->ready > 0) {
+               _chunk         = &_import->chunks[_import->ready - 1];
+               fd_mmap_set_ready(_out, _chunk->first + _chunk->nb);
+          }
+          pthread_mutex_unlock(&_import->lock);
+     }
+
+     free(_line);
+
+     return NULL;
+}
+
+// }}}
+// fd_run_threads() {{{
+/******************************************************************************
+
+                         FD_RUN_THREADS
+
+     Run a function on nb_threads threads, and wait for their end.
+
+******************************************************************************/
+void fd_run_threads(fd_ref_import import, int nb_threads, void *(*fct)(void *))
+{
+     pthread_t       _threads[FD_MAX_THREADS];
+     int             _t;
+
+     import->next   = 0;
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          if (pthread_create(&_threads[_t], NULL, fct, import) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          pthread_join(_threads[_t], NULL);
+     }
+}
+
+// }}}
+// fd_usage() {{{
+/******************************************************************************
+
+                              FD_USAGE
+
+******************************************************************************/
+void fd_usage(char *progname)
+{
+     fprintf(stderr, "Usage: %s [-t threads] [-d delim] [-e type] input output\n", progname);
+     fprintf(stderr, "  -t : number of threads (default : number of processors)\n");
+     fprintf(stderr, "  -d : fields delimiter (default : tab, ';' or ',' from the first line)\n");
+     fprintf(stderr, "  -e : type of the elements : int8, int16, int32, float32, float64\n");
+     fprintf(stderr, "       or complex128 (default : float64)\n");
+     exit(1);
+}
+
+// }}}
+// main() {{{
+/******************************************************************************
+
+                              MAIN
+
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+     int                  _opt, _nb_threads, _k, _fd;
+     fd_import            _import;
+     struct stat          _st;
+     struct timespec      _t0, _t1;
+     const char          *_text, *_end, *_ptr, *_stop, *_eol;
+     size_t               _size;
+     int64_t              _n;
+     double               _elapsed;
+
+     memset(&_import, 0, sizeof(_import));
+     _nb_threads         = sysconf(_SC_NPROCESSORS_ONLN);
+     _import.elt_type    = FD_ELT_FLOAT64;
+
+     /* Check command arguments
+        ~~~~~~~~~~~~~~~~~~~~~~~ */
+     while ((_opt = getopt(argc, argv, "t:d:e:")) != -1) {
+          switch (_opt) {
+
+          case 't':
+               _nb_threads    = atoi(optarg);
+               break;
+
+          case 'd':
+               _import.delim  = (strcmp(optarg, "\\t") == 0) ? '\t' : optarg[0];
+               break;
+
+          case 'e':
+               if ((_import.elt_type = fd_elt_type(optarg)) == 0) {
+                    fprintf(stderr, "%s: %s: unknown type !\n", argv[0], optarg);
+                    exit(1);
+               }
+               break;
+
+          default:
+               fd_usage(argv[0]);
+               break;
+          }
+     }
+
+     if (argc - optind != 2) {
+          fd_usage(argv[0]);
+     }
+
+     if (_nb_threads < 1) {
+          _nb_threads    = 1;
+     }
+     if (_nb_threads > FD_MAX_THREADS) {
+          _nb_threads    = FD_MAX_THREADS;
+     }
+
+     clock_gettime(CLOCK_MONOTONIC, &_t0);
+
+     /* Map the input file
+        ~~~~~~~~~~~~~~~~~~ */
+     if ((_fd = open(argv[optind], O_RDONLY)) < 0 || fstat(_fd, &_st) < 0) {
+          fprintf(stderr, "%s: %s: %s\n", argv[0], argv[optind], strerror(errno));
+          exit(1);
+     }
+     if ((_size = _st.st_size) == 0) {
+          fprintf(stderr, "%s: %s: empty file !\n", argv[0], argv[optind]);
+          exit(1);
+     }
+     if ((_text = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0)) == MAP_FAILED) {
+          fprintf(stderr, "%s: %s: %s\n", argv[0], argv[optind], strerror(errno));
+          exit(1);
+     }
+     madvise((void *) _text, _size, MADV_SEQUENTIAL);
+     _end                = fd_csv_trim_end(_text, _text + _size);
+
+     /* Guess the delimiter from the first line
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _eol                = fd_csv_next_line(_text, _end);
+     if (_import.delim == 0) {
+          if (memchr(_text, '\t', _eol - _text) != NULL) {
+               _import.delim  = '\t';
+          }
+          else if (memchr(_text, ';', _eol - _text) != NULL) {
+               _import.delim  = ';';
+          }
+          else {
+               _import.delim  = ',';
+          }
+     }
+     _import.p           = fd_csv_count_fields(_text, _eol, _import.delim);
+
+     /* Skip a header line (whose first field is not a number)
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _ptr                = (*_text == '"') ? _text + 1 : _text;
+     fd_csv_parse_double(_ptr, _eol, &_stop);
+     if (_stop == _ptr && *_ptr != _import.delim && *_ptr != '\n' && *_ptr != '\r') {
+          _text               = _eol;
+     }
+
+     /* Split the input into chunks on lines boundaries
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _size               = _end - _text;
+     _import.nb_chunks   = _size / FD_CHUNK_SIZE;
+     if (_import.nb_chunks < _nb_threads * FD_CHUNKS_PER_THR) {
+          _import.nb_chunks   = _nb_threads * FD_CHUNKS_PER_THR;
+     }
+     if (_import.nb_chunks > _size) {
+          _import.nb_chunks   = (_size > 0) ? _size : 1;
+     }
+     if ((_import.chunks = calloc(_import.nb_chunks, sizeof(fd_chunk))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     _ptr                = _text;
+     for (_k = 0; _k < _import.nb_chunks; _k++) {
+          _import.chunks[_k].start = _ptr;
+          if (_k == _import.nb_chunks - 1) {
+               _ptr                = _end;
+          }
+          else if (_ptr < _text + ((_size / _import.nb_chunks) * (_k + 1))) {
+               _ptr                = fd_csv_next_line(_text + ((_size / _import.nb_chunks) * (_k + 1)) - 1, _end);
+          }
+          _import.chunks[_k].end   = _ptr;
+     }
+
+     /* Count the lines
+        ~~~~~~~~~~~~~~~ */
+     fd_run_threads(&_import, _nb_threads, fd_count_thread);
+
+     for (_k = 0, _n = 0; _k < _import.nb_chunks; _k++) {
+          _import.chunks[_k].first = _n;
+          _n                      += _import.chunks[_k].nb;
+     }
+
+     /* Create the output file
+        ~~~~~~~~~~~~~~~~~~~~~~ */
+     if (fd_mmap_create(&_import.out, argv[optind + 1], _n, _import.p, _import.elt_type, 0) < 0) {
+          fprintf(stderr, "%s: %s: %s\n", argv[0], argv[optind + 1], strerror(errno));
+          exit(1);
+     }
+
+     /* Parse the lines
+        ~~~~~~~~~~~~~~~ */
+     pthread_mutex_init(&_import.lock, NULL);
+     fd_run_threads(&_import, _nb_threads, fd_parse_thread);
+
+     fd_mmap_close(&_import.out);
+
+     clock_gettime(CLOCK_MONOTONIC, &_t1);
+     _elapsed            = (_t1.tv_sec - _t0.tv_sec) + (_t1.tv_nsec - _t0.tv_nsec) / 1e9;
+
+     fprintf(stderr, "%s: %ld lines x %ld columns, %.1f MB in %.3f s (%.1f MB/s, %d threads)\n",
+             argv[0], (long) _n, (long) _import.p, _st.st_size / 1e6, _elapsed,
+             _st.st_size / 1e6 / _elapsed, _nb_threads);
+
+     return 0;
+}
+
+// }}}
@@ -0,0 +1,680 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_ctile.c Version 1.2 du 24/08/10 -
+ *
+ *   In-memory matrices stored in compressed tiles.
+ *
+ *   The matrix is cut in FD_TILE_SIZE x FD_TILE_SIZE tiles, each of them
+ *   compressed separately, without loss :
+ *   - integer tiles (8, 16 or 32 bits) : differences with the left (or
+ *     upper) neighbour, zigzag encoded and bit-packed with one width per
+ *     line of the tile ;
+ *   - floating point tiles (float or double) : exclusive or of consecutive
+ *     elements, whose meaningful bits only are kept (as in the Gorilla time
+ *     series database).
+ *   Complex matrices cannot be compressed. Only the tiles displayed and the tiles next to them are decompressed,
+ *   in a small set of hot tiles where the least recently used one is
+ *   replaced.
+ */
+
+// Includes {{{
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "fd_ctile.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(a, b)        ((a) < (b) ? (a) : (b))
+
+/* Integer types are compressed as 32 bits integers, floating point types
+   as doubles : both are restored exactly
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CTILE_IS_INT(type)    ((type) == FD_ELT_INT8  || (type) == FD_ELT_INT16 \
+                                ||  (type) == FD_ELT_INT32)
+
+/* Maximum size of a compressed tile : each double may need 2 + 5 + 6
+   control bits and 64 bits of value
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CTILE_MAX_SIZE   ((FD_TILE_ELTS * 77 + 7) / 8 + 8)
+
+// }}}
+// Structures definitions {{{
+struct fd_bits {
+     uint8_t             *buf;     // Buffer
+     uint32_t             size;    // Size of the buffer (for reading)
+     uint32_t             pos;     // Index of the next byte
+     uint64_t             acc;     // Pending bits
+     int                  nb;      // Number of pending bits
+};
+typedef struct fd_bits              fd_bits;
+typedef struct fd_bits             *fd_ref_bits;
+
+// }}}
+
+// fd_bits_put() {{{
+/******************************************************************************
+
+                         FD_BITS_PUT
+
+     Write the nb (<= 32) low order bits of value.
+
+******************************************************************************/
+static inline void fd_bits_put(fd_ref_bits bits, uint64_t value, int nb)
+{
+     if (nb == 0) {
+          return;
+     }
+
+     bits->acc      |= (value & (((uint64_t) 1 << nb) - 1)) << bits->nb;
+     bits->nb       += nb;
+     while (bits->nb >= 8) {
+          bits->buf[bits->pos++]   = (uint8_t) bits->acc;
+          bits->acc    >>= 8;
+          bits->nb      -= 8;
+     }
+}
+
+// }}}
+// fd_bits_put64() {{{
+/******************************************************************************
+
+                         FD_BITS_PUT64
+
+     Write the nb (<= 64) low order bits of value.
+
+******************************************************************************/
+static inline void fd_bits_put64(fd_ref_bits bits, uint64_t value, int nb)
+{
+     if (nb > 32) {
+          fd_bits_put(bits, value, 32);
+          fd_bits_put(bits, value >> 32, nb - 32);
+     }
+     else {
+          fd_bits_put(bits, value, nb);
+     }
+}
+
+// }}}
+// fd_bits_flush() {{{
+/******************************************************************************
+
+                         FD_BITS_FLUSH
+
+     Write the pending bits and return the number of bytes written.
+
+******************************************************************************/
+static uint32_t fd_bits_flush(fd_ref_bits bits)
+{
+     if (bits->nb > 0) {
+          bits->buf[bits->pos++]   = (uint8_t) bits->acc;
+          bits->acc      = 0;
+          bits->nb       = 0;
+     }
+
+     return bits->pos;
+}
+
+// }}}
+// fd_bits_get() {{{
+/******************************************************************************
+
+                         FD_BITS_GET
+
+     Read nb (<= 32) bits.
+
+******************************************************************************/
+static inline uint64_t fd_bits_get(fd_ref_bits bits, int nb)
+{
+     uint64_t        _value;
+
+     if (nb == 0) {
+          return 0;
+     }
+
+     while (bits->nb < nb) {
+          if (bits->pos < bits->size) {
+               bits->acc     |= (uint64_t) bits->buf[bits->pos++] << bits->nb;
+          }
+          bits->nb      += 8;
+     }
+
+     _value         = bits->acc & (((uint64_t) 1 << nb) - 1);
+     bits->acc    >>= nb;
+     bits->nb      -= nb;
+
+     return _value;
+}
+
+// }}}
+// fd_bits_get64() {{{
+/******************************************************************************
+
+                         FD_BITS_GET64
+
+     Read nb (<= 64) bits.
+
+******************************************************************************/
+static inline uint64_t fd_bits_get64(fd_ref_bits bits, int nb)
+{
+     uint64_t        _low;
+
+     if (nb > 32) {
+          _low           = fd_bits_get(bits, 32);
+          return _low | (fd_bits_get(bits, nb - 32) << 32);
+     }
+
+     return fd_bits_get(bits, nb);
+}
+
+// }}}
+// fd_ctile_pack_ints() {{{
+/******************************************************************************
+
+                         FD_CTILE_PACK_INTS
+
+     Compress the elements of an integer tile. The first element of a line
+     is compared to the first element of the previous line, the other ones
+     to their left neighbour. The differences are computed modulo 2^32, so
+     that any sequence of 32 bits integers is restored exactly.
+
+******************************************************************************/
+static void fd_ctile_pack_ints(fd_ref_bits bits, const int32_t *elts)
+{
+     uint32_t        _zz[FD_TILE_SIZE], _first = 0, _prev, _max, _delta;
+     int             _l, _k, _width;
+
+     for (_l = 0; _l < FD_TILE_SIZE; _l++) {
+          _max           = 0;
+          _prev          = _first;
+          for (_k = 0; _k < FD_TILE_SIZE; _k++) {
+               _delta         = (uint32_t) elts[(_l << FD_TILE_SHIFT) + _k] - _prev;
+               _prev         += _delta;
+               _zz[_k]        = (_delta << 1) ^ (uint32_t) ((int32_t) _delta >> 31);
+               _max          |= _zz[_k];
+               if (_k == 0) {
+                    _first         = _prev;
+               }
+          }
+
+          _width         = _max == 0 ? 0 : 32 - __builtin_clz(_max);
+          fd_bits_put(bits, _width, 6);
+          for (_k = 0; _k < FD_TILE_SIZE; _k++) {
+               fd_bits_put(bits, _zz[_k], _width);
+          }
+     }
+}
+
+// }}}
+// fd_ctile_unpack_ints() {{{
+/******************************************************************************
+
+                         FD_CTILE_UNPACK_INTS
+
+     Decompress the elements of an integer tile.
+
+******************************************************************************/
+static void fd_ctile_unpack_ints(fd_ref_bits bits, double *elts)
+{
+     uint32_t        _first = 0, _prev, _zz;
+     int             _l, _k, _width;
+
+     for (_l = 0; _l < FD_TILE_SIZE; _l++) {
+          _width         = fd_bits_get(bits, 6);
+          _prev          = _first;
+          for (_k = 0; _k < FD_TILE_SIZE; _k++) {
+               _zz            = fd_bits_get(bits, _width);
+               _prev         += (_zz >> 1) ^ -(_zz & 1);
+               elts[(_l << FD_TILE_SHIFT) + _k]   = (int32_t) _prev;
+               if (_k == 0) {
+                    _first         = _prev;
+               }
+          }
+     }
+}
+
+// }}}
+// fd_ctile_pack_doubles() {{{
+/******************************************************************************
+
+                         FD_CTILE_PACK_DOUBLES
+
+     Compress the elements of a floating point tile. Each element is
+     replaced by the exclusive or of its bits with those of the previous
+     one, which is :
+     - '0' if it is null ;
+     - '10' followed by its meaningful bits, when they fit in the window of
+       meaningful bits of the previous element ;
+     - '11', the number of leading zeros (5 bits), the number of meaningful
+       bits minus one (6 bits) and the meaningful bits otherwise.
+
+******************************************************************************/
+static void fd_ctile_pack_doubles(fd_ref_bits bits, const double *elts)
+{
+     uint64_t        _prev = 0, _cur, _xor;
+     int             _k, _lead, _trail, _prev_lead = -1, _prev_trail = 0, _len;
+
+     for (_k = 0; _k < FD_TILE_ELTS; _k++) {
+          memcpy(&_cur, &elts[_k], sizeof(_cur));
+          _xor           = _cur ^ _prev;
+          _prev          = _cur;
+
+          if (_xor == 0) {
+               fd_bits_put(bits, 0, 1);
+               continue;
+          }
+
+          _lead          = FD_MIN(__builtin_clzll(_xor), 31);
+          _trail         = __builtin_ctzll(_xor);
+
+          if (_prev_lead >= 0 && _lead >= _prev_lead && _trail >= _prev_trail) {
+               fd_bits_put(bits, 1, 2);
+               fd_bits_put64(bits, _xor >> _prev_trail, 64 - _prev_lead - _prev_trail);
+          }
+          else {
+               _len           = 64 - _lead - _trail;
+               fd_bits_put(bits, 3, 2);
+               fd_bits_put(bits, _lead, 5);
+               fd_bits_put(bits, _len - 1, 6);
+               fd_bits_put64(bits, _xor >> _trail, _len);
+               _prev_lead     = _lead;
+               _prev_trail    = _trail;
+          }
+     }
+}
+
+// }}}
+// fd_ctile_unpack_doubles() {{{
+/******************************************************************************
+
+                         FD_CTILE_UNPACK_DOUBLES
+
+     Decompress the elements of a floating point tile.
+
+******************************************************************************/
+static void fd_ctile_unpack_doubles(fd_ref_bits bits, double *elts)
+{
+     uint64_t        _prev = 0;
+     int             _k, _lead = 0, _trail = 0, _len;
+
+     for (_k = 0; _k < FD_TILE_ELTS; _k++) {
+          if (fd_bits_get(bits, 1) != 0) {
+               if (fd_bits_get(bits, 1) != 0) {
+                    _lead          = fd_bits_get(bits, 5);
+                    _len           = fd_bits_get(bits, 6) + 1;
+                    _trail         = 64 - _lead - _len;
+               }
+               _prev         ^= fd_bits_get64(bits, 64 - _lead - _trail) << _trail;
+          }
+          memcpy(&elts[_k], &_prev, sizeof(_prev));
+     }
+}
+
+// }}}
+// fd_ctile_band() {{{
+/******************************************************************************
+
+                         FD_CTILE_BAND
+
+     Advise the kernel about the use of the lines of the file of the band
+     of tiles starting at line i.
+
+******************************************************************************/
+static void fd_ctile_band(fd_ref_mmap map, int64_t i, int advice)
+{
+     uintptr_t       _page, _start, _end;
+     int64_t         _last;
+
+     _last          = FD_MIN(i + FD_TILE_SIZE - 1, map->n);
+     _page          = sysconf(_SC_PAGESIZE);
+     _start         = (uintptr_t) (map->data + ((i - 1) * map->stride));
+     _end           = (uintptr_t) (map->data + (_last * map->stride));
+     _start        &= ~(_page - 1);
+
+     /* Do not discard the pages of the next band
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (advice == MADV_DONTNEED) {
+          _end          &= ~(_page - 1);
+     }
+     if (_end > _start) {
+          madvise((void *) _start, _end - _start, advice);
+     }
+}
+
+// }}}
+// fd_ctile_load() {{{
+/******************************************************************************
+
+                         FD_CTILE_LOAD
+
+     Compress the matrix of a matrix file, one band of tiles at a time, so
+     that the file itself does not need to fit in memory. Only the lines
+     already written in the file are copied, the other ones are null.
+     Return 0, or -1 with errno set.
+
+******************************************************************************/
+int fd_ctile_load(fd_ref_ctiled ctiled, fd_ref_mmap map)
+{
+     int64_t              _ti, _tj, _i, _j, _k, _l, _m, _nb_i, _nb_n, _nb_j, _ready;
+     char                *_line;
+     fd_bits              _bits;
+     fd_ref_ctile         _tile;
+     double               _doubles[FD_TILE_ELTS];
+     int32_t              _ints[FD_TILE_ELTS];
+
+     ctiled->n      = map->n;
+     ctiled->p      = map->p;
+     ctiled->tn     = (map->n + FD_TILE_MASK) >> FD_TILE_SHIFT;
+     ctiled->tp     = (map->p + FD_TILE_MASK) >> FD_TILE_SHIFT;
+     ctiled->elt_type = map->elt_type;
+     ctiled->elt_size = map->elt_size;
+     ctiled->clock  = 0;
+     ctiled->size   = 0;
+     ctiled->misses = 0;
+     ctiled->hot    = NULL;
+     ctiled->tiles  = NULL;
+     _bits.buf      = NULL;
+
+     if (map->elt_type == FD_ELT_COMPLEX128) {
+          errno          = EINVAL;
+          return -1;
+     }
+
+     if ((ctiled->tiles = calloc(ctiled->tn * ctiled->tp, sizeof(*ctiled->tiles))) == NULL
+     ||  (ctiled->hot   = malloc(FD_CTILE_HOT * sizeof(*ctiled->hot))) == NULL
+     ||  (_bits.buf     = malloc(FD_CTILE_MAX_SIZE)) == NULL) {
+          goto error;
+     }
+
+     for (_k = 0; _k < FD_CTILE_HOT; _k++) {
+          ctiled->hot[_k].idx      = -1;
+          ctiled->hot[_k].stamp    = 0;
+     }
+
+     _ready         = fd_mmap_ready(map);
+
+     for (_ti = 0; _ti < ctiled->tn; _ti++) {
+          _i             = (_ti << FD_TILE_SHIFT) + 1;
+          _nb_i          = FD_MIN(FD_TILE_SIZE, _ready - _i + 1);
+          _nb_n          = FD_MIN(FD_TILE_SIZE, map->n - _i + 1);
+          fd_ctile_band(map, _i, MADV_WILLNEED);
+
+          for (_tj = 0; _tj < ctiled->tp; _tj++) {
+               _j             = (_tj << FD_TILE_SHIFT) + 1;
+               _nb_j          = FD_MIN(FD_TILE_SIZE, map->p - _j + 1);
+
+               memset(_doubles, 0, sizeof(_doubles));
+               memset(_ints, 0, sizeof(_ints));
+               for (_l = 0; _l < _nb_i; _l++) {
+                    _line          = map->data + ((_i + _l - 1) * map->stride)
+                                               + ((_j - 1) * map->elt_size);
+                    fd_elt_to_double(map->elt_type, _line, _nb_j,
+                                     &_doubles[_l << FD_TILE_SHIFT]);
+                    for (_k = 0; _k < _nb_j; _k++) {
+                         _ints[(_l << FD_TILE_SHIFT) + _k]  = _doubles[(_l << FD_TILE_SHIFT) + _k];
+                    }
+               }
+
+               /* Pad the tiles of the borders by repeating the last
+                  element of the lines and the last line of the matrix,
+                  which costs almost nothing once compressed : the lines
+                  not written yet stay null
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               for (_l = 0; _l < FD_TILE_SIZE; _l++) {
+                    for (_k = (_l < _nb_i ? _nb_j : 0); _k < FD_TILE_SIZE; _k++) {
+                         _m             = (_l < _nb_i) ? (_l << FD_TILE_SHIFT) + _nb_j - 1
+                                        : (_l >= _nb_n && _nb_i == _nb_n && _nb_i > 0)
+                                        ? ((_nb_i - 1) << FD_TILE_SHIFT) + _k
+                                        : -1;
+                         if (_m >= 0) {
+                              _ints[(_l << FD_TILE_SHIFT) + _k]       = _ints[_m];
+                              _doubles[(_l << FD_TILE_SHIFT) + _k]    = _doubles[_m];
+                         }
+                    }
+               }
+
+               _bits.pos      = 0;
+               _bits.acc      = 0;
+               _bits.nb       = 0;
+               if (FD_CTILE_IS_INT(map->elt_type)) {
+                    fd_ctile_pack_ints(&_bits, _ints);
+               }
+               else {
+                    fd_ctile_pack_doubles(&_bits, _doubles);
+               }
+
+               _tile          = &ctiled->tiles[(_ti * ctiled->tp) + _tj];
+               _tile->size    = fd_bits_flush(&_bits);
+               _tile->hot     = -1;
+
+               /* Incompressible tiles are stored as they are
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (_tile->size >= FD_TILE_ELTS * map->elt_size) {
+                    _tile->size    = FD_TILE_ELTS * map->elt_size;
+                    fd_elt_from_double(map->elt_type, _doubles, FD_TILE_ELTS, _bits.buf);
+               }
+
+               if ((_tile->buf = malloc(_tile->size)) == NULL) {
+                    goto error;
+               }
+               memcpy(_tile->buf, _bits.buf, _tile->size);
+               ctiled->size  += _tile->size;
+          }
+
+          fd_ctile_band(map, _i, MADV_DONTNEED);
+     }
+
+     free(_bits.buf);
+     return 0;
+
+error:
+     free(_bits.buf);
+     fd_ctile_free(ctiled);
+     errno          = ENOMEM;
+     return -1;
+}
+
+// }}}
+// fd_ctile_get() {{{
+/******************************************************************************
+
+                         FD_CTILE_GET
+
+     Return the decompressed elements of tile (ti, tj), decompressing it in
+     place of the least recently used hot tile if needed.
+
+******************************************************************************/
+static double *fd_ctile_get(fd_ref_ctiled ctiled, int64_t ti, int64_t tj)
+{
+     fd_ref_ctile         _tile;
+     fd_ref_hot_tile      _hot;
+     fd_bits              _bits;
+     int                  _k, _lru;
+
+     _tile          = &ctiled->tiles[(ti * ctiled->tp) + tj];
+
+     if (_tile->hot < 0) {
+          /* Search the least recently used hot tile
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          for (_k = 1, _lru = 0; _k < FD_CTILE_HOT; _k++) {
+               if (ctiled->hot[_k].stamp < ctiled->hot[_lru].stamp) {
+                    _lru           = _k;
+               }
+          }
+
+          _hot           = &ctiled->hot[_lru];
+          if (_hot->idx >= 0) {
+               ctiled->tiles[_hot->idx].hot  = -1;
+          }
+          _hot->idx      = (ti * ctiled->tp) + tj;
+          _tile->hot     = _lru;
+
+          _bits.buf      = _tile->buf;
+          _bits.size     = _tile->size;
+          _bits.pos      = 0;
+          _bits.acc      = 0;
+          _bits.nb       = 0;
+          if (_tile->size == FD_TILE_ELTS * ctiled->elt_size) {
+               fd_elt_to_double(ctiled->elt_type, _tile->buf, FD_TILE_ELTS, _hot->data);
+          }
+          else if (FD_CTILE_IS_INT(ctiled->elt_type)) {
+               fd_ctile_unpack_ints(&_bits, _hot->data);
+          }
+          else {
+               fd_ctile_unpack_doubles(&_bits, _hot->data);
+          }
+          ctiled->misses++;
+     }
+
+     _hot           = &ctiled->hot[_tile->hot];
+     _hot->stamp    = ++ctiled->clock;
+
+     return _hot->data;
+}
+
+// }}}
+// fd_ctile_value() {{{
+/******************************************************************************
+
+                         FD_CTILE_VALUE
+
+     Return the value of element (i, j), numbered from 1.
+     Elements outside of the matrix are null.
+
+******************************************************************************/
+double fd_ctile_value(fd_ref_ctiled ctiled, int64_t i, int64_t j)
+{
+     double              *_data;
+
+     if (i < 1 || i > ctiled->n || j < 1 || j > ctiled->p) {
+          return 0.0;
+     }
+
+     i--;
+     j--;
+     _data          = fd_ctile_get(ctiled, i >> FD_TILE_SHIFT, j >> FD_TILE_SHIFT);
+
+     return _data[((i & FD_TILE_MASK) << FD_TILE_SHIFT) + (j & FD_TILE_MASK)];
+}
+
+// }}}
+// fd_ctile_fill_row() {{{
+/******************************************************************************
+
+                         FD_CTILE_FILL_ROW
+
+     Copy the dx elements of line i starting at column j0 into elts, at
+     their native width.
+
+******************************************************************************/
+void fd_ctile_fill_row(fd_ref_ctiled ctiled, int64_t i, int64_t j0, int64_t dx,
+                       void *elts)
+{
+     int64_t         _k, _j, _nb;
+     double         *_data;
+     char           *_dst = elts;
+
+     if (i < 1 || i > ctiled->n) {
+          memset(_dst, 0, dx * ctiled->elt_size);
+          return;
+     }
+
+     for (_k = 0, _j = j0; _k < dx; _k += _nb, _j += _nb) {
+          if (_j < 1 || _j > ctiled->p) {
+               memset(_dst + (_k * ctiled->elt_size), 0, ctiled->elt_size);
+               _nb            = 1;
+               continue;
+          }
+
+          _nb            = FD_MIN(dx - _k, FD_TILE_SIZE - ((_j - 1) & FD_TILE_MASK));
+          _nb            = FD_MIN(_nb, ctiled->p - _j + 1);
+          _data          = fd_ctile_get(ctiled, (i - 1) >> FD_TILE_SHIFT,
+                                        (_j - 1) >> FD_TILE_SHIFT);
+          fd_elt_from_double(ctiled->elt_type,
+                             _data + (((i - 1) & FD_TILE_MASK) << FD_TILE_SHIFT)
+                                   + ((_j - 1) & FD_TILE_MASK),
+                             _nb, _dst + (_k * ctiled->elt_size));
+     }
+}
+
+// }}}
+// fd_ctile_prefetch() {{{
+/******************************************************************************
+
+                         FD_CTILE_PREFETCH
+
+     Decompress the tiles of the dy x dx elements next to the viewport
+     whose upper left element is (i0, j0), in the direction (di, dj) of the
+     last move. Called while waiting for the next key, so that the next
+     move in the same direction finds its tiles already decompressed.
+
+******************************************************************************/
+void fd_ctile_prefetch(fd_ref_ctiled ctiled, int64_t i0, int64_t j0, int64_t dy,
+                       int64_t dx, int di, int dj)
+{
+     int64_t         _i1, _i2, _j1, _j2, _ti, _tj;
+
+     if (di == 0 && dj == 0) {
+          return;
+     }
+
+     _i1            = i0 + (di * dy);
+     _j1            = j0 + (dj * dx);
+     _i2            = _i1 + dy - 1;
+     _j2            = _j1 + dx - 1;
+
+     /* Clip the area to the matrix
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (_i1 < 1)             _i1  = 1;
+     if (_j1 < 1)             _j1  = 1;
+     if (_i2 > ctiled->n)     _i2  = ctiled->n;
+     if (_j2 > ctiled->p)     _j2  = ctiled->p;
+
+     for (_ti = (_i1 - 1) >> FD_TILE_SHIFT; _ti <= (_i2 - 1) >> FD_TILE_SHIFT; _ti++) {
+          for (_tj = (_j1 - 1) >> FD_TILE_SHIFT; _tj <= (_j2 - 1) >> FD_TILE_SHIFT; _tj++) {
+               fd_ctile_get(ctiled, _ti, _tj);
+          }
+     }
+}
+
+// }}}
+// fd_ctile_free() {{{
+/******************************************************************************
+
+                         FD_CTILE_FREE
+
+     Free the compressed and the decompressed tiles.
+
+******************************************************************************/
+void fd_ctile_free(fd_ref_ctiled ctiled)
+{
+     int64_t         _k;
+
+     if (ctiled->tiles != NULL) {
+          for (_k = 0; _k < ctiled->tn * ctiled->tp; _k++) {
+               free(ctiled->tiles[_k].buf);
+          }
+     }
+     free(ctiled->tiles);
+     free(ctiled->hot);
+     ctiled->tiles  = NULL;
+     ctiled->hot    = NULL;
+}
+
+// }}}
@@ -0,0 +1,88 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_ctile.h Version 1.1 du 24/07/29 -
+ *
+ *   In-memory matrices stored in compressed tiles.
+ */
+
+#ifndef FD_CTILE_H
+#define FD_CTILE_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_mmap.h"
+#include "fd_tiled.h"
+
+// }}}
+// Macros definitions {{{
+/* Number of decompressed tiles kept in memory (32 KB each)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CTILE_HOT        (64)
+
+// }}}
+// Structures definitions {{{
+/* Compressed tile : the FD_TILE_SIZE x FD_TILE_SIZE elements of the tile
+ * (padded at the borders of the matrix) are encoded in row-major order in
+ * size bytes, or stored as they are when they cannot be compressed.
+ */
+struct fd_ctile {
+     uint8_t             *buf;     // Compressed elements
+     uint32_t             size;    // Size of the compressed elements
+     int32_t              hot;     // Index of the hot tile (or -1)
+};
+typedef struct fd_ctile             fd_ctile;
+typedef struct fd_ctile            *fd_ref_ctile;
+
+/* Decompressed tile
+   ~~~~~~~~~~~~~~~~~ */
+struct fd_hot_tile {
+     int64_t              idx;     // Index of the tile in the grid (or -1)
+     uint64_t             stamp;   // Time of the last use
+     double               data[FD_TILE_ELTS];
+};
+typedef struct fd_hot_tile          fd_hot_tile;
+typedef struct fd_hot_tile         *fd_ref_hot_tile;
+
+struct fd_ctiled {
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int64_t              tn;      // Number of lines of the grid of tiles
+     int64_t              tp;      // Number of columns of the grid of tiles
+     int                  elt_type; // Type of the elements
+     int                  elt_size; // Size of an element (in bytes)
+     fd_ref_ctile         tiles;   // Compressed tiles (row-major grid)
+     fd_ref_hot_tile      hot;     // Decompressed tiles (FD_CTILE_HOT)
+     uint64_t             clock;   // Time of the last use of a tile
+     uint64_t             size;    // Total size of the compressed tiles
+     uint64_t             misses;  // Number of decompressions
+};
+typedef struct fd_ctiled            fd_ctiled;
+typedef struct fd_ctiled           *fd_ref_ctiled;
+
+// }}}
+// Functions prototypes {{{
+int       fd_ctile_load(fd_ref_ctiled ctiled, fd_ref_mmap map);
+double    fd_ctile_value(fd_ref_ctiled ctiled, int64_t i, int64_t j);
+void      fd_ctile_fill_row(fd_ref_ctiled ctiled, int64_t i, int64_t j0, int64_t dx,
+                            void *elts);
+void      fd_ctile_prefetch(fd_ref_ctiled ctiled, int64_t i0, int64_t j0, int64_t dy,
+                            int64_t dx, int di, int dj);
+void      fd_ctile_free(fd_ref_ctiled ctiled);
+
+// }}}
+
+#endif	/* FD_CTILE_H */
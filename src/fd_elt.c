@@ -0,0 +1,246 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_elt.c Version 1.1 du 24/07/30 -
+ *
+ *   Types of the matrix elements.
+ *
+ *   Matrices are stored with their elements at their native width. The
+ *   conversions from and to doubles are generated for each type, so that
+ *   converting a line costs one loop with no test on the type.
+ */
+
+// Includes {{{
+#include <string.h>
+#include <math.h>
+#include "fd_elt.h"
+
+// }}}
+// Macros definitions {{{
+/* Conversions of an integer type : doubles are truncated and clamped to
+   the range of the type, NaN becomes 0
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ELT_INT_CONV(suffix, type, min, max)                          \
+static void fd_elt_to_double_##suffix(const void *src, int64_t nb, double *dst)   \
+{                                                                          \
+     const type     *_src = src;                                           \
+     int64_t         _k;                                                   \
+                                                                           \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          dst[_k]        = _src[_k];                                       \
+     }                                                                     \
+}                                                                          \
+                                                                           \
+static void fd_elt_from_double_##suffix(const double *src, int64_t nb, void *dst) \
+{                                                                          \
+     type           *_dst = dst;                                           \
+     int64_t         _k;                                                   \
+                                                                           \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          _dst[_k]       = isnan(src[_k]) ? 0                              \
+                         : src[_k] <= (min) ? (min)                        \
+                         : src[_k] >= (max) ? (max)                        \
+                         : (type) src[_k];                                 \
+     }                                                                     \
+}
+
+/* Conversions of a floating point type
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ELT_FLOAT_CONV(suffix, type)                                  \
+static void fd_elt_to_double_##suffix(const void *src, int64_t nb, double *dst)   \
+{                                                                          \
+     const type     *_src = src;                                           \
+     int64_t         _k;                                                   \
+                                                                           \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          dst[_k]        = _src[_k];                                       \
+     }                                                                     \
+}                                                                          \
+                                                                           \
+static void fd_elt_from_double_##suffix(const double *src, int64_t nb, void *dst) \
+{                                                                          \
+     type           *_dst = dst;                                           \
+     int64_t         _k;                                                   \
+                                                                           \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          _dst[_k]       = src[_k];                                        \
+     }                                                                     \
+}
+
+/* Entry of the table of the types
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ELT_DESC(code, suffix, type)                                  \
+     [code]    = { sizeof(type), #suffix,                                  \
+                   fd_elt_to_double_##suffix, fd_elt_from_double_##suffix },
+
+// }}}
+// Structures definitions {{{
+struct fd_elt_desc {
+     int                  size;    // Size of an element (0 : unknown type)
+     char                *name;    // Name of the type
+     void               (*to_double)(const void *, int64_t, double *);
+     void               (*from_double)(const double *, int64_t, void *);
+};
+typedef struct fd_elt_desc          fd_elt_desc;
+typedef struct fd_elt_desc         *fd_ref_elt_desc;
+
+// }}}
+
+FD_ELT_INT_CONV(int8,  int8_t,  INT8_MIN,  INT8_MAX)
+FD_ELT_INT_CONV(int16, int16_t, INT16_MIN, INT16_MAX)
+FD_ELT_INT_CONV(int32, int32_t, INT32_MIN, INT32_MAX)
+FD_ELT_FLOAT_CONV(float32, float)
+FD_ELT_FLOAT_CONV(float64, double)
+
+// fd_elt_to_double_complex128() {{{
+/******************************************************************************
+
+                         FD_ELT_TO_DOUBLE_COMPLEX128
+
+     Only the real parts of complex elements are kept.
+
+******************************************************************************/
+static void fd_elt_to_double_complex128(const void *src, int64_t nb, double *dst)
+{
+     const double complex     *_src = src;
+     int64_t                   _k;
+
+     for (_k = 0; _k < nb; _k++) {
+          dst[_k]        = creal(_src[_k]);
+     }
+}
+
+// }}}
+// fd_elt_from_double_complex128() {{{
+/******************************************************************************
+
+                         FD_ELT_FROM_DOUBLE_COMPLEX128
+
+******************************************************************************/
+static void fd_elt_from_double_complex128(const double *src, int64_t nb, void *dst)
+{
+     double complex           *_dst = dst;
+     int64_t                   _k;
+
+     for (_k = 0; _k < nb; _k++) {
+          _dst[_k]       = src[_k];
+     }
+}
+
+// }}}
+// Global variables {{{
+static fd_elt_desc                  fd_elt_descs[FD_ELT_NB_TYPES] = {
+     FD_ELT_FOREACH(FD_ELT_DESC)
+};
+
+// }}}
+
+// fd_elt_size() {{{
+/******************************************************************************
+
+                         FD_ELT_SIZE
+
+     Return the size of an element of the specified type, 0 for an unknown
+     type.
+
+******************************************************************************/
+int fd_elt_size(int elt_type)
+{
+     if (elt_type < 0 || elt_type >= FD_ELT_NB_TYPES) {
+          return 0;
+     }
+
+     return fd_elt_descs[elt_type].size;
+}
+
+// }}}
+// fd_elt_name() {{{
+/******************************************************************************
+
+                         FD_ELT_NAME
+
+     Return the name of a type, NULL for an unknown type.
+
+******************************************************************************/
+const char *fd_elt_name(int elt_type)
+{
+     if (fd_elt_size(elt_type) == 0) {
+          return NULL;
+     }
+
+     return fd_elt_descs[elt_type].name;
+}
+
+// }}}
+// fd_elt_type() {{{
+/******************************************************************************
+
+                         FD_ELT_TYPE
+
+     Return the type whose name is specified, 0 for an unknown name.
+
+******************************************************************************/
+int fd_elt_type(const char *name)
+{
+     int             _type;
+
+     for (_type = 0; _type < FD_ELT_NB_TYPES; _type++) {
+          if (fd_elt_descs[_type].size != 0 && strcmp(fd_elt_descs[_type].name, name) == 0) {
+               return _type;
+          }
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_elt_to_double() {{{
+/******************************************************************************
+
+                         FD_ELT_TO_DOUBLE
+
+     Convert nb elements of the specified type into doubles.
+
+******************************************************************************/
+void fd_elt_to_double(int elt_type, const void *src, int64_t nb, double *dst)
+{
+     if (fd_elt_size(elt_type) == 0) {
+          memset(dst, 0, nb * sizeof(double));
+          return;
+     }
+
+     fd_elt_descs[elt_type].to_double(src, nb, dst);
+}
+
+// }}}
+// fd_elt_from_double() {{{
+/******************************************************************************
+
+                         FD_ELT_FROM_DOUBLE
+
+     Convert nb doubles into elements of the specified type.
+
+******************************************************************************/
+void fd_elt_from_double(int elt_type, const double *src, int64_t nb, void *dst)
+{
+     if (fd_elt_size(elt_type) == 0) {
+          return;
+     }
+
+     fd_elt_descs[elt_type].from_double(src, nb, dst);
+}
+
+// }}}
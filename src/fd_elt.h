@@ -0,0 +1,67 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_elt.h Version 1.1 du 24/07/30 -
+ *
+ *   Types of the matrix elements.
+ */
+
+#ifndef FD_ELT_H
+#define FD_ELT_H
+
+// Includes {{{
+#include <stdint.h>
+#include <complex.h>
+
+// }}}
+// Macros definitions {{{
+/* Element types (the codes are stored in the matrix files)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ELT_INT32        (1)
+#define   FD_ELT_FLOAT64      (2)
+#define   FD_ELT_INT8         (3)
+#define   FD_ELT_INT16        (4)
+#define   FD_ELT_FLOAT32      (5)
+#define   FD_ELT_COMPLEX128   (6)
+
+#define   FD_ELT_NB_TYPES     (7)
+
+/* Size of the largest element (in bytes)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ELT_MAX_SIZE     (16)
+
+/* Expand X(code, suffix, type) for each element type, to generate code
+ * specialized for each of them
+ */
+#define   FD_ELT_FOREACH(X)                                                \
+     X(FD_ELT_INT8,       int8,       int8_t)                              \
+     X(FD_ELT_INT16,      int16,      int16_t)                             \
+     X(FD_ELT_INT32,      int32,      int32_t)                             \
+     X(FD_ELT_FLOAT32,    float32,    float)                               \
+     X(FD_ELT_FLOAT64,    float64,    double)                              \
+     X(FD_ELT_COMPLEX128, complex128, double complex)
+
+// }}}
+// Functions prototypes {{{
+int       fd_elt_size(int elt_type);
+const char *fd_elt_name(int elt_type);
+int       fd_elt_type(const char *name);
+void      fd_elt_to_double(int elt_type, const void *src, int64_t nb, double *dst);
+void      fd_elt_from_double(int elt_type, const double *src, int64_t nb, void *dst);
+
+// }}}
+
+#endif	/* FD_ELT_H */
@@ -0,0 +1,810 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_expr.c Version 1.2 du 24/08/02 -
+ *
+ *   Formulas generating the elements of a matrix.
+ *
+ *   A formula uses the line number i, the column number j (both numbered
+ *   from 1), the dimensions n and p of the matrix, and :
+ *        numbers, pi
+ *        + - * / % ^ (power), unary - and !
+ *        < <= > >= == != && || (true is 1, false is 0)
+ *        c ? a : b
+ *        abs() sqrt() sin() cos() exp() log() floor() min() max()
+ *
+ *   Example : (n - abs(i - j)) * 10
+ *
+ *   The formula is compiled into register instructions. Along a line only
+ *   j changes : each instruction depending on j is applied to a whole batch
+ *   of elements in a loop the compiler can vectorize, and the others are
+ *   computed once per line or once and for all.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include "fd_expr.h"
+#include "fd_simd.h"
+
+// }}}
+// Macros definitions {{{
+/* Dependency of a register
+   ~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_KIND_CONST       (0)
+#define   FD_KIND_ROW         (1)
+#define   FD_KIND_VAR         (2)
+
+/* Registers of the variables
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_REG_I            (0)
+#define   FD_REG_J            (1)
+
+/* Operations : X(name, value of the operation on a, b and c)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_EXPR_OPS(X)                                                   \
+     X(ADD,    a + b)                                                      \
+     X(SUB,    a - b)                                                      \
+     X(MUL,    a * b)                                                      \
+     X(DIV,    a / b)                                                      \
+     X(MOD,    fmod(a, b))                                                 \
+     X(POW,    pow(a, b))                                                  \
+     X(NEG,    -a)                                                         \
+     X(NOT,    (double) (a == 0))                                          \
+     X(LT,     (double) (a <  b))                                          \
+     X(LE,     (double) (a <= b))                                          \
+     X(GT,     (double) (a >  b))                                          \
+     X(GE,     (double) (a >= b))                                          \
+     X(EQ,     (double) (a == b))                                          \
+     X(NE,     (double) (a != b))                                          \
+     X(AND,    (double) ((a != 0) & (b != 0)))                             \
+     X(OR,     (double) ((a != 0) | (b != 0)))                             \
+     X(SEL,    a != 0 ? b : c)                                             \
+     X(ABS,    fabs(a))                                                    \
+     X(SQRT,   sqrt(a))                                                    \
+     X(SIN,    sin(a))                                                     \
+     X(COS,    cos(a))                                                     \
+     X(EXP,    exp(a))                                                     \
+     X(LOG,    log(a))                                                     \
+     X(FLOOR,  floor(a))                                                   \
+     X(MIN,    a < b ? a : b)                                              \
+     X(MAX,    a > b ? a : b)
+
+#define   FD_EXPR_ENUM(name, value)     FD_OP_##name,
+
+// }}}
+// Structures definitions {{{
+enum fd_op {
+     FD_EXPR_OPS(FD_EXPR_ENUM)
+};
+
+struct fd_func {
+     const char          *name;    // Name of the function
+     int                  op;      // Operation
+     int                  nb_args; // Number of arguments
+};
+typedef struct fd_func              fd_func;
+typedef struct fd_func             *fd_ref_func;
+
+struct fd_parser {
+     fd_ref_expr          expr;    // Compiled formula
+     const char          *text;    // Formula
+     const char          *ptr;     // Current character
+};
+typedef struct fd_parser            fd_parser;
+typedef struct fd_parser           *fd_ref_parser;
+
+// }}}
+// Global variables {{{
+static fd_func                      fd_funcs[] = {
+     { "abs",       FD_OP_ABS,     1 },
+     { "sqrt",      FD_OP_SQRT,    1 },
+     { "sin",       FD_OP_SIN,     1 },
+     { "cos",       FD_OP_COS,     1 },
+     { "exp",       FD_OP_EXP,     1 },
+     { "log",       FD_OP_LOG,     1 },
+     { "floor",     FD_OP_FLOOR,   1 },
+     { "min",       FD_OP_MIN,     2 },
+     { "max",       FD_OP_MAX,     2 },
+     { NULL,        0,             0 }
+};
+
+// }}}
+
+static int fd_parse_cond(fd_ref_parser parser);
+
+// fd_expr_op() {{{
+/******************************************************************************
+
+                         FD_EXPR_OP
+
+     Apply an operation to scalars.
+
+******************************************************************************/
+static double fd_expr_op(int op, double a, double b, double c)
+{
+#define   FD_EXPR_SCALAR(name, value)                                      \
+     case FD_OP_##name:                                                    \
+          return value;
+
+     switch (op) {
+
+     FD_EXPR_OPS(FD_EXPR_SCALAR)
+
+     default:
+          return 0.0;
+     }
+
+#undef    FD_EXPR_SCALAR
+}
+
+// }}}
+// fd_expr_vec() {{{
+/******************************************************************************
+
+                         FD_EXPR_VEC
+
+     Apply an operation to vectors of FD_EXPR_BATCH elements : the constant
+     number of iterations lets the compiler vectorize the loops. The
+     function is compiled once per instruction set (see fd_simd.h), and
+     fd_expr_vec_init() selects the version the processor supports. Each
+     operation being a single IEEE operation, all versions give the same
+     results.
+
+******************************************************************************/
+#define   FD_EXPR_VEC_DEF(fct, attr)                                       \
+static attr void fct(int op, double *restrict dst, const double *restrict va, \
+                     const double *restrict vb, const double *restrict vc) \
+{                                                                          \
+     int             _k;                                                   \
+                                                                           \
+     switch (op) {                                                         \
+                                                                           \
+     FD_EXPR_OPS(FD_EXPR_VECTOR)                                           \
+                                                                           \
+     default:                                                              \
+          break;                                                           \
+     }                                                                     \
+}
+
+#define   FD_EXPR_VECTOR(name, value)                                      \
+     case FD_OP_##name:                                                    \
+          for (_k = 0; _k < FD_EXPR_BATCH; _k++) {                         \
+               double a = va[_k], b = vb[_k], c = vc[_k];                  \
+               (void) b; (void) c;                                         \
+               dst[_k]        = value;                                     \
+          }                                                                \
+          break;
+
+FD_EXPR_VEC_DEF(fd_expr_vec_scalar, __attribute__((optimize("no-tree-vectorize"))))
+FD_EXPR_VEC_DEF(fd_expr_vec_sse2, )
+#if defined(__x86_64__) || defined(__i386__)
+FD_EXPR_VEC_DEF(fd_expr_vec_avx2, __attribute__((target("avx2"))))
+FD_EXPR_VEC_DEF(fd_expr_vec_avx512, __attribute__((target("avx512f"))))
+#endif
+
+#undef    FD_EXPR_VECTOR
+#undef    FD_EXPR_VEC_DEF
+
+static void                       (*fd_expr_vec)(int, double *restrict, const double *restrict,
+                                                 const double *restrict,
+                                                 const double *restrict) = fd_expr_vec_sse2;
+
+// }}}
+// fd_expr_vec_init() {{{
+/******************************************************************************
+
+                         FD_EXPR_VEC_INIT
+
+******************************************************************************/
+static __attribute__((constructor)) void fd_expr_vec_init(void)
+{
+     switch (fd_simd_level()) {
+
+     case FD_SIMD_SCALAR:
+          fd_expr_vec    = fd_expr_vec_scalar;
+          break;
+
+#if defined(__x86_64__) || defined(__i386__)
+     case FD_SIMD_AVX2:
+          fd_expr_vec    = fd_expr_vec_avx2;
+          break;
+
+     case FD_SIMD_AVX512:
+          fd_expr_vec    = fd_expr_vec_avx512;
+          break;
+#endif
+
+     default:
+          fd_expr_vec    = fd_expr_vec_sse2;
+          break;
+     }
+}
+
+// }}}
+// fd_parse_error() {{{
+/******************************************************************************
+
+                         FD_PARSE_ERROR
+
+******************************************************************************/
+static int fd_parse_error(fd_ref_parser parser, const char *msg)
+{
+     if (parser->expr->err_msg == NULL) {
+          parser->expr->err_pos    = parser->ptr - parser->text;
+          parser->expr->err_msg    = msg;
+     }
+
+     return -1;
+}
+
+// }}}
+// fd_new_reg() {{{
+/******************************************************************************
+
+                         FD_NEW_REG
+
+     Allocate a register. Return its index, or -1 on error.
+
+******************************************************************************/
+static int fd_new_reg(fd_ref_parser parser, int kind, double value)
+{
+     fd_ref_expr     _expr = parser->expr;
+
+     if (_expr->nb_regs >= FD_EXPR_MAX_REGS) {
+          return fd_parse_error(parser, "formula too complex");
+     }
+
+     _expr->kind[_expr->nb_regs]   = kind;
+     _expr->value[_expr->nb_regs]  = value;
+
+     return _expr->nb_regs++;
+}
+
+// }}}
+// fd_emit() {{{
+/******************************************************************************
+
+                         FD_EMIT
+
+     Compile reg[dst] = op(reg[a], reg[b], reg[c]), into the program of the
+     most variable of its operands (unused operands are equal to a). An
+     operation on constants is computed at once. Return the index of dst,
+     or -1 on error.
+
+******************************************************************************/
+static int fd_emit(fd_ref_parser parser, int op, int a, int b, int c)
+{
+     fd_ref_expr     _expr = parser->expr;
+     fd_ref_instr    _instr;
+     int             _kind, _dst;
+
+     if (a < 0 || b < 0 || c < 0) {
+          return -1;
+     }
+
+     _kind          = _expr->kind[a];
+     if (_expr->kind[b] > _kind) {
+          _kind          = _expr->kind[b];
+     }
+     if (_expr->kind[c] > _kind) {
+          _kind          = _expr->kind[c];
+     }
+
+     if (_kind == FD_KIND_CONST) {
+          return fd_new_reg(parser, FD_KIND_CONST,
+                            fd_expr_op(op, _expr->value[a], _expr->value[b],
+                                       _expr->value[c]));
+     }
+
+     if ((_dst = fd_new_reg(parser, _kind, 0.0)) < 0) {
+          return -1;
+     }
+
+     _instr         = (_kind == FD_KIND_ROW) ? &_expr->row[_expr->nb_row++]
+                                             : &_expr->batch[_expr->nb_batch++];
+     _instr->op     = op;
+     _instr->dst    = _dst;
+     _instr->a      = a;
+     _instr->b      = b;
+     _instr->c      = c;
+
+     return _dst;
+}
+
+// }}}
+// fd_skip() {{{
+/******************************************************************************
+
+                         FD_SKIP
+
+     Skip the spaces, then return TRUE if the formula continues with token.
+
+******************************************************************************/
+static int fd_skip(fd_ref_parser parser, const char *token)
+{
+     int             _len;
+
+     while (isspace((unsigned char) *parser->ptr)) {
+          parser->ptr++;
+     }
+
+     _len           = strlen(token);
+     if (strncmp(parser->ptr, token, _len) == 0) {
+          parser->ptr   += _len;
+          return 1;
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_parse_primary() {{{
+/******************************************************************************
+
+                         FD_PARSE_PRIMARY
+
+     number, variable, function call or parenthesized formula.
+
+******************************************************************************/
+static int fd_parse_primary(fd_ref_parser parser)
+{
+     fd_ref_expr     _expr = parser->expr;
+     fd_ref_func     _func;
+     char            _name[16], *_end;
+     int             _len, _args[2], _k, _reg;
+     double          _value;
+
+     if (fd_skip(parser, "(")) {
+          _reg           = fd_parse_cond(parser);
+          if (_reg >= 0 && !fd_skip(parser, ")")) {
+               return fd_parse_error(parser, "')' expected");
+          }
+          return _reg;
+     }
+
+     /* Number
+        ~~~~~~ */
+     if (isdigit((unsigned char) *parser->ptr) || *parser->ptr == '.') {
+          _value         = strtod(parser->ptr, &_end);
+          if (_end == parser->ptr) {
+               return fd_parse_error(parser, "invalid number");
+          }
+          parser->ptr    = _end;
+          return fd_new_reg(parser, FD_KIND_CONST, _value);
+     }
+
+     /* Identifier
+        ~~~~~~~~~~ */
+     for (_len = 0; isalnum((unsigned char) parser->ptr[_len]) || parser->ptr[_len] == '_';
+          _len++) {
+          if (_len < sizeof(_name) - 1) {
+               _name[_len]    = parser->ptr[_len];
+          }
+     }
+     if (_len == 0) {
+          return fd_parse_error(parser, *parser->ptr ? "unexpected character"
+                                                      : "unexpected end of formula");
+     }
+     if (_len >= sizeof(_name)) {
+          return fd_parse_error(parser, "unknown name");
+     }
+     _name[_len]    = 0;
+
+     if (strcmp(_name, "i") == 0 || strcmp(_name, "j") == 0) {
+          parser->ptr   += _len;
+          return (_name[0] == 'i') ? FD_REG_I : FD_REG_J;
+     }
+     if (strcmp(_name, "n") == 0 || strcmp(_name, "p") == 0 || strcmp(_name, "pi") == 0) {
+          parser->ptr   += _len;
+          _value         = strcmp(_name, "n") == 0 ? _expr->n
+                         : strcmp(_name, "p") == 0 ? _expr->p
+                         :                           M_PI;
+          return fd_new_reg(parser, FD_KIND_CONST, _value);
+     }
+
+     for (_func = fd_funcs; _func->name != NULL; _func++) {
+          if (strcmp(_name, _func->name) == 0) {
+               break;
+          }
+     }
+     if (_func->name == NULL) {
+          return fd_parse_error(parser, "unknown name");
+     }
+     parser->ptr   += _len;
+
+     /* Function call
+        ~~~~~~~~~~~~~ */
+     if (!fd_skip(parser, "(")) {
+          return fd_parse_error(parser, "'(' expected");
+     }
+     for (_k = 0; _k < _func->nb_args; _k++) {
+          if (_k > 0 && !fd_skip(parser, ",")) {
+               return fd_parse_error(parser, "',' expected");
+          }
+          if ((_args[_k] = fd_parse_cond(parser)) < 0) {
+               return -1;
+          }
+     }
+     if (!fd_skip(parser, ")")) {
+          return fd_parse_error(parser, "')' expected");
+     }
+
+     return fd_emit(parser, _func->op, _args[0], _args[_func->nb_args - 1], _args[0]);
+}
+
+// }}}
+// fd_parse_unary() {{{
+/******************************************************************************
+
+                         FD_PARSE_UNARY
+
+     Unary operators, then the power operator, right associative.
+
+******************************************************************************/
+static int fd_parse_unary(fd_ref_parser parser)
+{
+     int             _a, _b;
+
+     if (fd_skip(parser, "-")) {
+          _a             = fd_parse_unary(parser);
+          return fd_emit(parser, FD_OP_NEG, _a, _a, _a);
+     }
+     if (fd_skip(parser, "+")) {
+          return fd_parse_unary(parser);
+     }
+     if (fd_skip(parser, "!")) {
+          _a             = fd_parse_unary(parser);
+          return fd_emit(parser, FD_OP_NOT, _a, _a, _a);
+     }
+
+     if ((_a = fd_parse_primary(parser)) < 0) {
+          return -1;
+     }
+     if (fd_skip(parser, "^")) {
+          _b             = fd_parse_unary(parser);
+          return fd_emit(parser, FD_OP_POW, _a, _b, _a);
+     }
+
+     return _a;
+}
+
+// }}}
+// fd_parse_mul() {{{
+/******************************************************************************
+
+                         FD_PARSE_MUL
+
+******************************************************************************/
+static int fd_parse_mul(fd_ref_parser parser)
+{
+     int             _a, _b, _op;
+
+     _a             = fd_parse_unary(parser);
+     while (_a >= 0) {
+          if (fd_skip(parser, "*")) {
+               _op            = FD_OP_MUL;
+          }
+          else if (fd_skip(parser, "/")) {
+               _op            = FD_OP_DIV;
+          }
+          else if (fd_skip(parser, "%")) {
+               _op            = FD_OP_MOD;
+          }
+          else {
+               break;
+          }
+          _b             = fd_parse_unary(parser);
+          _a             = fd_emit(parser, _op, _a, _b, _a);
+     }
+
+     return _a;
+}
+
+// }}}
+// fd_parse_add() {{{
+/******************************************************************************
+
+                         FD_PARSE_ADD
+
+******************************************************************************/
+static int fd_parse_add(fd_ref_parser parser)
+{
+     int             _a, _b, _op;
+
+     _a             = fd_parse_mul(parser);
+     while (_a >= 0) {
+          if (fd_skip(parser, "+")) {
+               _op            = FD_OP_ADD;
+          }
+          else if (fd_skip(parser, "-")) {
+               _op            = FD_OP_SUB;
+          }
+          else {
+               break;
+          }
+          _b             = fd_parse_mul(parser);
+          _a             = fd_emit(parser, _op, _a, _b, _a);
+     }
+
+     return _a;
+}
+
+// }}}
+// fd_parse_cmp() {{{
+/******************************************************************************
+
+                         FD_PARSE_CMP
+
+******************************************************************************/
+static int fd_parse_cmp(fd_ref_parser parser)
+{
+     int             _a, _b, _op;
+
+     if ((_a = fd_parse_add(parser)) < 0) {
+          return -1;
+     }
+
+     if (fd_skip(parser, "<=")) {
+          _op            = FD_OP_LE;
+     }
+     else if (fd_skip(parser, ">=")) {
+          _op            = FD_OP_GE;
+     }
+     else if (fd_skip(parser, "==")) {
+          _op            = FD_OP_EQ;
+     }
+     else if (fd_skip(parser, "!=")) {
+          _op            = FD_OP_NE;
+     }
+     else if (fd_skip(parser, "<")) {
+          _op            = FD_OP_LT;
+     }
+     else if (fd_skip(parser, ">")) {
+          _op            = FD_OP_GT;
+     }
+     else {
+          return _a;
+     }
+
+     _b             = fd_parse_add(parser);
+
+     return fd_emit(parser, _op, _a, _b, _a);
+}
+
+// }}}
+// fd_parse_and() {{{
+/******************************************************************************
+
+                         FD_PARSE_AND
+
+******************************************************************************/
+static int fd_parse_and(fd_ref_parser parser)
+{
+     int             _a, _b;
+
+     _a             = fd_parse_cmp(parser);
+     while (_a >= 0 && fd_skip(parser, "&&")) {
+          _b             = fd_parse_cmp(parser);
+          _a             = fd_emit(parser, FD_OP_AND, _a, _b, _a);
+     }
+
+     return _a;
+}
+
+// }}}
+// fd_parse_or() {{{
+/******************************************************************************
+
+                         FD_PARSE_OR
+
+******************************************************************************/
+static int fd_parse_or(fd_ref_parser parser)
+{
+     int             _a, _b;
+
+     _a             = fd_parse_and(parser);
+     while (_a >= 0 && fd_skip(parser, "||")) {
+          _b             = fd_parse_and(parser);
+          _a             = fd_emit(parser, FD_OP_OR, _a, _b, _a);
+     }
+
+     return _a;
+}
+
+// }}}
+// fd_parse_cond() {{{
+/******************************************************************************
+
+                         FD_PARSE_COND
+
+     c ? a : b, right associative. Both a and b are computed.
+
+******************************************************************************/
+static int fd_parse_cond(fd_ref_parser parser)
+{
+     int             _c, _a, _b;
+
+     if ((_c = fd_parse_or(parser)) < 0 || !fd_skip(parser, "?")) {
+          return _c;
+     }
+
+     if ((_a = fd_parse_cond(parser)) < 0) {
+          return -1;
+     }
+     if (!fd_skip(parser, ":")) {
+          return fd_parse_error(parser, "':' expected");
+     }
+     _b             = fd_parse_cond(parser);
+
+     return fd_emit(parser, FD_OP_SEL, _c, _a, _b);
+}
+
+// }}}
+// fd_expr_compile() {{{
+/******************************************************************************
+
+                         FD_EXPR_COMPILE
+
+     Compile the formula text, for a n x p matrix. Return 0, or -1 with
+     errno set to EINVAL, err_msg and err_pos describing the error.
+
+******************************************************************************/
+int fd_expr_compile(fd_ref_expr expr, const char *text, int64_t n, int64_t p)
+{
+     fd_parser       _parser;
+     uint8_t         _used[FD_EXPR_MAX_REGS];
+     int             _k, _r;
+
+     memset(expr, 0, sizeof(*expr));
+     expr->n        = n;
+     expr->p        = p;
+
+     _parser.expr   = expr;
+     _parser.text   = text;
+     _parser.ptr    = text;
+
+     fd_new_reg(&_parser, FD_KIND_ROW, 0.0);           // FD_REG_I
+     fd_new_reg(&_parser, FD_KIND_VAR, 0.0);           // FD_REG_J
+
+     expr->result   = fd_parse_cond(&_parser);
+     fd_skip(&_parser, "");
+     if (expr->result >= 0 && *_parser.ptr != 0) {
+          fd_parse_error(&_parser, "unexpected character");
+          expr->result   = -1;
+     }
+     if (expr->result < 0) {
+          errno          = EINVAL;
+          return -1;
+     }
+
+     /* Registers computed once per line and used by the batch program
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     memset(_used, 0, sizeof(_used));
+     for (_k = 0; _k < expr->nb_batch; _k++) {
+          _used[expr->batch[_k].a]      = 1;
+          _used[expr->batch[_k].b]      = 1;
+          _used[expr->batch[_k].c]      = 1;
+     }
+     for (_r = 0; _r < expr->nb_regs; _r++) {
+          if (_used[_r] && expr->kind[_r] != FD_KIND_VAR) {
+               expr->bcast[expr->nb_bcast++] = _r;
+          }
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_expr_workspace() {{{
+/******************************************************************************
+
+                         FD_EXPR_WORKSPACE
+
+     Allocate the registers of an evaluation of a compiled formula : one
+     scalar and one vector of FD_EXPR_BATCH elements per register. Each
+     thread evaluating the formula needs its own workspace, freed with
+     free().
+
+******************************************************************************/
+double *fd_expr_workspace(fd_ref_expr expr)
+{
+     double         *_work;
+     size_t          _size;
+
+     _size          = (size_t) FD_EXPR_MAX_REGS * (FD_EXPR_BATCH + 1) * sizeof(double);
+     if ((_work = aligned_alloc(64, _size)) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+     memset(_work, 0, _size);
+
+     memcpy(_work, expr->value, expr->nb_regs * sizeof(double));
+
+     return _work;
+}
+
+// }}}
+// fd_expr_eval_row() {{{
+/******************************************************************************
+
+                         FD_EXPR_EVAL_ROW
+
+     Compute the dx elements of line i starting at column j0 into values.
+     The last batch is computed entirely, the elements after the end of the
+     line being dropped.
+
+******************************************************************************/
+void fd_expr_eval_row(fd_ref_expr expr, double *work, int64_t i, int64_t j0, int64_t dx,
+                      double *values)
+{
+     double         *_scal, *_vec, *_j;
+     fd_ref_instr    _instr;
+     int64_t         _k;
+     int             _l, _m, _nb;
+
+     _scal          = work;
+     _vec           = work + FD_EXPR_MAX_REGS;
+
+     /* Values depending on i only
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _scal[FD_REG_I]     = i;
+     for (_l = 0; _l < expr->nb_row; _l++) {
+          _instr         = &expr->row[_l];
+          _scal[_instr->dst]  = fd_expr_op(_instr->op, _scal[_instr->a], _scal[_instr->b],
+                                           _scal[_instr->c]);
+     }
+
+     if (expr->kind[expr->result] != FD_KIND_VAR) {
+          for (_k = 0; _k < dx; _k++) {
+               values[_k]     = _scal[expr->result];
+          }
+          return;
+     }
+
+     for (_l = 0; _l < expr->nb_bcast; _l++) {
+          for (_m = 0; _m < FD_EXPR_BATCH; _m++) {
+               _vec[(expr->bcast[_l] * FD_EXPR_BATCH) + _m]     = _scal[expr->bcast[_l]];
+          }
+     }
+
+     /* Values depending on j, by batches
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _j             = _vec + (FD_REG_J * FD_EXPR_BATCH);
+     for (_k = 0; _k < dx; _k += _nb) {
+          _nb            = (dx - _k < FD_EXPR_BATCH) ? dx - _k : FD_EXPR_BATCH;
+
+          for (_m = 0; _m < FD_EXPR_BATCH; _m++) {
+               _j[_m]         = j0 + _k + _m;
+          }
+
+          for (_l = 0; _l < expr->nb_batch; _l++) {
+               _instr         = &expr->batch[_l];
+               fd_expr_vec(_instr->op, _vec + (_instr->dst * FD_EXPR_BATCH),
+                           _vec + (_instr->a * FD_EXPR_BATCH),
+                           _vec + (_instr->b * FD_EXPR_BATCH),
+                           _vec + (_instr->c * FD_EXPR_BATCH));
+          }
+
+          memcpy(values + _k, _vec + (expr->result * FD_EXPR_BATCH), _nb * sizeof(double));
+     }
+}
+
+// }}}
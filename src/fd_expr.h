@@ -0,0 +1,86 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_expr.h Version 1.1 du 24/08/01 -
+ *
+ *   Formulas generating the elements of a matrix.
+ */
+
+#ifndef FD_EXPR_H
+#define FD_EXPR_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Macros definitions {{{
+/* Maximum number of registers and of instructions of a formula
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_EXPR_MAX_REGS    (128)
+
+/* Number of elements of a line evaluated by each vector instruction
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_EXPR_BATCH       (256)
+
+// }}}
+// Structures definitions {{{
+/* Instruction : reg[dst] = op(reg[a], reg[b], reg[c])
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+struct fd_instr {
+     uint8_t              op;      // Operation
+     uint8_t              dst;     // Result register
+     uint8_t              a;       // Operands registers
+     uint8_t              b;
+     uint8_t              c;
+};
+typedef struct fd_instr             fd_instr;
+typedef struct fd_instr            *fd_ref_instr;
+
+/* A compiled formula : the subexpressions depending on no variable are
+ * computed by the compiler, those depending on i only are computed once
+ * per line (row program), and those depending on j are computed on
+ * batches of FD_EXPR_BATCH elements of the line (batch program).
+ * Each instruction has its own result register.
+ */
+struct fd_expr {
+     int64_t              n;       // Value of n
+     int64_t              p;       // Value of p
+     int                  nb_regs; // Number of registers
+     uint8_t              kind[FD_EXPR_MAX_REGS];  // Dependency of the registers
+     double               value[FD_EXPR_MAX_REGS]; // Values of the constants
+     fd_instr             row[FD_EXPR_MAX_REGS];   // Row program
+     int                  nb_row;
+     fd_instr             batch[FD_EXPR_MAX_REGS]; // Batch program
+     int                  nb_batch;
+     uint8_t              bcast[FD_EXPR_MAX_REGS]; // Registers copied in vectors
+     int                  nb_bcast;
+     int                  result;  // Register of the result
+     int                  err_pos; // Position of the error in the formula
+     const char          *err_msg; // Description of the error
+};
+typedef struct fd_expr              fd_expr;
+typedef struct fd_expr             *fd_ref_expr;
+
+// }}}
+// Functions prototypes {{{
+int       fd_expr_compile(fd_ref_expr expr, const char *text, int64_t n, int64_t p);
+double   *fd_expr_workspace(fd_ref_expr expr);
+void      fd_expr_eval_row(fd_ref_expr expr, double *work, int64_t i, int64_t j0,
+                           int64_t dx, double *values);
+
+// }}}
+
+#endif	/* FD_EXPR_H */
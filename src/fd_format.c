@@ -0,0 +1,285 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_format.c Version 1.2 du 24/08/10 - 
+ *
+ *   Fast number formatting, producing the same characters as printf().
+ *
+ *   The numbers are written into a buffer supplied by the caller, which
+ *   must hold at least (FD_FMT_MAX_LEN + width + 1) characters, and the
+ *   functions return the length of the formatted number.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "fd_format.h"
+
+// }}}
+// Macros definitions {{{
+/* Highest precision handled without snprintf()
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_FMT_MAX_PREC     (19)
+
+// }}}
+// Global variables {{{
+static const uint64_t          fd_pow10[FD_FMT_MAX_PREC + 1] = {
+     1ULL,                    10ULL,
+     100ULL,                  1000ULL,
+     10000ULL,                100000ULL,
+     1000000ULL,              10000000ULL,
+     100000000ULL,            1000000000ULL,
+     10000000000ULL,          100000000000ULL,
+     1000000000000ULL,        10000000000000ULL,
+     100000000000000ULL,      1000000000000000ULL,
+     10000000000000000ULL,    100000000000000000ULL,
+     1000000000000000000ULL,  10000000000000000000ULL
+};
+
+// }}}
+
+// fd_fmt_nb_digits() {{{
+/******************************************************************************
+
+                         FD_FMT_NB_DIGITS
+
+     Return the number of decimal digits of a number.
+
+******************************************************************************/
+int fd_fmt_nb_digits(uint64_t value)
+{
+     int             _nb;
+
+     for (_nb = 1; _nb < FD_FMT_MAX_PREC + 1; _nb++) {
+          if (value < fd_pow10[_nb]) {
+               break;
+          }
+     }
+
+     return _nb;
+}
+
+// }}}
+// fd_fmt_uint() {{{
+/******************************************************************************
+
+                         FD_FMT_UINT
+
+     Write the digits of an unsigned number, exactly nb_digits long
+     (leading zeros are added if needed).
+
+******************************************************************************/
+static void fd_fmt_uint(char *buf, uint64_t value, int nb_digits)
+{
+     char            *_ptr;
+
+     for (_ptr = buf + nb_digits - 1; _ptr >= buf; _ptr--) {
+          *_ptr          = '0' + (value % 10);
+          value         /= 10;
+     }
+}
+
+// }}}
+// fd_fmt_pad() {{{
+/******************************************************************************
+
+                         FD_FMT_PAD
+
+     Justify the len characters of buf in a field of width characters,
+     like printf() : on the right for a positive width, on the left for a
+     negative one.
+
+******************************************************************************/
+static int fd_fmt_pad(char *buf, int len, int width)
+{
+     int             _pad;
+
+     if (width < 0) {
+          for ( ; len < -width; len++) {
+               buf[len]       = ' ';
+          }
+     }
+     else if (len < width) {
+          _pad           = width - len;
+          memmove(buf + _pad, buf, len);
+          memset(buf, ' ', _pad);
+          len            = width;
+     }
+     buf[len]       = 0;
+
+     return len;
+}
+
+// }}}
+// fd_fmt_int() {{{
+/******************************************************************************
+
+                         FD_FMT_INT
+
+     Equivalent of sprintf(buf, "%*" PRId64, width, value).
+
+******************************************************************************/
+int fd_fmt_int(char *buf, int64_t value, int width)
+{
+     uint64_t        _abs;
+     int             _len = 0, _nb;
+
+     if (value < 0) {
+          buf[_len++]    = '-';
+          _abs           = - (uint64_t) value;
+     }
+     else {
+          _abs           = value;
+     }
+
+     _nb            = fd_fmt_nb_digits(_abs);
+     fd_fmt_uint(buf + _len, _abs, _nb);
+     _len          += _nb;
+
+     return fd_fmt_pad(buf, _len, width);
+}
+
+// }}}
+// fd_fmt_double() {{{
+/******************************************************************************
+
+                         FD_FMT_DOUBLE
+
+     Equivalent of sprintf(buf, "%*.*f", width, prec, value).
+
+     The double is split into its integer and fractional parts, which are
+     exact binary fractions : the decimals are computed with 128 bits
+     integer arithmetic and rounded to nearest, ties to even, like the
+     libc does. Values that cannot be handled this way (infinities, NaN,
+     magnitudes above 2^63, high precisions) are given to snprintf().
+
+******************************************************************************/
+int fd_fmt_double(char *buf, double value, int width, int prec)
+{
+     union {
+          double          d;
+          uint64_t        u;
+     }                    _bits;
+     uint64_t             _mant, _int_part, _dec;
+     unsigned __int128    _frac, _rem, _half;
+     int                  _exp, _shift, _len = 0, _nb;
+
+     if (isnan(value) || isinf(value) || fabs(value) >= 0x1p63
+     ||  prec < 0 || prec > FD_FMT_MAX_PREC) {
+          return sprintf(buf, "%*.*f", width, prec, value);
+     }
+
+     /* Sign (also for -0.0)
+        ~~~~~~~~~~~~~~~~~~~~ */
+     _bits.d        = value;
+     if (_bits.u >> 63) {
+          buf[_len++]    = '-';
+     }
+
+     /* value = _mant * 2^_exp
+        ~~~~~~~~~~~~~~~~~~~~~~ */
+     _exp           = (_bits.u >> 52) & 0x7FF;
+     _mant          = _bits.u & ((1ULL << 52) - 1);
+     if (_exp == 0) {
+          _exp           = 1;                     // Subnormal number
+     }
+     else {
+          _mant         |= 1ULL << 52;
+     }
+     _exp          -= 1075;
+
+     if (_exp >= 0) {
+          _int_part      = _mant << _exp;
+          _dec           = 0;
+     }
+     else {
+          /* Fractional part : _frac / 2^_shift
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _shift         = -_exp;
+          if (_shift < 64) {
+               _int_part      = _mant >> _shift;
+               _frac          = _mant & ((1ULL << _shift) - 1);
+          }
+          else {
+               _int_part      = 0;
+               _frac          = _mant;
+          }
+
+          /* Decimals : _frac * 10^prec / 2^_shift, rounded
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _frac         *= fd_pow10[prec];       // Less than 2^117
+          if (_shift < 128) {
+               _dec           = _frac >> _shift;
+               _rem           = _frac & ((((unsigned __int128) 1) << _shift) - 1);
+               _half          = ((unsigned __int128) 1) << (_shift - 1);
+               if (_rem > _half
+               || (_rem == _half && ((prec > 0 ? _dec : _int_part) & 1))) {
+                    _dec++;
+               }
+          }
+          else {
+               _dec           = 0;
+          }
+
+          if (_dec >= fd_pow10[prec]) {
+               _dec          -= fd_pow10[prec];
+               _int_part++;
+          }
+     }
+
+     _nb            = fd_fmt_nb_digits(_int_part);
+     fd_fmt_uint(buf + _len, _int_part, _nb);
+     _len          += _nb;
+
+     if (prec > 0) {
+          buf[_len++]    = '.';
+          fd_fmt_uint(buf + _len, _dec, prec);
+          _len          += prec;
+     }
+
+     return fd_fmt_pad(buf, _len, width);
+}
+
+// }}}
+// fd_fmt_complex() {{{
+/******************************************************************************
+
+                         FD_FMT_COMPLEX
+
+     Format a complex number as "re+imi" in a field of width characters.
+     The parts are written with "%g" : their number of significant digits
+     is reduced, from prec down to 1, until the number fits in the field.
+
+******************************************************************************/
+int fd_fmt_complex(char *buf, double re, double im, int width, int prec)
+{
+     int             _len, _abs_width;
+
+     _abs_width     = width < 0 ? -width : width;
+
+     for ( ; ; prec--) {
+          _len           = snprintf(buf, FD_FMT_MAX_LEN, "%.*g%+.*gi", prec, re, prec, im);
+          if (_len <= _abs_width || prec <= 1) {
+               break;
+          }
+     }
+
+     return fd_fmt_pad(buf, _len, width);
+}
+
+// }}}
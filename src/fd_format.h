@@ -0,0 +1,47 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_format.h Version 1.2 du 24/08/10 - 
+ *
+ *   Fast number formatting, producing the same characters as printf().
+ */
+
+#ifndef FD_FORMAT_H
+#define FD_FORMAT_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Macros definitions {{{
+/* Maximum length of a formatted number (without padding)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_FMT_MAX_LEN      (352)
+
+/* Default precision of "%f"
+   ~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_FMT_PREC         (6)
+
+// }}}
+// Functions prototypes {{{
+int  fd_fmt_nb_digits(uint64_t value);
+int  fd_fmt_int(char *buf, int64_t value, int width);
+int  fd_fmt_double(char *buf, double value, int width, int prec);
+int  fd_fmt_complex(char *buf, double re, double im, int width, int prec);
+
+// }}}
+
+#endif	/* FD_FORMAT_H */
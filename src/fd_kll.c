@@ -0,0 +1,473 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_kll.c Version 1.1 du 24/08/07 -
+ *
+ *   Quantile sketch of Karnin, Lang and Liberty (KLL), approximating the
+ *   quantiles of a stream of values in O(k) memory.
+ *
+ *   The compactions are lazy : the lowest full compactor is compacted
+ *   only when the sketch holds more items than all its compactors can
+ *   hold. Two sketches are merged by concatenating their compactors,
+ *   which lets the threads of fd_kll_scan() build their own sketches.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "fd_elt.h"
+#include "fd_kll.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+
+/* Ratio of the capacities of two consecutive compactors
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_KLL_RATIO        (2.0 / 3.0)
+
+/* Smallest capacity of a compactor
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_KLL_MIN_CAP      (8)
+
+// }}}
+// Structures definitions {{{
+struct fd_kll_item {
+     double               value;   // Value of the item
+     double               weight;  // Number of values it stands for
+};
+typedef struct fd_kll_item          fd_kll_item;
+typedef struct fd_kll_item         *fd_ref_kll_item;
+
+struct fd_kll_work {
+     fd_ref_provider      provider; // Provider of the elements
+     int64_t              first;   // First line read
+     int64_t              step;    // Distance between the lines read
+     int64_t              nb_lines; // Number of lines read
+     int64_t              next;    // Next block of lines
+};
+typedef struct fd_kll_work          fd_kll_work;
+typedef struct fd_kll_work         *fd_ref_kll_work;
+
+struct fd_kll_part {
+     fd_ref_kll_work      work;    // Common parameters
+     fd_kll               kll;     // Sketch of the thread
+     pthread_t            thread;  // Reading thread
+};
+typedef struct fd_kll_part          fd_kll_part;
+typedef struct fd_kll_part         *fd_ref_kll_part;
+
+// }}}
+
+// fd_kll_capacity() {{{
+/******************************************************************************
+
+                         FD_KLL_CAPACITY
+
+     Return the capacity of compactor h, from its depth below the highest
+     compactor.
+
+******************************************************************************/
+static inline int fd_kll_capacity(fd_ref_kll kll, int h)
+{
+     return kll->caps[kll->nb_levels - 1 - h];
+}
+
+// }}}
+// fd_kll_push() {{{
+/******************************************************************************
+
+                         FD_KLL_PUSH
+
+     Append a value to compactor h, creating it if needed.
+
+******************************************************************************/
+static void fd_kll_push(fd_ref_kll kll, int h, double value)
+{
+     if (h >= kll->nb_levels) {
+          if (h >= FD_KLL_MAX_LEVELS) {
+               fprintf(stderr, "Too many compactors !\n");
+               exit(1);
+          }
+          kll->nb_levels = h + 1;
+     }
+
+     if (kll->size[h] == kll->alloc[h]) {
+          kll->alloc[h]  = kll->alloc[h] == 0 ? FD_KLL_K : 2 * kll->alloc[h];
+          if ((kll->items[h] = realloc(kll->items[h], kll->alloc[h] * sizeof(double))) == NULL) {
+               fprintf(stderr, "Malloc error !\n");
+               exit(1);
+          }
+     }
+
+     kll->items[h][kll->size[h]++] = value;
+}
+
+// }}}
+// fd_kll_cmp() {{{
+/******************************************************************************
+
+                         FD_KLL_CMP
+
+******************************************************************************/
+static int fd_kll_cmp(const void *a, const void *b)
+{
+     double          _a = *(const double *) a, _b = *(const double *) b;
+
+     return (_a > _b) - (_a < _b);
+}
+
+// }}}
+// fd_kll_sizes() {{{
+/******************************************************************************
+
+                         FD_KLL_SIZES
+
+     Get the number of items of the sketch, and the number of items its
+     compactors can hold.
+
+******************************************************************************/
+static void fd_kll_sizes(fd_ref_kll kll, int *total, int *capacity)
+{
+     int             _h;
+
+     *total         = 0;
+     *capacity      = 0;
+     for (_h = 0; _h < kll->nb_levels; _h++) {
+          *total        += kll->size[_h];
+          *capacity     += fd_kll_capacity(kll, _h);
+     }
+}
+
+// }}}
+// fd_kll_compress() {{{
+/******************************************************************************
+
+                         FD_KLL_COMPRESS
+
+     Compact the lowest full compactors while the sketch holds more items
+     than its compactors can hold.
+
+******************************************************************************/
+static void fd_kll_compress(fd_ref_kll kll)
+{
+     int             _h, _k, _size, _total, _capacity, _offset;
+
+     for (;;) {
+          fd_kll_sizes(kll, &_total, &_capacity);
+          if (_total < _capacity) {
+               return;
+          }
+
+          for (_h = 0; _h < kll->nb_levels; _h++) {
+               if (kll->size[_h] >= fd_kll_capacity(kll, _h)) {
+                    break;
+               }
+          }
+          if (_h == kll->nb_levels) {
+               return;
+          }
+
+          /* Promote one sorted item out of two, the odd one staying
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _size          = kll->size[_h];
+          qsort(kll->items[_h], _size, sizeof(double), fd_kll_cmp);
+
+          kll->seed     ^= kll->seed << 13;
+          kll->seed     ^= kll->seed >> 7;
+          kll->seed     ^= kll->seed << 17;
+          _offset        = kll->seed & 1;
+
+          for (_k = _offset; _k < (_size & ~1); _k += 2) {
+               fd_kll_push(kll, _h + 1, kll->items[_h][_k]);
+          }
+          if (_size & 1) {
+               kll->items[_h][0]   = kll->items[_h][_size - 1];
+          }
+          kll->size[_h]  = _size & 1;
+     }
+}
+
+// }}}
+// fd_kll_init() {{{
+/******************************************************************************
+
+                         FD_KLL_INIT
+
+     Initialize an empty sketch.
+
+******************************************************************************/
+void fd_kll_init(fd_ref_kll kll, uint64_t seed)
+{
+     int             _d;
+
+     memset(kll, 0, sizeof(*kll));
+     kll->nb_levels = 1;
+     kll->seed      = seed | 1;
+
+     for (_d = 0; _d < FD_KLL_MAX_LEVELS; _d++) {
+          kll->caps[_d]  = (int) ceil(FD_KLL_K * pow(FD_KLL_RATIO, _d));
+          if (kll->caps[_d] < FD_KLL_MIN_CAP) {
+               kll->caps[_d]  = FD_KLL_MIN_CAP;
+          }
+     }
+}
+
+// }}}
+// fd_kll_add() {{{
+/******************************************************************************
+
+                         FD_KLL_ADD
+
+     Add nb values to the sketch, NaN excepted.
+
+******************************************************************************/
+void fd_kll_add(fd_ref_kll kll, const double *values, int64_t nb)
+{
+     int64_t         _k;
+     int             _total, _capacity;
+
+     fd_kll_sizes(kll, &_total, &_capacity);
+     for (_k = 0; _k < nb; _k++) {
+          if (values[_k] != values[_k]) {
+               continue;
+          }
+          fd_kll_push(kll, 0, values[_k]);
+          kll->n++;
+
+          if (++_total >= _capacity) {
+               fd_kll_compress(kll);
+               fd_kll_sizes(kll, &_total, &_capacity);
+          }
+     }
+}
+
+// }}}
+// fd_kll_merge() {{{
+/******************************************************************************
+
+                         FD_KLL_MERGE
+
+     Add the values of another sketch to a sketch.
+
+******************************************************************************/
+void fd_kll_merge(fd_ref_kll kll, fd_ref_kll other)
+{
+     int             _h, _k;
+
+     for (_h = 0; _h < other->nb_levels; _h++) {
+          for (_k = 0; _k < other->size[_h]; _k++) {
+               fd_kll_push(kll, _h, other->items[_h][_k]);
+          }
+     }
+     kll->n        += other->n;
+
+     fd_kll_compress(kll);
+}
+
+// }}}
+// fd_kll_item_cmp() {{{
+/******************************************************************************
+
+                         FD_KLL_ITEM_CMP
+
+******************************************************************************/
+static int fd_kll_item_cmp(const void *a, const void *b)
+{
+     return fd_kll_cmp(&((const fd_kll_item *) a)->value, &((const fd_kll_item *) b)->value);
+}
+
+// }}}
+// fd_kll_quantile() {{{
+/******************************************************************************
+
+                         FD_KLL_QUANTILE
+
+     Return an approximation of the q-quantile (0 <= q <= 1) of the values
+     of the sketch, NaN if it is empty.
+
+******************************************************************************/
+double fd_kll_quantile(fd_ref_kll kll, double q)
+{
+     fd_ref_kll_item      _items;
+     double               _total, _target, _sum, _value;
+     int                  _h, _k, _nb = 0;
+
+     for (_h = 0; _h < kll->nb_levels; _h++) {
+          _nb           += kll->size[_h];
+     }
+     if (_nb == 0) {
+          return NAN;
+     }
+
+     if ((_items = malloc(_nb * sizeof(fd_kll_item))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     for (_h = 0, _nb = 0, _total = 0.0; _h < kll->nb_levels; _h++) {
+          for (_k = 0; _k < kll->size[_h]; _k++, _nb++) {
+               _items[_nb].value   = kll->items[_h][_k];
+               _items[_nb].weight  = ldexp(1.0, _h);
+               _total             += _items[_nb].weight;
+          }
+     }
+     qsort(_items, _nb, sizeof(fd_kll_item), fd_kll_item_cmp);
+
+     /* First item whose cumulated weight reaches the rank
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _target        = q * _total;
+     for (_k = 0, _sum = 0.0; _k < _nb - 1; _k++) {
+          _sum          += _items[_k].weight;
+          if (_sum >= _target) {
+               break;
+          }
+     }
+     _value         = _items[_k].value;
+
+     free(_items);
+
+     return _value;
+}
+
+// }}}
+// fd_kll_free() {{{
+/******************************************************************************
+
+                         FD_KLL_FREE
+
+     Free the compactors of a sketch.
+
+******************************************************************************/
+void fd_kll_free(fd_ref_kll kll)
+{
+     int             _h;
+
+     for (_h = 0; _h < FD_KLL_MAX_LEVELS; _h++) {
+          free(kll->items[_h]);
+          kll->items[_h] = NULL;
+          kll->size[_h]  = 0;
+          kll->alloc[_h] = 0;
+     }
+     kll->nb_levels = 1;
+     kll->n         = 0;
+}
+
+// }}}
+// fd_kll_thread() {{{
+/******************************************************************************
+
+                         FD_KLL_THREAD
+
+     Add blocks of lines to the sketch of a thread.
+
+******************************************************************************/
+static void *fd_kll_thread(void *arg)
+{
+     fd_ref_kll_part      _thr = arg;
+     fd_ref_kll_work      _work = _thr->work;
+     fd_ref_provider      _provider = _work->provider;
+     char                *_elts;
+     double              *_values;
+     int64_t              _s, _s0, _l, _c, _w;
+
+     if ((_elts   = malloc(FD_KLL_CHUNK * FD_ELT_MAX_SIZE)) == NULL
+     ||  (_values = malloc(FD_KLL_CHUNK * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     while ((_s0 = __atomic_fetch_add(&_work->next, FD_KLL_LINES, __ATOMIC_RELAXED))
+            < _work->nb_lines) {
+          for (_s = _s0; _s < FD_MIN(_s0 + FD_KLL_LINES, _work->nb_lines); _s++) {
+               _l             = _work->first + (_s * _work->step);
+               for (_c = 0; _c < _provider->p; _c += _w) {
+                    _w             = FD_MIN(FD_KLL_CHUNK, _provider->p - _c);
+                    fd_provider_fill(_provider, _l + 1, _c + 1, 1, _w, _elts);
+                    fd_elt_to_double(_provider->elt_type, _elts, _w, _values);
+                    fd_kll_add(&_thr->kll, _values, _w);
+               }
+          }
+     }
+
+     free(_elts);
+     free(_values);
+
+     return NULL;
+}
+
+// }}}
+// fd_kll_scan() {{{
+/******************************************************************************
+
+                         FD_KLL_SCAN
+
+     Add the elements of the lines of the matrix already available to a
+     sketch, with nb_threads threads if the provider is reentrant. Matrices
+     of more than FD_KLL_MAX_ELTS elements are sampled : only evenly spaced
+     lines are read. Return the number of elements read.
+
+******************************************************************************/
+int64_t fd_kll_scan(fd_ref_kll kll, fd_ref_provider provider, int nb_threads)
+{
+     fd_kll_work          _work;
+     fd_kll_part          _thr[FD_KLL_MAX_THREADS];
+     int64_t              _ready;
+     int                  _t;
+
+     if (!provider->reentrant || nb_threads < 1) {
+          nb_threads     = 1;
+     }
+     if (nb_threads > FD_KLL_MAX_THREADS) {
+          nb_threads     = FD_KLL_MAX_THREADS;
+     }
+
+     _ready         = fd_provider_ready(provider);
+     _work.provider = provider;
+     _work.step     = 1;
+     if (_ready * provider->p > FD_KLL_MAX_ELTS) {
+          _work.step     = ((_ready * provider->p) + FD_KLL_MAX_ELTS - 1) / FD_KLL_MAX_ELTS;
+     }
+     _work.first    = _work.step / 2;
+     _work.nb_lines = _ready > _work.first
+                    ? ((_ready - _work.first - 1) / _work.step) + 1 : 0;
+     _work.next     = 0;
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          _thr[_t].work  = &_work;
+          fd_kll_init(&_thr[_t].kll, kll->seed + _t + 1);
+          if (_t > 0 && pthread_create(&_thr[_t].thread, NULL, fd_kll_thread, &_thr[_t]) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+     fd_kll_thread(&_thr[0]);
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          if (_t > 0) {
+               pthread_join(_thr[_t].thread, NULL);
+          }
+          fd_kll_merge(kll, &_thr[_t].kll);
+          fd_kll_free(&_thr[_t].kll);
+     }
+
+     return _work.nb_lines * provider->p;
+}
+
+// }}}
@@ -0,0 +1,78 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_kll.h Version 1.1 du 24/08/07 -
+ *
+ *   Quantile sketch (KLL) of the elements of a matrix.
+ */
+
+#ifndef FD_KLL_H
+#define FD_KLL_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_provider.h"
+
+// }}}
+// Macros definitions {{{
+/* Capacity of the highest compactor : the rank error is about 1.7 / k
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_KLL_K            (256)
+#define   FD_KLL_MAX_LEVELS   (64)
+
+/* Maximum number of elements read by fd_kll_scan() : larger matrices are
+   sampled by lines
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_KLL_MAX_ELTS     (1 << 24)
+
+/* Lines of a block read by a thread, and elements read at once
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_KLL_LINES        (64)
+#define   FD_KLL_CHUNK        (4096)
+
+#define   FD_KLL_MAX_THREADS  (256)
+
+// }}}
+// Structures definitions {{{
+/* Compactor h holds items of weight 2^h. A full compactor sorts its items
+ * and promotes one out of two of them, chosen at random, to compactor
+ * h + 1 : the capacity of the compactors decreases geometrically from the
+ * highest one, so that the sketch keeps O(k) items.
+ */
+struct fd_kll {
+     int                  nb_levels; // Number of compactors
+     double              *items[FD_KLL_MAX_LEVELS];
+     int                  size[FD_KLL_MAX_LEVELS];   // Items of the compactors
+     int                  alloc[FD_KLL_MAX_LEVELS];  // Allocated items
+     int                  caps[FD_KLL_MAX_LEVELS];   // Capacities, by depth
+     int64_t              n;       // Number of values added
+     uint64_t             seed;    // State of the random generator
+};
+typedef struct fd_kll               fd_kll;
+typedef struct fd_kll              *fd_ref_kll;
+
+// }}}
+// Functions prototypes {{{
+void      fd_kll_init(fd_ref_kll kll, uint64_t seed);
+void      fd_kll_add(fd_ref_kll kll, const double *values, int64_t nb);
+void      fd_kll_merge(fd_ref_kll kll, fd_ref_kll other);
+double    fd_kll_quantile(fd_ref_kll kll, double q);
+void      fd_kll_free(fd_ref_kll kll);
+int64_t   fd_kll_scan(fd_ref_kll kll, fd_ref_provider provider, int nb_threads);
+
+// }}}
+
+#endif	/* FD_KLL_H */
@@ -1,28 +1,61 @@
 /*
- *	@(#)	[MB] fd_matrix_01.c	Version 1.1 du 23/07/08 - 
+ *	@(#)	[MB] fd_matrix_01.c	Version 1.3 du 24/08/10 - 
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "fd_format.h"
+#include "fd_output.h"
+
+/******************************************************************************
+
+					FD_FORMAT_LINES
+
+	Format the coordinates of lines i1 to i2 of the matrix.
+
+******************************************************************************/
+void fd_format_lines(void *data, fd_ref_out_buf buf, int64_t i1, int64_t i2)
+{
+	int64_t			 _p = *(int64_t *) data, _i, _j;
+
+	for (_i = i1; _i <= i2; _i++) {
+		for (_j = 1; _j <= _p; _j++) {
+			FD_OUT_RESERVE(buf, 64);
+			buf->data[buf->len++]	 = '(';
+			buf->len		+= fd_fmt_int(buf->data + buf->len, _i, 2);
+			buf->data[buf->len++]	 = ',';
+			buf->data[buf->len++]	 = ' ';
+			buf->len		+= fd_fmt_int(buf->data + buf->len, _j, 2);
+			memcpy(buf->data + buf->len, ")   ", 4);
+			buf->len		+= 4;
+		}
+		FD_OUT_RESERVE(buf, 1);
+		buf->data[buf->len++]	 = '\n';
+	}
+}
 
 int main(int argc, char *argv[])
 {
-	int			 _n, _p, _i, _j;
+	int64_t			 _n, _p;
 
 	if (argc != 3) {
 		fprintf(stderr, "Usage: %s n p\n", argv[0]);
 		exit(1);
 	}
 
-	_n			= atoi(argv[1]);
-	_p			= atoi(argv[2]);
-
+	_n			= atoll(argv[1]);
+	_p			= atoll(argv[2]);
 
-	for (_i = 1; _i <= _n; _i++) {
-		for (_j = 1; _j <= _p; _j++) {
-			printf("(%2d, %2d)   ", _i, _j);
-		}
-		printf("\n");
+	/* The lines are formatted by chunks on all the processors, and
+	   written in their order
+	   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+	if (fd_output_run(1, _n, (11 * (size_t) _p) + 1, fd_format_lines, &_p,
+	                  sysconf(_SC_NPROCESSORS_ONLN)) < 0) {
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+		exit(1);
 	}
 
 	return 0;
@@ -1,35 +1,190 @@
 /*
- *	@(#)	[MB] fd_matrix_02.c	Version 1.1 du 23/07/08 - 
+ *	@(#)	[MB] fd_matrix_02.c	Version 1.6 du 24/08/10 - 
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "fd_format.h"
+#include "fd_simd.h"
+#include "fd_ansi.h"
+#include "fd_output.h"
+#include "fd_elt.h"
+#include "fd_bin.h"
 
-int main(int argc, char *argv[])
+/* Parameters of the dump
+   ~~~~~~~~~~~~~~~~~~~~~~ */
+struct fd_dump {
+	int64_t			 p;		// Matrix columns number
+	int			 color;		// ANSI colors
+	fd_scale		 scale;		// Scale of the values
+	int			 format;	// Output format (FD_BIN_*)
+	int			 elt_type;	// Type of the binary elements
+};
+typedef struct fd_dump		 fd_dump;
+typedef struct fd_dump		*fd_ref_dump;
+
+/******************************************************************************
+
+					FD_COMPUTE_LINE
+
+	Compute the values of line i of the matrix.
+
+******************************************************************************/
+void fd_compute_line(void *data, double *dst, int64_t i)
+{
+	fd_ref_dump		 _dump = data;
+
+	fd_simd_index(dst, _dump->p, i, 1, _dump->p);
+}
+
+/******************************************************************************
+
+					FD_FORMAT_LINES
+
+	Format lines i1 to i2 of the matrix : coordinates, values and an
+	empty line for each line.
+
+******************************************************************************/
+void fd_format_lines(void *data, fd_ref_out_buf buf, int64_t i1, int64_t i2)
 {
-	int			 _n, _p, _i, _j;
+	fd_ref_dump		 _dump = data;
+	int64_t			 _i, _j;
+	double			*_row;
+	short			*_colors;
 
-	if (argc != 3) {
-		fprintf(stderr, "Usage: %s n p\n", argv[0]);
+	if ((_row = malloc(_dump->p * sizeof(double))) == NULL
+	||  (_colors = calloc(_dump->p, sizeof(short))) == NULL) {
+		fprintf(stderr, "Malloc error !\n");
 		exit(1);
 	}
 
-	_n			= atoi(argv[1]);
-	_p			= atoi(argv[2]);
+	for (_i = i1; _i <= i2; _i++) {
+		for (_j = 1; _j <= _dump->p; _j++) {
+			FD_OUT_RESERVE(buf, FD_ANSI_MAX_LEN + 32);
+			buf->len		+= fd_ansi_coords(buf->data + buf->len, _i, _j, 2,
+							  _dump->color ? FD_ANSI_BLUE : FD_ANSI_NONE,
+							  FD_ANSI_NONE);
+			memcpy(buf->data + buf->len, "   ", 3);
+			buf->len		+= 3;
+		}
+		FD_OUT_RESERVE(buf, 1);
+		buf->data[buf->len++]	 = '\n';
+
+		fd_compute_line(_dump, _row, _i);
+		if (_dump->color) {
+			fd_scale_classify(&_dump->scale, _row, _dump->p, _colors);
+		}
+		for (_j = 1; _j <= _dump->p; _j++) {
+			FD_OUT_RESERVE(buf, FD_FMT_MAX_LEN + FD_ANSI_MAX_LEN + 16);
+			buf->len		+= fd_ansi_double(buf->data + buf->len, _row[_j - 1], 10,
+							  _colors[_j - 1]);
+			buf->data[buf->len++]	 = ' ';
+		}
+		FD_OUT_RESERVE(buf, 2);
+		buf->data[buf->len++]	 = '\n';
+		buf->data[buf->len++]	 = '\n';
+	}
+
+	free(_row);
+	free(_colors);
+}
+
+/******************************************************************************
+
+						MAIN
+
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+	int64_t			 _n;
+	int			 _opt;
+	fd_dump			 _dump;
+	static struct option	 _long_opts[] = {
+		{ "color",	optional_argument,	NULL, 'C' },
+		{ "format",	required_argument,	NULL, 'F' },
+		{ "type",	required_argument,	NULL, 't' },
+		{ NULL,		0,			NULL, 0   }
+	};
+
+	_dump.color		= 0;
+	_dump.format		= FD_BIN_TEXT;
+	_dump.elt_type		= FD_ELT_FLOAT64;
+
+	/* --color[=scale|@file] : ANSI colors, the values being colored
+	   by the scale
+	   --format=text|raw|npy : text, matrix file (see fd_mmap.h) or
+	   NumPy file, the binary values having the type of --type
+	   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+	while ((_opt = getopt_long(argc, argv, "", _long_opts, NULL)) != -1) {
+		switch (_opt) {
+
+		case 'C':
+			_dump.color		= 1;
+			if (fd_ansi_scale(&_dump.scale, optarg) < 0) {
+				fprintf(stderr, "%s: %s: %s\n", argv[0], optarg, strerror(errno));
+				exit(1);
+			}
+			break;
 
+		case 'F':
+			if ((_dump.format = fd_bin_format(optarg)) < 0) {
+				fprintf(stderr, "%s: unknown format \"%s\"\n", argv[0], optarg);
+				exit(1);
+			}
+			break;
 
-	for (_i = 1; _i <= _n; _i++) {
-		for (_j = 1; _j <= _p; _j++) {
-			printf("(%2d, %2d)   ", _i, _j);
+		case 't':
+			if ((_dump.elt_type = fd_elt_type(optarg)) == 0) {
+				fprintf(stderr, "%s: unknown type \"%s\"\n", argv[0], optarg);
+				exit(1);
+			}
+			break;
+
+		default:
+			argc			= 0;
+			break;
 		}
-		printf("\n");
+	}
+
+	if (argc - optind != 2 || (_dump.color && _dump.format != FD_BIN_TEXT)) {
+		fprintf(stderr, "Usage: %s [--color[=scale|@file]] n p\n", argv[0]);
+		fprintf(stderr, "       %s --format=raw|npy [--type=type] n p\n", argv[0]);
+		fprintf(stderr, "  type : int8, int16, int32, float32, float64 or complex128\n");
+		fprintf(stderr, "         (default : float64)\n");
+		exit(1);
+	}
 
-		for (_j = 1; _j <= _p; _j++) {
-			printf("%10f ", (double)((_i - 1) * _p) + _j);
+	_n			= atoll(argv[optind]);
+	_dump.p			= atoll(argv[optind + 1]);
+
+	/* Binary output : the lines are computed on all the processors,
+	   and written in place into a regular file
+	   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+	if (_dump.format != FD_BIN_TEXT) {
+		if (!fd_bin_fits(_dump.elt_type, 1, (double) _n * _dump.p)) {
+			fprintf(stderr, "%s: the values do not fit in %s elements\n", argv[0],
+			        fd_elt_name(_dump.elt_type));
+			exit(1);
+		}
+		if (fd_bin_run(1, _dump.format, _dump.elt_type, _n, _dump.p,
+		               fd_compute_line, &_dump, sysconf(_SC_NPROCESSORS_ONLN)) < 0) {
+			fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+			exit(1);
 		}
-		printf("\n");
+		return 0;
+	}
 
-		printf("\n");
+	/* The lines are formatted by chunks on all the processors, and
+	   written in their order
+	   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+	if (fd_output_run(1, _n, ((_dump.color ? 40 : 22) * (size_t) _dump.p) + 3,
+	                  fd_format_lines, &_dump, sysconf(_SC_NPROCESSORS_ONLN)) < 0) {
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+		exit(1);
 	}
 
 	return 0;
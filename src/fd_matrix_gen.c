@@ -0,0 +1,245 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_matrix_gen.c Version 1.2 du 24/08/10 -
+ *
+ *   Generate a binary matrix file (see fd_mmap.h) from a formula in i, j,
+ *   n and p (see fd_expr.c).
+ *
+ *   The threads take blocks of lines in turn, and compute them directly
+ *   into the mapped output file. The number of leading lines already
+ *   computed is kept up to date in the header, so that rectangle can
+ *   display the first lines while the others are computed.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "fd_elt.h"
+#include "fd_mmap.h"
+#include "fd_expr.h"
+
+// }}}
+// Macros definitions {{{
+/* Number of lines of a block, and maximum number of threads
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_GEN_LINES        (64)
+#define   FD_MAX_THREADS      (256)
+
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+
+// }}}
+// Structures definitions {{{
+struct fd_gen {
+     fd_expr              expr;    // Compiled formula
+     fd_mmap              out;     // Output file
+     int64_t              next;    // Next block of lines to compute
+     int64_t              nb_blocks; // Number of blocks of lines
+     char                *done;    // Blocks computed
+     int64_t              ready;   // Number of leading blocks computed
+     pthread_mutex_t      lock;    // Protects done and ready
+};
+typedef struct fd_gen               fd_gen;
+typedef struct fd_gen              *fd_ref_gen;
+
+// }}}
+
+// fd_gen_thread() {{{
+/******************************************************************************
+
+                         FD_GEN_THREAD
+
+     Compute blocks of lines into the output file. Elements other than
+     doubles are computed in a line of doubles, then converted.
+
+******************************************************************************/
+void *fd_gen_thread(void *arg)
+{
+     fd_ref_gen      _gen = arg;
+     fd_ref_mmap     _out;
+     double         *_work, *_line = NULL;
+     int64_t         _i, _i0;
+     char           *_dst;
+
+     _out           = &_gen->out;
+     if ((_work = fd_expr_workspace(&_gen->expr)) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     if (_out->elt_type != FD_ELT_FLOAT64
+     &&  (_line = malloc(_out->p * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     while ((_i0 = __atomic_fetch_add(&_gen->next, FD_GEN_LINES, __ATOMIC_RELAXED)) < _out->n) {
+          for (_i = _i0; _i < _i0 + FD_GEN_LINES && _i < _out->n; _i++) {
+               _dst           = _out->data + (_i * _out->stride);
+               if (_line == NULL) {
+                    fd_expr_eval_row(&_gen->expr, _work, _i + 1, 1, _out->p, (double *) _dst);
+               }
+               else {
+                    fd_expr_eval_row(&_gen->expr, _work, _i + 1, 1, _out->p, _line);
+                    fd_elt_from_double(_out->elt_type, _line, _out->p, _dst);
+               }
+          }
+
+          /* Publish the leading lines already computed
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          pthread_mutex_lock(&_gen->lock);
+          _gen->done[_i0 / FD_GEN_LINES]     = 1;
+          while (_gen->ready < _gen->nb_blocks && _gen->done[_gen->ready]) {
+               _gen->ready++;
+          }
+          fd_mmap_set_ready(_out, FD_MIN(_gen->ready * FD_GEN_LINES, _out->n));
+          pthread_mutex_unlock(&_gen->lock);
+     }
+
+     free(_line);
+     free(_work);
+
+     return NULL;
+}
+
+// }}}
+// fd_usage() {{{
+/******************************************************************************
+
+                              FD_USAGE
+
+******************************************************************************/
+void fd_usage(char *progname)
+{
+     fprintf(stderr, "Usage: %s [-t threads] [-e type] n p formula output\n", progname);
+     fprintf(stderr, "  -t : number of threads (default : number of processors)\n");
+     fprintf(stderr, "  -e : type of the elements : int8, int16, int32, float32, float64\n");
+     fprintf(stderr, "       or complex128 (default : float64)\n");
+     fprintf(stderr, "  formula : expression of element (i, j), for example\n");
+     fprintf(stderr, "       \"(n - abs(i - j)) * 10\" or \"(i - 1) * p + j\"\n");
+     exit(1);
+}
+
+// }}}
+// main() {{{
+/******************************************************************************
+
+                              MAIN
+
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+     int                  _opt, _nb_threads, _elt_type, _t;
+     fd_gen               _gen;
+     pthread_t            _threads[FD_MAX_THREADS];
+     struct timespec      _t0, _t1;
+     int64_t              _n, _p;
+     double               _elapsed, _size;
+
+     _nb_threads         = sysconf(_SC_NPROCESSORS_ONLN);
+     _elt_type           = FD_ELT_FLOAT64;
+
+     /* Check command arguments
+        ~~~~~~~~~~~~~~~~~~~~~~~ */
+     while ((_opt = getopt(argc, argv, "t:e:")) != -1) {
+          switch (_opt) {
+
+          case 't':
+               _nb_threads    = atoi(optarg);
+               break;
+
+          case 'e':
+               if ((_elt_type = fd_elt_type(optarg)) == 0) {
+                    fprintf(stderr, "%s: %s: unknown type !\n", argv[0], optarg);
+                    exit(1);
+               }
+               break;
+
+          default:
+               fd_usage(argv[0]);
+               break;
+          }
+     }
+
+     if (argc - optind != 4) {
+          fd_usage(argv[0]);
+     }
+
+     if (_nb_threads < 1) {
+          _nb_threads    = 1;
+     }
+     if (_nb_threads > FD_MAX_THREADS) {
+          _nb_threads    = FD_MAX_THREADS;
+     }
+
+     _n                  = atoll(argv[optind]);
+     _p                  = atoll(argv[optind + 1]);
+
+     if (fd_expr_compile(&_gen.expr, argv[optind + 2], _n, _p) < 0) {
+          fprintf(stderr, "%s: column %d: %s\n", argv[0], _gen.expr.err_pos + 1,
+                  _gen.expr.err_msg);
+          fprintf(stderr, "  %s\n  %*s^\n", argv[optind + 2], _gen.expr.err_pos, "");
+          exit(1);
+     }
+
+     clock_gettime(CLOCK_MONOTONIC, &_t0);
+
+     if (fd_mmap_create(&_gen.out, argv[optind + 3], _n, _p, _elt_type, 0) < 0) {
+          fprintf(stderr, "%s: %s: %s\n", argv[0], argv[optind + 3], strerror(errno));
+          exit(1);
+     }
+     _gen.next           = 0;
+     _gen.ready          = 0;
+     _gen.nb_blocks      = (_n + FD_GEN_LINES - 1) / FD_GEN_LINES;
+     if ((_gen.done = calloc(_gen.nb_blocks + 1, 1)) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+     pthread_mutex_init(&_gen.lock, NULL);
+
+     /* Compute the lines
+        ~~~~~~~~~~~~~~~~~ */
+     for (_t = 0; _t < _nb_threads; _t++) {
+          if (pthread_create(&_threads[_t], NULL, fd_gen_thread, &_gen) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+     for (_t = 0; _t < _nb_threads; _t++) {
+          pthread_join(_threads[_t], NULL);
+     }
+
+     pthread_mutex_destroy(&_gen.lock);
+     free(_gen.done);
+     fd_mmap_close(&_gen.out);
+
+     clock_gettime(CLOCK_MONOTONIC, &_t1);
+     _elapsed            = (_t1.tv_sec - _t0.tv_sec) + (_t1.tv_nsec - _t0.tv_nsec) / 1e9;
+     _size               = (double) _n * _p * fd_elt_size(_elt_type);
+
+     fprintf(stderr, "%s: %ld lines x %ld columns, %.1f MB in %.3f s (%.1f MB/s, %d threads)\n",
+             argv[0], (long) _n, (long) _p, _size / 1e6, _elapsed,
+             _size / 1e6 / _elapsed, _nb_threads);
+
+     return 0;
+}
+
+// }}}
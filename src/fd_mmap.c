@@ -0,0 +1,421 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_mmap.c Version 1.4 du 24/08/10 - 
+ *
+ *   Memory-mapped binary matrix files.
+ *
+ *   The whole file is mapped, but only the pages of the displayed elements
+ *   are read from the disk : files larger than the memory can be browsed.
+ *   The kernel read-ahead is disabled (MADV_RANDOM) and replaced by
+ *   MADV_WILLNEED hints on the elements next to the viewport, in the
+ *   direction of the last move.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fd_mmap.h"
+
+// }}}
+// fd_mmap_elt_size() {{{
+/******************************************************************************
+
+                         FD_MMAP_ELT_SIZE
+
+     Return the size of an element type, or 0 for an unknown type.
+
+******************************************************************************/
+int fd_mmap_elt_size(int elt_type)
+{
+     return fd_elt_size(elt_type);
+}
+
+// }}}
+// fd_mmap_setup() {{{
+/******************************************************************************
+
+                         FD_MMAP_SETUP
+
+     Check the header of a mapped file and initialize the descriptor.
+
+******************************************************************************/
+static int fd_mmap_setup(fd_ref_mmap map)
+{
+     fd_ref_mat_header    _hdr;
+     uint64_t             _line, _end;
+
+     if (map->size < sizeof(fd_mat_header)) {
+          return -1;
+     }
+
+     /* The sizes come from the file : any overflow rejects the header
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _hdr                = (fd_ref_mat_header) map->base;
+     if (memcmp(_hdr->magic, FD_MAT_MAGIC, sizeof(_hdr->magic)) != 0
+     ||  _hdr->version != FD_MAT_VERSION
+     ||  (map->elt_size = fd_mmap_elt_size(_hdr->elt_type)) == 0
+     ||  _hdr->n > INT64_MAX || _hdr->p > INT64_MAX
+     ||  __builtin_mul_overflow(_hdr->p, (uint64_t) map->elt_size, &_line)
+     ||  _hdr->stride < _line || _hdr->stride > INT64_MAX
+     ||  _hdr->offset < sizeof(fd_mat_header) || _hdr->offset > map->size
+     ||  _hdr->ready > _hdr->n) {
+          return -1;
+     }
+
+     /* The last line must be inside the file
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (_hdr->n > 0
+     &&  (__builtin_mul_overflow(_hdr->n - 1, _hdr->stride, &_end)
+     ||   __builtin_add_overflow(_end, _hdr->offset, &_end)
+     ||   __builtin_add_overflow(_end, _line, &_end)
+     ||   _end > map->size)) {
+          return -1;
+     }
+
+     map->elt_type       = _hdr->elt_type;
+     map->n              = _hdr->n;
+     map->p              = _hdr->p;
+     map->stride         = _hdr->stride;
+     map->data           = map->base + _hdr->offset;
+     map->hdr            = _hdr;
+
+     return 0;
+}
+
+// }}}
+// fd_mmap_open() {{{
+/******************************************************************************
+
+                         FD_MMAP_OPEN
+
+     Map a matrix file for reading.
+     Return 0, or -1 with errno set on error.
+
+******************************************************************************/
+int fd_mmap_open(fd_ref_mmap map, const char *path)
+{
+     struct stat     _st;
+     int             _errno;
+
+     memset(map, 0, sizeof(*map));
+
+     if ((map->fd = open(path, O_RDONLY)) < 0) {
+          return -1;
+     }
+
+     if (fstat(map->fd, &_st) < 0) {
+          goto error;
+     }
+     map->size      = _st.st_size;
+
+     if (map->size < sizeof(fd_mat_header)) {
+          errno          = EINVAL;
+          goto error;
+     }
+
+     if ((map->base = mmap(NULL, map->size, PROT_READ, MAP_SHARED,
+                           map->fd, 0)) == MAP_FAILED) {
+          map->base      = NULL;
+          goto error;
+     }
+
+     if (fd_mmap_setup(map) < 0) {
+          errno          = EINVAL;
+          goto error;
+     }
+
+     madvise(map->base, map->size, MADV_RANDOM);
+
+     return 0;
+
+error:
+     _errno         = errno;
+     fd_mmap_close(map);
+     errno          = _errno;
+
+     return -1;
+}
+
+// }}}
+// fd_mmap_create() {{{
+/******************************************************************************
+
+                         FD_MMAP_CREATE
+
+     Create a matrix file of n x p elements, and map it for writing.
+     The first ready lines are declared as written : a program filling the
+     file while it is displayed creates it with ready = 0, and calls
+     fd_mmap_set_ready() as it progresses.
+     Return 0, or -1 with errno set on error.
+
+******************************************************************************/
+int fd_mmap_create(fd_ref_mmap map, const char *path, int64_t n, int64_t p,
+                   int elt_type, int64_t ready)
+{
+     fd_mat_header   _hdr;
+     int             _elt_size, _errno;
+     int64_t         _stride, _size;
+
+     memset(map, 0, sizeof(*map));
+     map->fd        = -1;
+
+     if ((_elt_size = fd_mmap_elt_size(elt_type)) == 0 || n < 0 || p < 0
+     ||  ready < 0 || ready > n
+     ||  __builtin_mul_overflow(p, (int64_t) _elt_size, &_stride)
+     ||  __builtin_mul_overflow(n, _stride, &_size)
+     ||  __builtin_add_overflow(_size, (int64_t) FD_MAT_OFFSET, &_size)
+     ||  (uint64_t) _size > SIZE_MAX) {
+          errno          = EINVAL;
+          return -1;
+     }
+
+     memset(&_hdr, 0, sizeof(_hdr));
+     memcpy(_hdr.magic, FD_MAT_MAGIC, sizeof(_hdr.magic));
+     _hdr.version   = FD_MAT_VERSION;
+     _hdr.elt_type  = elt_type;
+     _hdr.n         = n;
+     _hdr.p         = p;
+     _hdr.stride    = _stride;
+     _hdr.offset    = FD_MAT_OFFSET;
+     _hdr.ready     = ready;
+
+     if ((map->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+          return -1;
+     }
+
+     map->size      = _size;
+     if (ftruncate(map->fd, map->size) < 0) {
+          goto error;
+     }
+
+     if ((map->base = mmap(NULL, map->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           map->fd, 0)) == MAP_FAILED) {
+          map->base      = NULL;
+          goto error;
+     }
+
+     memcpy(map->base, &_hdr, sizeof(_hdr));
+     fd_mmap_setup(map);
+
+     return 0;
+
+error:
+     _errno         = errno;
+     fd_mmap_close(map);
+     errno          = _errno;
+
+     return -1;
+}
+
+// }}}
+// fd_mmap_value() {{{
+/******************************************************************************
+
+                         FD_MMAP_VALUE
+
+     Return the value of element (i, j), numbered from 1.
+     Elements outside of the matrix are null.
+
+******************************************************************************/
+double fd_mmap_value(fd_ref_mmap map, int64_t i, int64_t j)
+{
+     char            *_elt;
+     double           _value;
+
+     if (i < 1 || i > map->n || j < 1 || j > map->p) {
+          return 0.0;
+     }
+
+     _elt           = map->data + ((i - 1) * map->stride) + ((j - 1) * map->elt_size);
+     fd_elt_to_double(map->elt_type, _elt, 1, &_value);
+
+     return _value;
+}
+
+// }}}
+// fd_mmap_set_value() {{{
+/******************************************************************************
+
+                         FD_MMAP_SET_VALUE
+
+     Set the value of element (i, j) of a created file.
+
+******************************************************************************/
+void fd_mmap_set_value(fd_ref_mmap map, int64_t i, int64_t j, double value)
+{
+     char            *_elt;
+
+     if (i < 1 || i > map->n || j < 1 || j > map->p) {
+          return;
+     }
+
+     _elt           = map->data + ((i - 1) * map->stride) + ((j - 1) * map->elt_size);
+     fd_elt_from_double(map->elt_type, &value, 1, _elt);
+}
+
+// }}}
+// fd_mmap_fill() {{{
+/******************************************************************************
+
+                         FD_MMAP_FILL
+
+     Copy the dx elements of line i starting at column j0 into elts, at
+     their native width. Elements outside of the matrix are null.
+
+******************************************************************************/
+void fd_mmap_fill(fd_ref_mmap map, int64_t i, int64_t j0, int64_t dx, void *elts)
+{
+     int64_t         _j1, _j2;
+     char           *_dst = elts;
+
+     _j1            = j0 < 1 ? 1 : j0;
+     _j2            = j0 + dx - 1 > map->p ? map->p : j0 + dx - 1;
+
+     if (i < 1 || i > map->n || _j1 > _j2) {
+          memset(_dst, 0, dx * map->elt_size);
+          return;
+     }
+
+     memset(_dst, 0, (_j1 - j0) * map->elt_size);
+     memcpy(_dst + ((_j1 - j0) * map->elt_size),
+            map->data + ((i - 1) * map->stride) + ((_j1 - 1) * map->elt_size),
+            (_j2 - _j1 + 1) * map->elt_size);
+     memset(_dst + ((_j2 - j0 + 1) * map->elt_size), 0, (j0 + dx - 1 - _j2) * map->elt_size);
+}
+
+// }}}
+// fd_mmap_ready() {{{
+/******************************************************************************
+
+                         FD_MMAP_READY
+
+     Return the number of leading lines already written in the file.
+
+******************************************************************************/
+int64_t fd_mmap_ready(fd_ref_mmap map)
+{
+     return __atomic_load_n(&map->hdr->ready, __ATOMIC_ACQUIRE);
+}
+
+// }}}
+// fd_mmap_set_ready() {{{
+/******************************************************************************
+
+                         FD_MMAP_SET_READY
+
+     Declare the first lines of the file as written.
+
+******************************************************************************/
+void fd_mmap_set_ready(fd_ref_mmap map, int64_t ready)
+{
+     __atomic_store_n(&map->hdr->ready, ready, __ATOMIC_RELEASE);
+}
+
+// }}}
+// fd_mmap_will_need() {{{
+/******************************************************************************
+
+                         FD_MMAP_WILL_NEED
+
+     Ask the kernel to read the pages of lines [i1, i2] from column j1 to
+     column j2 in advance.
+
+******************************************************************************/
+static void fd_mmap_will_need(fd_ref_mmap map, int64_t i1, int64_t i2,
+                              int64_t j1, int64_t j2)
+{
+     uintptr_t       _page, _start, _end;
+     int64_t         _i;
+
+     /* Clip the area to the matrix
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (i1 < 1)         i1   = 1;
+     if (j1 < 1)         j1   = 1;
+     if (i2 > map->n)    i2   = map->n;
+     if (j2 > map->p)    j2   = map->p;
+     if (i1 > i2 || j1 > j2) {
+          return;
+     }
+
+     _page          = sysconf(_SC_PAGESIZE);
+
+     for (_i = i1; _i <= i2; _i++) {
+          _start         = (uintptr_t) (map->data + ((_i - 1) * map->stride)
+                                                  + ((j1 - 1) * map->elt_size));
+          _end           = _start + ((j2 - j1 + 1) * map->elt_size);
+          _start        &= ~(_page - 1);
+
+          madvise((void *) _start, _end - _start, MADV_WILLNEED);
+     }
+}
+
+// }}}
+// fd_mmap_advise() {{{
+/******************************************************************************
+
+                         FD_MMAP_ADVISE
+
+     Prefetch the dy x dx elements next to the viewport whose upper left
+     element is (i0, j0), in the direction (di, dj) of the last move.
+
+******************************************************************************/
+void fd_mmap_advise(fd_ref_mmap map, int64_t i0, int64_t j0, int64_t dy,
+                    int64_t dx, int di, int dj)
+{
+     if (di > 0) {
+          fd_mmap_will_need(map, i0 + dy, i0 + (2 * dy) - 1, j0, j0 + dx - 1);
+     }
+     else if (di < 0) {
+          fd_mmap_will_need(map, i0 - dy, i0 - 1,            j0, j0 + dx - 1);
+     }
+
+     if (dj > 0) {
+          fd_mmap_will_need(map, i0, i0 + dy - 1, j0 + dx, j0 + (2 * dx) - 1);
+     }
+     else if (dj < 0) {
+          fd_mmap_will_need(map, i0, i0 + dy - 1, j0 - dx, j0 - 1);
+     }
+}
+
+// }}}
+// fd_mmap_close() {{{
+/******************************************************************************
+
+                         FD_MMAP_CLOSE
+
+     Unmap a matrix file.
+
+******************************************************************************/
+void fd_mmap_close(fd_ref_mmap map)
+{
+     if (map->base != NULL) {
+          munmap(map->base, map->size);
+          map->base      = NULL;
+     }
+
+     if (map->fd >= 0) {
+          close(map->fd);
+          map->fd        = -1;
+     }
+}
+
+// }}}
@@ -0,0 +1,94 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_mmap.h Version 1.3 du 24/08/10 - 
+ *
+ *   Memory-mapped binary matrix files.
+ */
+
+#ifndef FD_MMAP_H
+#define FD_MMAP_H
+
+// Includes {{{
+#include <stddef.h>
+#include <stdint.h>
+#include "fd_elt.h"
+
+// }}}
+// Macros definitions {{{
+/* File identification
+   ~~~~~~~~~~~~~~~~~~~ */
+#define   FD_MAT_MAGIC        "FDMATRIX"
+#define   FD_MAT_VERSION      (1)
+
+/* Offset of the first element in the created files
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_MAT_OFFSET       (64)
+
+// }}}
+// Structures definitions {{{
+/* Header of a matrix file : the n lines of p elements follow, stored in
+ * row-major order, starting at offset, with stride bytes between the first
+ * elements of two consecutive lines. All numbers use the native byte order.
+ * A program filling the file progressively (like csv_import) keeps in ready
+ * the number of leading lines already written.
+ */
+struct fd_mat_header {
+     char                 magic[8];          // FD_MAT_MAGIC
+     uint32_t             version;           // FD_MAT_VERSION
+     uint32_t             elt_type;          // Type of the elements
+     uint64_t             n;                 // Matrix lines number
+     uint64_t             p;                 // Matrix columns number
+     uint64_t             stride;            // Size of a line (in bytes)
+     uint64_t             offset;            // Offset of the first element
+     uint64_t             ready;             // Number of lines written
+};
+typedef struct fd_mat_header        fd_mat_header;
+typedef struct fd_mat_header       *fd_ref_mat_header;
+
+struct fd_mmap {
+     int                  fd;                // File descriptor
+     char                *base;              // Address of the mapping
+     size_t               size;              // Size of the mapping
+     char                *data;              // Address of the first element
+     int64_t              n;                 // Matrix lines number
+     int64_t              p;                 // Matrix columns number
+     size_t               stride;            // Size of a line (in bytes)
+     int                  elt_type;          // Type of the elements
+     int                  elt_size;          // Size of an element (in bytes)
+     fd_ref_mat_header    hdr;               // Header of the file
+};
+typedef struct fd_mmap              fd_mmap;
+typedef struct fd_mmap             *fd_ref_mmap;
+
+// }}}
+// Functions prototypes {{{
+int       fd_mmap_elt_size(int elt_type);
+int       fd_mmap_open(fd_ref_mmap map, const char *path);
+int       fd_mmap_create(fd_ref_mmap map, const char *path, int64_t n, int64_t p,
+                         int elt_type, int64_t ready);
+double    fd_mmap_value(fd_ref_mmap map, int64_t i, int64_t j);
+void      fd_mmap_set_value(fd_ref_mmap map, int64_t i, int64_t j, double value);
+void      fd_mmap_fill(fd_ref_mmap map, int64_t i, int64_t j0, int64_t dx, void *elts);
+int64_t   fd_mmap_ready(fd_ref_mmap map);
+void      fd_mmap_set_ready(fd_ref_mmap map, int64_t ready);
+void      fd_mmap_advise(fd_ref_mmap map, int64_t i0, int64_t j0, int64_t dy,
+                         int64_t dx, int di, int dj);
+void      fd_mmap_close(fd_ref_mmap map);
+
+// }}}
+
+#endif	/* FD_MMAP_H */
@@ -0,0 +1,255 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_output.c Version 1.1 du 24/08/09 -
+ *
+ *   Parallel output of the lines of the matrix dumpers, in their order.
+ *
+ *   The lines of the matrix are split into chunks, which the threads
+ *   format into the buffers of a ring of slots. The calling thread writes
+ *   the chunks in the order of the lines, gathering the consecutive chunks
+ *   already formatted in one writev() : the output is the same as the one
+ *   of a sequential formatting, and the memory used stays bounded, a
+ *   thread waiting for its slot to be written before formatting a chunk.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "fd_output.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+#define   FD_MAX(x, y)        ((x) > (y) ? (x) : (y))
+
+/* Maximum number of chunks written at once
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_OUT_MAX_IOV      (64)
+
+// }}}
+// Structures definitions {{{
+struct fd_output {
+     fd_out_format        format;  // Formatting function of the dumper
+     void                *data;    // Its data
+     int64_t              n;       // Number of lines of the matrix
+     int64_t              lines;   // Lines of a chunk
+     int64_t              nb_chunks; // Number of chunks
+     int64_t              next;    // Next chunk to format
+     int64_t              written; // Number of chunks written
+     int                  nb_slots; // Number of slots
+     fd_out_buf          *slots;   // Buffers of the chunks
+     int64_t             *done;    // Chunk formatted in a slot, plus 1
+     pthread_mutex_t      lock;    // Protects written and done
+     pthread_cond_t       cond;    // Signals a change of written or done
+};
+typedef struct fd_output            fd_output;
+typedef struct fd_output           *fd_ref_output;
+
+// }}}
+
+// fd_out_grow() {{{
+/******************************************************************************
+
+                         FD_OUT_GROW
+
+     Make room for n more characters in a buffer.
+
+******************************************************************************/
+void fd_out_grow(fd_ref_out_buf buf, size_t n)
+{
+     buf->size      = FD_MAX(2 * buf->size, buf->len + n);
+     if ((buf->data = realloc(buf->data, buf->size)) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+}
+
+// }}}
+// fd_output_thread() {{{
+/******************************************************************************
+
+                         FD_OUTPUT_THREAD
+
+     Format chunks of lines, each one once its slot has been written.
+
+******************************************************************************/
+static void *fd_output_thread(void *arg)
+{
+     fd_ref_output        _out = arg;
+     fd_ref_out_buf       _buf;
+     int64_t              _c, _i1;
+     int                  _s;
+
+     while ((_c = __atomic_fetch_add(&_out->next, 1, __ATOMIC_RELAXED)) < _out->nb_chunks) {
+          _s             = _c % _out->nb_slots;
+
+          pthread_mutex_lock(&_out->lock);
+          while (_c >= _out->written + _out->nb_slots) {
+               pthread_cond_wait(&_out->cond, &_out->lock);
+          }
+          pthread_mutex_unlock(&_out->lock);
+
+          _buf           = &_out->slots[_s];
+          _buf->len      = 0;
+          _i1            = (_c * _out->lines) + 1;
+          _out->format(_out->data, _buf, _i1, FD_MIN(_i1 + _out->lines - 1, _out->n));
+
+          pthread_mutex_lock(&_out->lock);
+          _out->done[_s] = _c + 1;
+          pthread_cond_broadcast(&_out->cond);
+          pthread_mutex_unlock(&_out->lock);
+     }
+
+     return NULL;
+}
+
+// }}}
+// fd_output_write() {{{
+/******************************************************************************
+
+                         FD_OUTPUT_WRITE
+
+     Write the nb buffers of iov to fd, resuming the partial writes.
+     Return 0, or -1 on error.
+
+******************************************************************************/
+static int fd_output_write(int fd, struct iovec *iov, int nb)
+{
+     ssize_t              _len;
+
+     while (nb > 0) {
+          if ((_len = writev(fd, iov, nb)) < 0) {
+               if (errno == EINTR) {
+                    continue;
+               }
+               return -1;
+          }
+
+          for ( ; nb > 0 && (size_t) _len >= iov->iov_len; iov++, nb--) {
+               _len          -= iov->iov_len;
+          }
+          if (nb > 0) {
+               iov->iov_base  = (char *) iov->iov_base + _len;
+               iov->iov_len  -= _len;
+          }
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_output_run() {{{
+/******************************************************************************
+
+                         FD_OUTPUT_RUN
+
+     Write the n lines of a matrix to fd, formatted by format() with
+     nb_threads threads. line_size is an estimate of the size of the output
+     of a line, which sets the size of the chunks.
+     Return 0, or -1 on a write error (errno being set).
+
+******************************************************************************/
+int fd_output_run(int fd, int64_t n, size_t line_size, fd_out_format format, void *data,
+                  int nb_threads)
+{
+     fd_output            _out;
+     pthread_t            _threads[FD_OUT_MAX_THREADS];
+     struct iovec         _iov[FD_OUT_MAX_IOV];
+     int64_t              _w;
+     int                  _k, _t, _s, _ret = 0, _err = 0;
+
+     if (nb_threads < 1) {
+          nb_threads     = 1;
+     }
+     if (nb_threads > FD_OUT_MAX_THREADS) {
+          nb_threads     = FD_OUT_MAX_THREADS;
+     }
+
+     _out.format    = format;
+     _out.data      = data;
+     _out.n         = n;
+     _out.lines     = FD_MAX(1, FD_OUT_CHUNK / FD_MAX(line_size, 1));
+     _out.nb_chunks = n > 0 ? ((n - 1) / _out.lines) + 1 : 0;
+     _out.next      = 0;
+     _out.written   = 0;
+     _out.nb_slots  = FD_OUT_SLOTS * nb_threads;
+     if ((_out.slots = calloc(_out.nb_slots, sizeof(fd_out_buf))) == NULL
+     ||  (_out.done  = calloc(_out.nb_slots, sizeof(int64_t))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+     pthread_mutex_init(&_out.lock, NULL);
+     pthread_cond_init(&_out.cond, NULL);
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          if (pthread_create(&_threads[_t], NULL, fd_output_thread, &_out) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+
+     /* Write the chunks in order
+        ~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_w = 0; _w < _out.nb_chunks; _w += _k) {
+          pthread_mutex_lock(&_out.lock);
+          while (_out.done[_w % _out.nb_slots] != _w + 1) {
+               pthread_cond_wait(&_out.cond, &_out.lock);
+          }
+          for (_k = 0; _k < FD_OUT_MAX_IOV && _w + _k < _out.nb_chunks
+                       && _out.done[(_w + _k) % _out.nb_slots] == _w + _k + 1; _k++) {
+               _s             = (_w + _k) % _out.nb_slots;
+               _iov[_k].iov_base   = _out.slots[_s].data;
+               _iov[_k].iov_len    = _out.slots[_s].len;
+          }
+          pthread_mutex_unlock(&_out.lock);
+
+          if (fd_output_write(fd, _iov, _k) < 0) {
+               _ret           = -1;
+               _err           = errno;
+               __atomic_store_n(&_out.next, _out.nb_chunks, __ATOMIC_RELAXED);
+               _k             = _out.nb_chunks;
+          }
+
+          pthread_mutex_lock(&_out.lock);
+          _out.written   = _w + _k;
+          pthread_cond_broadcast(&_out.cond);
+          pthread_mutex_unlock(&_out.lock);
+     }
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          pthread_join(_threads[_t], NULL);
+     }
+
+     for (_s = 0; _s < _out.nb_slots; _s++) {
+          free(_out.slots[_s].data);
+     }
+     free(_out.slots);
+     free(_out.done);
+     pthread_mutex_destroy(&_out.lock);
+     pthread_cond_destroy(&_out.cond);
+
+     errno          = _err;
+
+     return _ret;
+}
+
+// }}}
@@ -0,0 +1,68 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_output.h Version 1.1 du 24/08/09 -
+ *
+ *   Parallel output of the lines of the matrix dumpers, in their order.
+ */
+
+#ifndef FD_OUTPUT_H
+#define FD_OUTPUT_H
+
+// Includes {{{
+#include <stddef.h>
+#include <stdint.h>
+
+// }}}
+// Macros definitions {{{
+/* Target size of the output of a chunk of lines
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_OUT_CHUNK        (1 << 20)
+
+/* Chunks being formatted or waiting to be written, for each thread
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_OUT_SLOTS        (2)
+
+#define   FD_OUT_MAX_THREADS  (256)
+
+/* Make room for n more characters in a buffer
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_OUT_RESERVE(buf, n)   ((buf)->len + (n) > (buf)->size           \
+                                    ? fd_out_grow((buf), (n)) : (void) 0)
+
+// }}}
+// Structures definitions {{{
+struct fd_out_buf {
+     char                *data;    // Formatted characters
+     size_t               len;     // Number of characters
+     size_t               size;    // Allocated characters
+};
+typedef struct fd_out_buf           fd_out_buf;
+typedef struct fd_out_buf          *fd_ref_out_buf;
+
+/* Format lines i1 to i2 of the matrix (from 1) into buf
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+typedef void            (*fd_out_format)(void *data, fd_ref_out_buf buf, int64_t i1, int64_t i2);
+
+// }}}
+// Functions prototypes {{{
+void      fd_out_grow(fd_ref_out_buf buf, size_t n);
+int       fd_output_run(int fd, int64_t n, size_t line_size, fd_out_format format, void *data,
+                        int nb_threads);
+
+// }}}
+
+#endif	/* FD_OUTPUT_H */
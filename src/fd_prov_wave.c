@@ -0,0 +1,122 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_prov_wave.c Version 1.1 du 24/07/31 -
+ *
+ *   Sample provider plugin : a matrix of 10000 * sin(i / a) * cos(j / b).
+ *
+ *   Usage : rectangle -P ./prov_wave.so[:n,p,a,b] l c dy dx i0 j0
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include "fd_provider.h"
+
+// }}}
+// Structures definitions {{{
+struct fd_wave {
+     double               a;       // Period of the lines (in radians)
+     double               b;       // Period of the columns (in radians)
+};
+typedef struct fd_wave              fd_wave;
+typedef struct fd_wave             *fd_ref_wave;
+
+// }}}
+
+// fd_wave_fill() {{{
+/******************************************************************************
+
+                         FD_WAVE_FILL
+
+     The cosines of the columns are computed once per tile.
+
+******************************************************************************/
+static void fd_wave_fill(void *ctx, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                         void *elts)
+{
+     fd_ref_wave     _wave = ctx;
+     double         *_dst = elts, _sin;
+     int64_t         _i, _j;
+
+     for (_j = 0; _j < dx; _j++) {
+          _dst[_j]       = cos((j0 + _j) / _wave->b);
+     }
+
+     for (_i = dy - 1; _i >= 0; _i--) {
+          _sin           = 10000.0 * sin((i0 + _i) / _wave->a);
+          for (_j = 0; _j < dx; _j++) {
+               _dst[(_i * dx) + _j]     = _sin * _dst[_j];
+          }
+     }
+}
+
+// }}}
+// fd_wave_close() {{{
+/******************************************************************************
+
+                         FD_WAVE_CLOSE
+
+******************************************************************************/
+static void fd_wave_close(void *ctx)
+{
+     free(ctx);
+}
+
+// }}}
+// fd_provider_init() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_INIT
+
+     Describe the provider. arg is "n,p,a,b" (default : "1000000,1000000,50,80").
+
+******************************************************************************/
+int fd_provider_init(fd_ref_provider provider, const char *arg)
+{
+     fd_ref_wave     _wave;
+     long long       _n = 1000000, _p = 1000000;
+
+     if ((_wave = malloc(sizeof(*_wave))) == NULL) {
+          return -1;
+     }
+     _wave->a       = 50;
+     _wave->b       = 80;
+
+     if (arg != NULL
+     &&  (sscanf(arg, "%lld,%lld,%lf,%lf", &_n, &_p, &_wave->a, &_wave->b) != 4
+          || _n < 0 || _p < 0 || _wave->a == 0 || _wave->b == 0)) {
+          free(_wave);
+          errno          = EINVAL;
+          return -1;
+     }
+
+     provider->version   = FD_PROVIDER_VERSION;
+     provider->name      = "wave";
+     provider->n         = _n;
+     provider->p         = _p;
+     provider->elt_type  = FD_ELT_FLOAT64;
+     provider->ctx       = _wave;
+     provider->fill      = fd_wave_fill;
+     provider->close     = fd_wave_close;
+     provider->reentrant = 1;
+
+     return 0;
+}
+
+// }}}
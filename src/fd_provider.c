@@ -0,0 +1,595 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_provider.c Version 1.3 du 24/08/10 -
+ *
+ *   Providers of the elements of the displayed matrix.
+ *
+ *   The viewer asks a provider for a whole tile of elements at once. The
+ *   built-in providers compute a formula or read the matrix backends ;
+ *   other providers are loaded from shared objects exporting the function
+ *   FD_PROVIDER_INIT, which fills the fd_provider structure.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "fd_expr.h"
+#include "fd_provider.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+#define   FD_MAX(x, y)        ((x) > (y) ? (x) : (y))
+
+// }}}
+// Structures definitions {{{
+struct fd_gen {
+     fd_expr              expr;    // Compiled formula
+     double              *work;    // Registers of the evaluation
+     pthread_mutex_t      lock;    // Protects work
+};
+typedef struct fd_gen               fd_gen;
+typedef struct fd_gen              *fd_ref_gen;
+
+// }}}
+// Global variables {{{
+/* Message of the last error of a provider creation
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static char                         fd_provider_errmsg[256];
+
+// }}}
+
+// fd_provider_init() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_INIT
+
+     Initialize the fields common to all the providers.
+
+******************************************************************************/
+static void fd_provider_init(fd_ref_provider provider, const char *name, int64_t n,
+                             int64_t p, int elt_type, void *ctx)
+{
+     memset(provider, 0, sizeof(*provider));
+     provider->version   = FD_PROVIDER_VERSION;
+     provider->name      = name;
+     provider->n         = n;
+     provider->p         = p;
+     provider->elt_type  = elt_type;
+     provider->ctx       = ctx;
+}
+
+// }}}
+// fd_gen_fill() {{{
+/******************************************************************************
+
+                         FD_GEN_FILL
+
+     The registers of the provider are used by one thread at a time : the
+     other threads evaluate the formula in their own registers.
+
+******************************************************************************/
+static void fd_gen_fill(void *ctx, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                        void *elts)
+{
+     fd_ref_gen      _gen = ctx;
+     double         *_work;
+     int64_t         _k;
+
+     if (pthread_mutex_trylock(&_gen->lock) == 0) {
+          _work          = _gen->work;
+     }
+     else {
+          _work          = fd_expr_workspace(&_gen->expr);
+     }
+
+     for (_k = 0; _k < dy; _k++) {
+          fd_expr_eval_row(&_gen->expr, _work, i0 + _k, j0, dx,
+                           (double *) elts + (_k * dx));
+     }
+
+     if (_work == _gen->work) {
+          pthread_mutex_unlock(&_gen->lock);
+     }
+     else {
+          free(_work);
+     }
+}
+
+// }}}
+// fd_gen_close() {{{
+/******************************************************************************
+
+                         FD_GEN_CLOSE
+
+******************************************************************************/
+static void fd_gen_close(void *ctx)
+{
+     fd_ref_gen      _gen = ctx;
+
+     pthread_mutex_destroy(&_gen->lock);
+     free(_gen->work);
+     free(_gen);
+}
+
+// }}}
+// fd_provider_expr() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_EXPR
+
+     Provider of a n x p matrix generated by a formula (see fd_expr.c).
+     Return -1 on error, fd_provider_error() describing it.
+
+******************************************************************************/
+int fd_provider_expr(fd_ref_provider provider, int64_t n, int64_t p, const char *text)
+{
+     fd_ref_gen      _gen;
+
+     if ((_gen = malloc(sizeof(*_gen))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     if (fd_expr_compile(&_gen->expr, text, n, p) < 0) {
+          snprintf(fd_provider_errmsg, sizeof(fd_provider_errmsg), "column %d: %s",
+                   _gen->expr.err_pos + 1, _gen->expr.err_msg);
+          free(_gen);
+          return -1;
+     }
+     _gen->work     = fd_expr_workspace(&_gen->expr);
+     pthread_mutex_init(&_gen->lock, NULL);
+
+     fd_provider_init(provider, "formula", n, p, FD_ELT_FLOAT64, _gen);
+     provider->fill      = fd_gen_fill;
+     provider->close     = fd_gen_close;
+     provider->reentrant = 1;
+
+     return 0;
+}
+
+// }}}
+// fd_mmap_prov_fill() {{{
+/******************************************************************************
+
+                         FD_MMAP_PROV_FILL
+
+******************************************************************************/
+static void fd_mmap_prov_fill(void *ctx, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                              void *elts)
+{
+     fd_ref_mmap     _map = ctx;
+     int64_t         _k;
+
+     for (_k = 0; _k < dy; _k++) {
+          fd_mmap_fill(_map, i0 + _k, j0, dx, (char *) elts + (_k * dx * _map->elt_size));
+     }
+}
+
+// }}}
+// fd_mmap_prov_ready() {{{
+/******************************************************************************
+
+                         FD_MMAP_PROV_READY
+
+******************************************************************************/
+static int64_t fd_mmap_prov_ready(void *ctx)
+{
+     return fd_mmap_ready(ctx);
+}
+
+// }}}
+// fd_mmap_prov_prefetch() {{{
+/******************************************************************************
+
+                         FD_MMAP_PROV_PREFETCH
+
+******************************************************************************/
+static void fd_mmap_prov_prefetch(void *ctx, int64_t i0, int64_t j0, int64_t dy,
+                                  int64_t dx, int di, int dj)
+{
+     fd_mmap_advise(ctx, i0, j0, dy, dx, di, dj);
+}
+
+// }}}
+// fd_mmap_prov_close() {{{
+/******************************************************************************
+
+                         FD_MMAP_PROV_CLOSE
+
+******************************************************************************/
+static void fd_mmap_prov_close(void *ctx)
+{
+     fd_mmap_close(ctx);
+}
+
+// }}}
+// fd_provider_mmap() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_MMAP
+
+     Provider of an opened matrix file, which is closed with the provider.
+
+******************************************************************************/
+void fd_provider_mmap(fd_ref_provider provider, fd_ref_mmap map)
+{
+     fd_provider_init(provider, "file", map->n, map->p, map->elt_type, map);
+     provider->fill      = fd_mmap_prov_fill;
+     provider->ready     = fd_mmap_prov_ready;
+     provider->prefetch  = fd_mmap_prov_prefetch;
+     provider->close     = fd_mmap_prov_close;
+     provider->reentrant = 1;
+}
+
+// }}}
+// fd_sparse_prov_fill() {{{
+/******************************************************************************
+
+                         FD_SPARSE_PROV_FILL
+
+******************************************************************************/
+static void fd_sparse_prov_fill(void *ctx, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                                void *elts)
+{
+     int64_t         _k;
+
+     for (_k = 0; _k < dy; _k++) {
+          fd_sparse_fill_row(ctx, i0 + _k, j0, dx, (double *) elts + (_k * dx));
+     }
+}
+
+// }}}
+// fd_sparse_prov_close() {{{
+/******************************************************************************
+
+                         FD_SPARSE_PROV_CLOSE
+
+******************************************************************************/
+static void fd_sparse_prov_close(void *ctx)
+{
+     fd_sparse_free(ctx);
+}
+
+// }}}
+// fd_provider_sparse() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_SPARSE
+
+     Provider of a loaded sparse matrix, which is freed with the provider.
+
+******************************************************************************/
+void fd_provider_sparse(fd_ref_provider provider, fd_ref_csr csr)
+{
+     fd_provider_init(provider, "sparse", csr->n, csr->p, FD_ELT_FLOAT64, csr);
+     provider->fill      = fd_sparse_prov_fill;
+     provider->close     = fd_sparse_prov_close;
+     provider->reentrant = 1;
+}
+
+// }}}
+// fd_tiled_prov_fill() {{{
+/******************************************************************************
+
+                         FD_TILED_PROV_FILL
+
+******************************************************************************/
+static void fd_tiled_prov_fill(void *ctx, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                               void *elts)
+{
+     fd_tiled_fill(ctx, i0, j0, dy, dx, elts);
+}
+
+// }}}
+// fd_tiled_prov_close() {{{
+/******************************************************************************
+
+                         FD_TILED_PROV_CLOSE
+
+******************************************************************************/
+static void fd_tiled_prov_close(void *ctx)
+{
+     fd_tiled_free(ctx);
+}
+
+// }}}
+// fd_provider_tiled() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_TILED
+
+     Provider of a matrix loaded in tiles, which are freed with the provider.
+
+******************************************************************************/
+void fd_provider_tiled(fd_ref_provider provider, fd_ref_tiled tiled)
+{
+     fd_provider_init(provider, "tiled", tiled->n, tiled->p, tiled->elt_type, tiled);
+     provider->fill      = fd_tiled_prov_fill;
+     provider->close     = fd_tiled_prov_close;
+     provider->reentrant = 1;
+}
+
+// }}}
+// fd_ctiled_prov_fill() {{{
+/******************************************************************************
+
+                         FD_CTILED_PROV_FILL
+
+******************************************************************************/
+static void fd_ctiled_prov_fill(void *ctx, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                                void *elts)
+{
+     fd_ref_ctiled   _ctiled = ctx;
+     int64_t         _k;
+
+     for (_k = 0; _k < dy; _k++) {
+          fd_ctile_fill_row(_ctiled, i0 + _k, j0, dx,
+                            (char *) elts + (_k * dx * _ctiled->elt_size));
+     }
+}
+
+// }}}
+// fd_ctiled_prov_prefetch() {{{
+/******************************************************************************
+
+                         FD_CTILED_PROV_PREFETCH
+
+******************************************************************************/
+static void fd_ctiled_prov_prefetch(void *ctx, int64_t i0, int64_t j0, int64_t dy,
+                                    int64_t dx, int di, int dj)
+{
+     fd_ctile_prefetch(ctx, i0, j0, dy, dx, di, dj);
+}
+
+// }}}
+// fd_ctiled_prov_close() {{{
+/******************************************************************************
+
+                         FD_CTILED_PROV_CLOSE
+
+******************************************************************************/
+static void fd_ctiled_prov_close(void *ctx)
+{
+     fd_ctile_free(ctx);
+}
+
+// }}}
+// fd_provider_ctiled() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_CTILED
+
+     Provider of a matrix compressed in tiles, which are freed with the
+     provider.
+
+******************************************************************************/
+void fd_provider_ctiled(fd_ref_provider provider, fd_ref_ctiled ctiled)
+{
+     fd_provider_init(provider, "compressed", ctiled->n, ctiled->p, ctiled->elt_type, ctiled);
+     provider->fill      = fd_ctiled_prov_fill;
+     provider->prefetch  = fd_ctiled_prov_prefetch;
+     provider->close     = fd_ctiled_prov_close;
+}
+
+// }}}
+// fd_provider_open() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_OPEN
+
+     Load the provider of a shared object, whose initialization function
+     receives arg. Return -1 on error, fd_provider_error() describing it.
+
+******************************************************************************/
+int fd_provider_open(fd_ref_provider provider, const char *path, const char *arg)
+{
+     void                     *_handle;
+     fd_provider_init_fct      _init;
+
+     if ((_handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+          snprintf(fd_provider_errmsg, sizeof(fd_provider_errmsg), "%s", dlerror());
+          return -1;
+     }
+
+     if ((_init = (fd_provider_init_fct) dlsym(_handle, FD_PROVIDER_INIT)) == NULL) {
+          snprintf(fd_provider_errmsg, sizeof(fd_provider_errmsg), "%s", dlerror());
+          dlclose(_handle);
+          return -1;
+     }
+
+     fd_provider_init(provider, path, 0, 0, FD_ELT_FLOAT64, NULL);
+     if ((*_init)(provider, arg) < 0) {
+          snprintf(fd_provider_errmsg, sizeof(fd_provider_errmsg), "%s",
+                   strerror(errno));
+          dlclose(_handle);
+          return -1;
+     }
+
+     /* Check the description of the provider
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (provider->version != FD_PROVIDER_VERSION) {
+          snprintf(fd_provider_errmsg, sizeof(fd_provider_errmsg),
+                   "interface version %d instead of %d", provider->version,
+                   FD_PROVIDER_VERSION);
+          goto invalid;
+     }
+     if (provider->fill == NULL || provider->n < 0 || provider->p < 0
+     ||  fd_elt_size(provider->elt_type) == 0) {
+          snprintf(fd_provider_errmsg, sizeof(fd_provider_errmsg),
+                   "invalid provider description");
+          goto invalid;
+     }
+
+     provider->handle    = _handle;
+
+     return 0;
+
+invalid:
+     if (provider->close != NULL) {
+          (*provider->close)(provider->ctx);
+     }
+     dlclose(_handle);
+
+     return -1;
+}
+
+// }}}
+// fd_provider_error() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_ERROR
+
+     Return the message of the last error of fd_provider_expr() or of
+     fd_provider_open().
+
+******************************************************************************/
+const char *fd_provider_error(void)
+{
+     return fd_provider_errmsg;
+}
+
+// }}}
+// fd_provider_fill() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_FILL
+
+     Copy the dy x dx elements of the sub-matrix starting at (i0, j0) into
+     elts, line by line. Elements outside of the matrix are null : the
+     provider only fills the part of the tile inside of the matrix, at the
+     beginning of elts, and its lines are then moved to their place. No
+     buffer is shared, so that reentrant providers may be called by several
+     threads at once.
+
+******************************************************************************/
+void fd_provider_fill(fd_ref_provider provider, int64_t i0, int64_t j0, int64_t dy,
+                      int64_t dx, void *elts)
+{
+     int64_t         _i1, _j1, _i2, _j2, _l, _w, _sz;
+     char           *_dst = elts, *_line;
+
+     if (dy <= 0 || dx <= 0) {
+          return;
+     }
+
+     if (i0 >= 1 && j0 >= 1 && i0 + dy - 1 <= provider->n && j0 + dx - 1 <= provider->p) {
+          (*provider->fill)(provider->ctx, i0, j0, dy, dx, elts);
+          return;
+     }
+
+     /* Tile crossing the borders of the matrix
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _sz            = fd_elt_size(provider->elt_type);
+
+     _i1            = FD_MAX(i0, 1);
+     _j1            = FD_MAX(j0, 1);
+     _i2            = FD_MIN(i0 + dy - 1, provider->n);
+     _j2            = FD_MIN(j0 + dx - 1, provider->p);
+     if (_i1 > _i2 || _j1 > _j2) {
+          memset(_dst, 0, dy * dx * _sz);
+          return;
+     }
+
+     _w             = _j2 - _j1 + 1;
+     (*provider->fill)(provider->ctx, _i1, _j1, _i2 - _i1 + 1, _w, elts);
+
+     /* Move the lines from the last one : the place of a line is never
+        before its position in the filled part, nor over a line not moved yet
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_l = _i2 - _i1; _l >= 0; _l--) {
+          memmove(_dst + ((((_i1 - i0 + _l) * dx) + (_j1 - j0)) * _sz),
+                  _dst + (_l * _w * _sz), _w * _sz);
+     }
+
+     /* Clear the elements outside of the matrix
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_l = 0; _l < dy; _l++) {
+          _line          = _dst + (_l * dx * _sz);
+          if (i0 + _l < _i1 || i0 + _l > _i2) {
+               memset(_line, 0, dx * _sz);
+          }
+          else {
+               memset(_line, 0, (_j1 - j0) * _sz);
+               memset(_line + ((_j1 - j0 + _w) * _sz), 0, (j0 + dx - 1 - _j2) * _sz);
+          }
+     }
+}
+
+// }}}
+// fd_provider_ready() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_READY
+
+     Return the number of leading lines already available.
+
+******************************************************************************/
+int64_t fd_provider_ready(fd_ref_provider provider)
+{
+     if (provider->ready == NULL) {
+          return provider->n;
+     }
+
+     return (*provider->ready)(provider->ctx);
+}
+
+// }}}
+// fd_provider_prefetch() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_PREFETCH
+
+     Prepare the elements the next move in direction (di, dj) from the
+     dy x dx viewport at (i0, j0) will probably need.
+
+******************************************************************************/
+void fd_provider_prefetch(fd_ref_provider provider, int64_t i0, int64_t j0, int64_t dy,
+                          int64_t dx, int di, int dj)
+{
+     if (provider->prefetch != NULL) {
+          (*provider->prefetch)(provider->ctx, i0, j0, dy, dx, di, dj);
+     }
+}
+
+// }}}
+// fd_provider_close() {{{
+/******************************************************************************
+
+                         FD_PROVIDER_CLOSE
+
+     Free the resources of a provider, and unload its shared object.
+
+******************************************************************************/
+void fd_provider_close(fd_ref_provider provider)
+{
+     if (provider->close != NULL) {
+          (*provider->close)(provider->ctx);
+     }
+
+     if (provider->handle != NULL) {
+          dlclose(provider->handle);
+     }
+
+     provider->handle    = NULL;
+}
+
+// }}}
@@ -0,0 +1,109 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_provider.h Version 1.4 du 24/08/10 -
+ *
+ *   Providers of the elements of the displayed matrix.
+ */
+
+#ifndef FD_PROVIDER_H
+#define FD_PROVIDER_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_elt.h"
+#include "fd_mmap.h"
+#include "fd_sparse.h"
+#include "fd_tiled.h"
+#include "fd_ctile.h"
+
+// }}}
+// Macros definitions {{{
+/* Version of the interface, checked when a plugin is loaded
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_PROVIDER_VERSION (2)
+
+/* Name of the function a plugin must export, of type fd_provider_init_fct
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_PROVIDER_INIT    "fd_provider_init"
+
+// }}}
+// Structures definitions {{{
+/* A provider fills rectangular tiles of elements of its matrix in one call :
+ *   fill     : copy the dy x dx elements of the sub-matrix starting at
+ *              (i0, j0) into elts, line by line, as elements of elt_type.
+ *              The sub-matrix is always inside of the matrix.
+ *   ready    : number of leading lines already available (NULL : all of
+ *              them).
+ *   prefetch : prepare the elements the next move in direction (di, dj)
+ *              will probably need (NULL : nothing to prepare).
+ *   close    : free the resources of the provider (NULL : nothing to free).
+ *
+ * fill, prefetch and close may be called by different threads, but never at
+ * the same time : in rectangle, the worker of the cache calls fill and
+ * prefetch, and the display thread calls fill (searches, statistics,
+ * pyramid, percentiles) only before the worker is started or while it is
+ * paused by fd_cache_pause() / fd_cache_resume(), and close once the worker
+ * is stopped. These calls need no lock, but must not rely on data private
+ * to a thread. ready may be called by another thread at the same time as
+ * any of them. If reentrant is set, fill may also be called by several
+ * threads at once (for example by the threads of a search) : it must then
+ * not modify the context.
+ */
+struct fd_provider {
+     int                  version; // FD_PROVIDER_VERSION
+     const char          *name;    // Name of the provider
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int                  elt_type; // Type of the elements
+     void                *ctx;     // Private data of the provider
+     void               (*fill)(void *ctx, int64_t i0, int64_t j0, int64_t dy,
+                                int64_t dx, void *elts);
+     int64_t            (*ready)(void *ctx);
+     void               (*prefetch)(void *ctx, int64_t i0, int64_t j0, int64_t dy,
+                                    int64_t dx, int di, int dj);
+     void               (*close)(void *ctx);
+     int                  reentrant; // fill may be called by several threads at once
+
+     /* Managed by fd_provider.c
+        ~~~~~~~~~~~~~~~~~~~~~~~~ */
+     void                *handle;  // Shared object of a plugin (or NULL)
+};
+typedef struct fd_provider          fd_provider;
+typedef struct fd_provider         *fd_ref_provider;
+
+typedef int             (*fd_provider_init_fct)(fd_ref_provider provider, const char *arg);
+
+// }}}
+// Functions prototypes {{{
+int       fd_provider_expr(fd_ref_provider provider, int64_t n, int64_t p,
+                           const char *text);
+void      fd_provider_mmap(fd_ref_provider provider, fd_ref_mmap map);
+void      fd_provider_sparse(fd_ref_provider provider, fd_ref_csr csr);
+void      fd_provider_tiled(fd_ref_provider provider, fd_ref_tiled tiled);
+void      fd_provider_ctiled(fd_ref_provider provider, fd_ref_ctiled ctiled);
+int       fd_provider_open(fd_ref_provider provider, const char *path, const char *arg);
+const char *fd_provider_error(void);
+void      fd_provider_fill(fd_ref_provider provider, int64_t i0, int64_t j0, int64_t dy,
+                           int64_t dx, void *elts);
+int64_t   fd_provider_ready(fd_ref_provider provider);
+void      fd_provider_prefetch(fd_ref_provider provider, int64_t i0, int64_t j0,
+                               int64_t dy, int64_t dx, int di, int dj);
+void      fd_provider_close(fd_ref_provider provider);
+
+// }}}
+
+#endif	/* FD_PROVIDER_H */
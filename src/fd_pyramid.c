@@ -0,0 +1,361 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_pyramid.c Version 1.2 du 24/08/10 -
+ *
+ *   Pyramid of the aggregates (minimum, maximum, mean) of square blocks of
+ *   a matrix, for a zoomed out display.
+ *
+ *   The finest level has the smallest blocks (a power of 2) such that it
+ *   holds at most FD_PYR_MAX_BLOCKS blocks : its lines of blocks are
+ *   computed in parallel from the elements of the provider. Each other
+ *   level is computed from the previous one, four blocks giving one.
+ *   Once the pyramid is built, a block of any size costs a single read,
+ *   except for the blocks smaller than those of the finest level, which
+ *   are computed from their elements.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "fd_elt.h"
+#include "fd_pyramid.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+#define   FD_DIV_UP(x, y)     (((x) + (y) - 1) / (y))
+
+// }}}
+// Structures definitions {{{
+struct fd_pyr_build {
+     fd_ref_pyramid       pyr;     // Pyramid being built
+     int                  shift;   // log2 of the block of level 0
+     int64_t              next;    // Next line of blocks of level 0
+};
+typedef struct fd_pyr_build         fd_pyr_build;
+typedef struct fd_pyr_build        *fd_ref_pyr_build;
+
+// }}}
+
+// fd_pyramid_thread() {{{
+/******************************************************************************
+
+                         FD_PYRAMID_THREAD
+
+     Compute lines of blocks of level 0 from the elements of the provider.
+
+******************************************************************************/
+static void *fd_pyramid_thread(void *arg)
+{
+     fd_ref_pyr_build     _build = arg;
+     fd_ref_pyramid       _pyr = _build->pyr;
+     fd_ref_provider      _provider = _pyr->provider;
+     fd_ref_pyr_level     _level = &_pyr->levels[0];
+     fd_ref_aggr          _aggr;
+     char                *_elts;
+     double              *_values, *_sums, *_counts, *_mins, *_maxs, _v;
+     int64_t              _bi, _bj, _l, _l1, _c, _w, _k, _p;
+
+     _p             = _level->p;
+     if ((_elts   = malloc(FD_PYR_CHUNK * FD_ELT_MAX_SIZE)) == NULL
+     ||  (_values = malloc(FD_PYR_CHUNK * sizeof(double))) == NULL
+     ||  (_sums   = malloc(4 * _p * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+     _counts        = _sums   + _p;
+     _mins          = _counts + _p;
+     _maxs          = _mins   + _p;
+
+     while ((_bi = __atomic_fetch_add(&_build->next, 1, __ATOMIC_RELAXED)) < _level->n) {
+          for (_bj = 0; _bj < _p; _bj++) {
+               _sums[_bj]     = 0.0;
+               _counts[_bj]   = 0.0;
+               _mins[_bj]     = INFINITY;
+               _maxs[_bj]     = -INFINITY;
+          }
+
+          /* Accumulate the available lines of the blocks
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _l1            = FD_MIN((_bi + 1) * _level->block, _pyr->ready);
+          for (_l = _bi * _level->block; _l < _l1; _l++) {
+               for (_c = 0; _c < _provider->p; _c += _w) {
+                    _w             = FD_MIN(FD_PYR_CHUNK, _provider->p - _c);
+                    fd_provider_fill(_provider, _l + 1, _c + 1, 1, _w, _elts);
+                    fd_elt_to_double(_provider->elt_type, _elts, _w, _values);
+
+                    for (_k = 0; _k < _w; _k++) {
+                         _v             = _values[_k];
+                         if (_v != _v) {
+                              continue;
+                         }
+                         _bj            = (_c + _k) >> _build->shift;
+                         _sums[_bj]    += _v;
+                         _counts[_bj]  += 1.0;
+                         if (_v < _mins[_bj]) {
+                              _mins[_bj]     = _v;
+                         }
+                         if (_v > _maxs[_bj]) {
+                              _maxs[_bj]     = _v;
+                         }
+                    }
+               }
+          }
+
+          _aggr          = _level->aggr + (_bi * _p);
+          for (_bj = 0; _bj < _p; _bj++) {
+               _aggr[_bj].count    = _counts[_bj];
+               _aggr[_bj].min      = _mins[_bj];
+               _aggr[_bj].max      = _maxs[_bj];
+               _aggr[_bj].mean     = _counts[_bj] > 0 ? _sums[_bj] / _counts[_bj] : 0.0;
+          }
+     }
+
+     free(_elts);
+     free(_values);
+     free(_sums);
+
+     return NULL;
+}
+
+// }}}
+// fd_pyramid_reduce() {{{
+/******************************************************************************
+
+                         FD_PYRAMID_REDUCE
+
+     Compute the blocks of a level from the blocks of the previous level.
+
+******************************************************************************/
+static void fd_pyramid_reduce(fd_ref_pyr_level level, fd_ref_pyr_level prev)
+{
+     fd_ref_aggr          _dst, _src;
+     int64_t              _bi, _bj, _i, _j, _count;
+     double               _sum;
+
+     for (_bi = 0; _bi < level->n; _bi++) {
+          for (_bj = 0; _bj < level->p; _bj++) {
+               _dst           = level->aggr + (_bi * level->p) + _bj;
+               _dst->min      = INFINITY;
+               _dst->max      = -INFINITY;
+               _sum           = 0.0;
+               _count         = 0;
+
+               for (_i = 2 * _bi; _i < FD_MIN(2 * _bi + 2, prev->n); _i++) {
+                    for (_j = 2 * _bj; _j < FD_MIN(2 * _bj + 2, prev->p); _j++) {
+                         _src           = prev->aggr + (_i * prev->p) + _j;
+                         if (_src->count == 0) {
+                              continue;
+                         }
+                         _sum          += (double) _src->mean * _src->count;
+                         _count        += _src->count;
+                         if (_src->min < _dst->min) {
+                              _dst->min      = _src->min;
+                         }
+                         if (_src->max > _dst->max) {
+                              _dst->max      = _src->max;
+                         }
+                    }
+               }
+
+               _dst->count    = _count;
+               _dst->mean     = _count > 0 ? _sum / _count : 0.0;
+          }
+     }
+}
+
+// }}}
+// fd_pyramid_build() {{{
+/******************************************************************************
+
+                         FD_PYRAMID_BUILD
+
+     Build the pyramid of the lines of the matrix already available, with
+     nb_threads threads if the provider is reentrant. The pyramid must have
+     been zeroed, or built before.
+
+******************************************************************************/
+void fd_pyramid_build(fd_ref_pyramid pyr, fd_ref_provider provider, int nb_threads)
+{
+     fd_pyr_build         _build;
+     fd_ref_pyr_level     _level;
+     pthread_t            _threads[FD_PYR_MAX_THREADS];
+     int64_t              _block;
+     int                  _k, _t;
+
+     fd_pyramid_free(pyr);
+     pyr->provider  = provider;
+     pyr->ready     = fd_provider_ready(provider);
+
+     /* Levels of the pyramid
+        ~~~~~~~~~~~~~~~~~~~~~ */
+     for (_block = 1, _build.shift = 0;
+          FD_DIV_UP(provider->n, _block) * FD_DIV_UP(provider->p, _block) > FD_PYR_MAX_BLOCKS;
+          _block *= 2, _build.shift++) {
+          ;
+     }
+
+     for (_k = 0; _k < FD_PYR_MAX_LEVELS; _k++, _block *= 2) {
+          _level         = &pyr->levels[_k];
+          _level->block  = _block;
+          _level->n      = FD_DIV_UP(provider->n, _block);
+          _level->p      = FD_DIV_UP(provider->p, _block);
+          if ((_level->aggr = calloc(_level->n * _level->p, sizeof(fd_aggr))) == NULL) {
+               fprintf(stderr, "Malloc error !\n");
+               exit(1);
+          }
+          pyr->nb_levels = _k + 1;
+          if (_level->n <= 1 && _level->p <= 1) {
+               break;
+          }
+     }
+
+     /* Elements of the blocks smaller than those of level 0
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _block         = pyr->levels[0].block / 2;
+     if (_block > 0
+     &&  ((pyr->elts   = malloc(_block * _block * FD_ELT_MAX_SIZE)) == NULL
+     ||   (pyr->values = malloc(_block * _block * sizeof(double))) == NULL)) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     /* Level 0, from the elements
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (!provider->reentrant || nb_threads < 1) {
+          nb_threads     = 1;
+     }
+     if (nb_threads > FD_PYR_MAX_THREADS) {
+          nb_threads     = FD_PYR_MAX_THREADS;
+     }
+
+     _build.pyr     = pyr;
+     _build.next    = 0;
+     for (_t = 1; _t < nb_threads; _t++) {
+          if (pthread_create(&_threads[_t], NULL, fd_pyramid_thread, &_build) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+     fd_pyramid_thread(&_build);
+     for (_t = 1; _t < nb_threads; _t++) {
+          pthread_join(_threads[_t], NULL);
+     }
+
+     /* Other levels, from the previous ones
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_k = 1; _k < pyr->nb_levels; _k++) {
+          fd_pyramid_reduce(&pyr->levels[_k], &pyr->levels[_k - 1]);
+     }
+}
+
+// }}}
+// fd_pyramid_get() {{{
+/******************************************************************************
+
+                         FD_PYRAMID_GET
+
+     Get the aggregates of the block of size block (a power of 2) whose
+     first element is (i, j), i - 1 and j - 1 being multiples of block.
+
+******************************************************************************/
+void fd_pyramid_get(fd_ref_pyramid pyr, int64_t i, int64_t j, int64_t block,
+                    fd_ref_aggr aggr)
+{
+     fd_ref_pyr_level     _level;
+     fd_ref_provider      _provider = pyr->provider;
+     int64_t              _bi, _bj, _dy, _dx, _k, _nb;
+     double               _v, _sum;
+     int                  _l;
+
+     memset(aggr, 0, sizeof(*aggr));
+
+     if (block >= pyr->levels[0].block) {
+          /* Block of a level of the pyramid
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          for (_l = 0; _l < pyr->nb_levels - 1 && pyr->levels[_l].block < block; _l++) {
+               ;
+          }
+          _level         = &pyr->levels[_l];
+          _bi            = (i - 1) / _level->block;
+          _bj            = (j - 1) / _level->block;
+          if (i >= 1 && j >= 1 && _bi < _level->n && _bj < _level->p) {
+               *aggr          = _level->aggr[(_bi * _level->p) + _bj];
+          }
+          return;
+     }
+
+     /* Smaller block, from its elements
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _dy            = FD_MIN(block, pyr->ready - i + 1);
+     _dx            = FD_MIN(block, _provider->p - j + 1);
+     if (i < 1 || j < 1 || _dy <= 0 || _dx <= 0) {
+          return;
+     }
+
+     _nb            = _dy * _dx;
+     fd_provider_fill(_provider, i, j, _dy, _dx, pyr->elts);
+     fd_elt_to_double(_provider->elt_type, pyr->elts, _nb, pyr->values);
+
+     aggr->min      = INFINITY;
+     aggr->max      = -INFINITY;
+     _sum           = 0.0;
+     for (_k = 0; _k < _nb; _k++) {
+          _v             = pyr->values[_k];
+          if (_v != _v) {
+               continue;
+          }
+          _sum          += _v;
+          aggr->count   += 1;
+          if (_v < aggr->min) {
+               aggr->min      = _v;
+          }
+          if (_v > aggr->max) {
+               aggr->max      = _v;
+          }
+     }
+     aggr->mean     = aggr->count > 0 ? _sum / aggr->count : 0.0;
+}
+
+// }}}
+// fd_pyramid_free() {{{
+/******************************************************************************
+
+                         FD_PYRAMID_FREE
+
+     Free the levels of a pyramid.
+
+******************************************************************************/
+void fd_pyramid_free(fd_ref_pyramid pyr)
+{
+     int                  _k;
+
+     for (_k = 0; _k < pyr->nb_levels; _k++) {
+          free(pyr->levels[_k].aggr);
+     }
+     free(pyr->elts);
+     free(pyr->values);
+
+     pyr->nb_levels = 0;
+     pyr->elts      = NULL;
+     pyr->values    = NULL;
+}
+
+// }}}
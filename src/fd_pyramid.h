@@ -0,0 +1,92 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_pyramid.h Version 1.2 du 24/08/10 -
+ *
+ *   Pyramid of the aggregates of square blocks of a matrix.
+ */
+
+#ifndef FD_PYRAMID_H
+#define FD_PYRAMID_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_provider.h"
+
+// }}}
+// Macros definitions {{{
+/* Maximum number of blocks of the finest level, and number of levels
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_PYR_MAX_BLOCKS   (1 << 21)
+#define   FD_PYR_MAX_LEVELS   (64)
+
+/* Lines of the finest level computed by a thread at once, and elements
+   read at once
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_PYR_CHUNK        (4096)
+
+#define   FD_PYR_MAX_THREADS  (256)
+
+// }}}
+// Structures definitions {{{
+/* Aggregates of the elements of a block, NaN excepted (count = 0 : no
+ * element available). The count is exact, the means being weighted by it.
+ */
+struct fd_aggr {
+     float                min;     // Minimum
+     float                max;     // Maximum
+     float                mean;    // Mean
+     int64_t              count;   // Number of elements
+};
+typedef struct fd_aggr              fd_aggr;
+typedef struct fd_aggr             *fd_ref_aggr;
+
+/* Level k holds the blocks of block lines and block columns : block (bi, bj)
+ * aggregates lines bi * block + 1 to (bi + 1) * block and columns
+ * bj * block + 1 to (bj + 1) * block of the matrix. The block of level
+ * k + 1 is twice as large as the block of level k, the last level having
+ * a single block.
+ */
+struct fd_pyr_level {
+     int64_t              block;   // Size of the blocks
+     int64_t              n;       // Number of lines of blocks
+     int64_t              p;       // Number of columns of blocks
+     fd_aggr             *aggr;    // Blocks, line by line
+};
+typedef struct fd_pyr_level         fd_pyr_level;
+typedef struct fd_pyr_level        *fd_ref_pyr_level;
+
+struct fd_pyramid {
+     fd_ref_provider      provider; // Provider of the elements
+     int64_t              ready;   // Lines of the matrix aggregated
+     int                  nb_levels; // Number of levels
+     fd_pyr_level         levels[FD_PYR_MAX_LEVELS];
+     char                *elts;    // Elements of a block finer than level 0
+     double              *values;
+};
+typedef struct fd_pyramid           fd_pyramid;
+typedef struct fd_pyramid          *fd_ref_pyramid;
+
+// }}}
+// Functions prototypes {{{
+void      fd_pyramid_build(fd_ref_pyramid pyr, fd_ref_provider provider, int nb_threads);
+void      fd_pyramid_get(fd_ref_pyramid pyr, int64_t i, int64_t j, int64_t block,
+                         fd_ref_aggr aggr);
+void      fd_pyramid_free(fd_ref_pyramid pyr);
+
+// }}}
+
+#endif	/* FD_PYRAMID_H */
@@ -14,7 +14,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *
- *   @(#)  [MB] fd_rectangle.c Version 1.15 du 24/07/23 - 
+ *   @(#)  [MB] fd_rectangle.c Version 1.26 du 24/08/10 - 
  *
  *   This is a program to test ncurses before integration into RPN.
  */
@@ -48,15 +48,62 @@
  *
  *   - Go back to the previous position :
  *        ''
+ *
+ *   - Search (the element found is displayed in the upper left cell) :
+ *        / value   : first element equal to value
+ *        / >value  : first element greater than value (< : less than)
+ *        / a..b    : first element between a and b
+ *        / max     : maximum of the matrix (min : minimum)
+ *        n         : next element matching the last search
+ *        +         : maximum of the matrix
+ *        -         : minimum of the matrix
+ *
+ *   - Zoom out (heatmap of the aggregates of blocks of elements) :
+ *        z         : display the heatmap around the viewport, or zoom out
+ *        Z         : zoom in, down to the elements
+ *        A         : display the mean, the minimum or the maximum of the
+ *                    blocks
+ *        enter     : back to the elements at the center of the heatmap
+ *        The movement keys move the heatmap by blocks.
+ *
+ *   - Statistics (sum, number and mean of the elements) :
+ *        S         : of the viewport
+ *        R         : of the rectangle between marks 'a and 'b
+ *
+ *   - Mouse wheel : FD_WHEEL_LINES lines up or down
+ *
+ *   Keys typed faster than the frames are displayed (auto-repeat, wheel
+ *   bursts) are all applied before the next frame is displayed.
  */
 
 // }}}
 
 // Includes {{{
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <locale.h>
+#define   NCURSES_WIDECHAR    1
 #include <ncurses.h>
 #include <math.h>
+#include <complex.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include "fd_format.h"
+#include "fd_mmap.h"
+#include "fd_sparse.h"
+#include "fd_tiled.h"
+#include "fd_ctile.h"
+#include "fd_provider.h"
+#include "fd_search.h"
+#include "fd_pyramid.h"
+#include "fd_sat.h"
+#include "fd_kll.h"
+#include "fd_scale.h"
+#include "fd_term.h"
 
 // }}}
 // Macros definitions {{{
@@ -81,6 +128,23 @@
 #define   FD_RED_REV     (6)
 #define   FD_WHITE       (7)
 
+/* Delay between two displays of a matrix file being written (in ms)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_POLL_DELAY  (250)
+
+/* Delay before values not computed yet are displayed as placeholders (in ms)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_FRAME_DELAY (20)
+
+/* Tiles kept in the cache, and tiles the worker has to compute
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CACHE_TILES (48)
+#define   FD_CACHE_TODO  (32)
+
+/* Pages computed ahead in the direction of the last move
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_CACHE_AHEAD (2)
+
 /* Control characters
    ~~~~~~~~~~~~~~~~~~ */
 #define   FD_CTRL_B      (0x02)
@@ -88,22 +152,90 @@
 #define   FD_CTRL_F      (0x06)
 #define   FD_CTRL_U      (0x15)
 
+/* Lines moved by a notch of the mouse wheel
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_WHEEL_LINES (3)
+
+/* Maximum number of keys applied before a frame is displayed
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_MAX_FOLD    (256)
+
+/* Aggregate of the blocks displayed by the heatmap
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_ZOOM_MEAN   (0)
+#define   FD_ZOOM_MIN    (1)
+#define   FD_ZOOM_MAX    (2)
+#define   FD_ZOOM_NB     (3)
+
+/* Color pairs of the half blocks of the heatmap : foreground of the upper
+   block, background of the lower block
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_HEAT_PAIRS       (8)
+#define   FD_HEAT_PAIR(up, down)   (FD_HEAT_PAIRS + ((up) * 8) + (down))
+#define   FD_HALF_BLOCK       L"\u2580"
+
 #define   FD_IS_LOWER(letter) (('a' <= (letter)) && ((letter) <= 'z'))
 #define   FD_POS_IDX(letter)  (letter - 'a' + 1)
+#define   FD_SIGN(x)          (((x) > 0) - ((x) < 0))
+
+/* Formula of the generated matrix
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_DEFAULT_EXPR     "(n - abs(i - j)) * 10"
+
+/* Default percentiles of the red, yellow and green color bands
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_DEFAULT_AUTO     "70,80,90"
+
+/* Letters of the color pairs in the scales, from FD_BLUE to FD_WHITE
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_PALETTE          "bcgyrRw"
+
+/* Default color scale of the values, and scale of --auto
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_DEFAULT_SCALE    "R,0,b,7000,r,8000,y,9000,g,nan=b"
+#define   FD_AUTO_SCALE       "R,0,b,%g%%,r,%g%%,y,%g%%,g,nan=b"
+
+/* Value, level in the color scale and text of an element, for each element
+ * type : complex elements are classified by their modulus
+ */
+#define   FD_CELL_VALUE_int8(v)         (v)
+#define   FD_CELL_VALUE_int16(v)        (v)
+#define   FD_CELL_VALUE_int32(v)        (v)
+#define   FD_CELL_VALUE_float32(v)      (v)
+#define   FD_CELL_VALUE_float64(v)      (v)
+#define   FD_CELL_VALUE_complex128(v)   creal(v)
+
+#define   FD_CELL_LEVEL_int8(v)         (v)
+#define   FD_CELL_LEVEL_int16(v)        (v)
+#define   FD_CELL_LEVEL_int32(v)        (v)
+#define   FD_CELL_LEVEL_float32(v)      (v)
+#define   FD_CELL_LEVEL_float64(v)      (v)
+#define   FD_CELL_LEVEL_complex128(v)   cabs(v)
+
+#define   FD_CELL_TEXT_int8(t, v, sz)        fd_fmt_int(t, v, sz)
+#define   FD_CELL_TEXT_int16(t, v, sz)       fd_fmt_int(t, v, sz)
+#define   FD_CELL_TEXT_int32(t, v, sz)       fd_fmt_int(t, v, sz)
+#define   FD_CELL_TEXT_float32(t, v, sz)     fd_fmt_double(t, v, sz, FD_FMT_PREC)
+#define   FD_CELL_TEXT_float64(t, v, sz)     fd_fmt_double(t, v, sz, FD_FMT_PREC)
+#define   FD_CELL_TEXT_complex128(t, v, sz)  fd_fmt_complex(t, creal(v), cimag(v), sz, \
+                                                            FD_FMT_PREC)
 
 // }}}
 // Structures definitions {{{
 struct fd_position {
-     int                  i;       // Line number
-     int                  j;       // Column number
+     int64_t              i;       // Line number
+     int64_t              j;       // Column number
 };
 typedef struct fd_position          fd_pos;
 typedef struct fd_position         *fd_ref_pos;
 
 struct fd_matrix_elt {
      fd_pos               pos;     // Position
-     int                  n;       // Matrix lines number
-     int                  p;       // Matrix columns number
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int                  sz_n;    // Digits of a line number
+     int                  sz_p;    // Digits of a column number
+     fd_ref_provider      provider; // Provider of the elements
 };
 typedef struct fd_matrix_elt        fd_matrix_elt;
 typedef struct fd_matrix_elt       *fd_ref_matrix_elt;
@@ -124,6 +256,139 @@ struct fd_rectangle {
 typedef struct fd_rectangle         fd_rectangle;
 typedef struct fd_rectangle        *fd_ref_rectangle;
 
+struct fd_cell {
+     fd_pos               pos;     // Coordinates of the displayed element
+     double               value;   // Element value
+     int                  color;   // Color pair of the value
+     int                  ready;   // Value is available
+     char                 text[32];// Formatted value
+};
+typedef struct fd_cell              fd_cell;
+typedef struct fd_cell             *fd_ref_cell;
+
+/* The matrix is divided into tiles of the size of the viewport : tile
+ * (ti, tj) holds the elements of lines ti * dy + 1 to (ti + 1) * dy and of
+ * columns tj * dx + 1 to (tj + 1) * dx.
+ */
+struct fd_tile {
+     int64_t              ti;      // Tile line number (-1 : free slot)
+     int64_t              tj;      // Tile column number
+     int64_t              last;    // Last line of the tile with values
+     long                 stamp;   // Time of the last use
+     fd_cell             *cells;   // Formatted cells of the tile
+};
+typedef struct fd_tile              fd_tile;
+typedef struct fd_tile             *fd_ref_tile;
+
+/* A worker thread computes the tiles of the list, those of the viewport
+ * first. After each move the display thread gives it a new list, of a new
+ * generation : the worker then drops the tile it is computing if the new
+ * list does not contain it.
+ */
+struct fd_tile_cache {
+     fd_tile              tiles[FD_CACHE_TILES];
+     long                 clock;   // Number of uses of the tiles
+     fd_pos               todo[FD_CACHE_TODO]; // Tiles to compute, most probable first
+     int                  nb_todo; // Number of tiles to compute
+     int                  nb_visible; // Number of tiles of the viewport
+     int                  next;    // Next tile to compute
+     int                  busy;    // The worker is computing a tile
+     int                  prefetching; // The worker is advising the provider
+     int                  paused;  // The worker must not call the provider
+     long                 gen;     // Generation of the list
+     long                 done;    // Number of tiles computed
+     int                  stop;    // The worker must exit
+     fd_pos               origin;  // Viewport of the list
+     int                  di;      // Direction of the last move (lines)
+     int                  dj;      // Direction of the last move (columns)
+     int                  advised; // Provider told about the next moves
+     fd_ref_provider      provider; // Provider of the elements
+     fd_cell             *cells;   // Tile being computed
+     char                *elts;    // Elements of a line of the tile
+     pthread_mutex_t      lock;    // Protects the fields above
+     pthread_cond_t       work;    // New list for the worker
+     pthread_cond_t       computed; // Tile computed
+     pthread_t            worker;  // Thread computing the tiles
+};
+typedef struct fd_tile_cache        fd_tile_cache;
+typedef struct fd_tile_cache       *fd_ref_tile_cache;
+
+struct fd_viewport {
+     int                  dy;      // Height (in lines)
+     int                  dx;      // Width (in columns)
+     int                  sz;      // Width of a cell
+     int                  valid;   // Previous frame is on the screen
+     fd_matrix_elt        origin;  // Element displayed in the upper left cell
+     fd_cell             *cells;   // Cells of the current frame
+     fd_cell             *prev;    // Cells of the previous frame
+     chtype              *line;    // Attributed characters of a screen line
+     int                  missing; // Values of the frame not ready yet
+     long                 done;    // Tiles computed before the frame
+     fd_tile_cache        cache;   // Tiles computed by the worker
+     WINDOW              *win;     // Scrollable window of the matrix
+};
+typedef struct fd_viewport          fd_viewport;
+typedef struct fd_viewport         *fd_ref_viewport;
+
+/* The zoomed out view displays a heatmap of blocks of block x block
+ * elements, the upper left one starting at element (i0, j0) : each
+ * character of the window displays two blocks, one above the other, with
+ * a half block character when the locale allows it, one block otherwise.
+ */
+struct fd_zoom {
+     int64_t              block;   // Size of the blocks (1 : zoom off)
+     int64_t              i0;      // First line of the heatmap
+     int64_t              j0;      // First column of the heatmap
+     int                  aggr;    // Aggregate displayed
+     int                  half;    // Two blocks per character
+     int                  rows;    // Lines of blocks of the heatmap
+     int                  cols;    // Columns of blocks of the heatmap
+     int                  built;   // The pyramid has been built
+     fd_pyramid           pyr;     // Aggregates of the blocks
+};
+typedef struct fd_zoom              fd_zoom;
+typedef struct fd_zoom             *fd_ref_zoom;
+
+// }}}
+// Global variables {{{
+/* Output of curses, counting the bytes sent to the terminal
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static fd_term                 fd_terminal;
+
+/* Number of bytes sent to the terminal for the last frame
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static long                    fd_nb_bytes = 0;
+
+/* Colors of the heatmap, for each color pair of a value
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static const short             fd_heat_colors[] = {
+     COLOR_BLACK,
+     COLOR_BLUE,                   // FD_BLUE
+     COLOR_CYAN,                   // FD_CYAN
+     COLOR_GREEN,                  // FD_GREEN
+     COLOR_YELLOW,                 // FD_YELLOW
+     COLOR_RED,                    // FD_RED
+     COLOR_MAGENTA,                // FD_RED_REV
+     COLOR_WHITE,                  // FD_WHITE
+};
+
+/* Names of the aggregates
+   ~~~~~~~~~~~~~~~~~~~~~~~ */
+static const char             *fd_zoom_names[] = { "mean", "min", "max" };
+
+/* Color scale of the values : set by --scale or --auto
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static fd_scale                fd_value_scale;
+
+/* Color pairs of a coordinate, indexed by (coord == 1) + 2 * (coord == last)
+   + 4 * (coord == other) : the first and the last lines or columns take
+   precedence over the diagonal
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static const short             fd_coord_colors[] = {
+     FD_BLUE,  FD_GREEN, FD_RED,   FD_GREEN,
+     FD_CYAN,  FD_GREEN, FD_RED,   FD_GREEN,
+};
+
 // }}}
 
 // fd_draw_rectangle() {{{
@@ -152,334 +417,1836 @@ void fd_draw_rectangle(fd_ref_rectangle rect)
 }
 
 // }}}
-// fd_value() {{{
+// fd_max() {{{
+/******************************************************************************
+
+                         FD_MAX
+
+******************************************************************************/
+int64_t fd_max(int64_t x, int64_t y)
+{
+     int64_t         _max;
+
+     if (x >= y) {
+          _max           = x;
+     }
+     else {
+          _max           = y;
+     }
+
+     return _max;
+}
+
+// }}}
+// fd_min() {{{
+/******************************************************************************
+
+                         FD_MIN
+
+******************************************************************************/
+int64_t fd_min(int64_t x, int64_t y)
+{
+     int64_t         _min;
+
+     if (x <= y) {
+          _min           = x;
+     }
+     else {
+          _min           = y;
+     }
+
+     return _min;
+}
+
+// }}}
+// fd_save_pos() {{{
+/******************************************************************************
+
+                         FD_SAVE_POS
+
+******************************************************************************/
+void fd_save_pos(fd_ref_matrix_elt ref_mat, fd_ref_pos ref_pos)
+{
+     ref_pos->i          = ref_mat->pos.i;
+     ref_pos->j          = ref_mat->pos.j;
+}
+
+// }}}
+// fd_copy_pos() {{{
+/******************************************************************************
+
+                         FD_COPY_POS
+
+******************************************************************************/
+void fd_copy_pos(fd_ref_pos dst_pos, fd_ref_pos src_pos)
+{
+     dst_pos->i          = src_pos->i;
+     dst_pos->j          = src_pos->j;
+}
+
+// }}}
+// fd_new_pos() {{{
+/******************************************************************************
+
+                         FD_NEW_POS
+
+******************************************************************************/
+void fd_new_pos(fd_ref_pos curr_pos, fd_ref_pos new_pos, fd_ref_pos old_pos)
+{
+     if ((curr_pos->i != new_pos->i) || (curr_pos->j != new_pos->j)) {
+          /* Store current position
+             ~~~~~~~~~~~~~~~~~~~~~~ */
+          old_pos->i          = curr_pos->i;
+          old_pos->j          = curr_pos->j;
+
+          /* Setup new position
+             ~~~~~~~~~~~~~~~~~~ */
+          curr_pos->i         = new_pos->i;
+          curr_pos->j         = new_pos->j;
+     }
+}
+
+// }}}
+// fd_init_cache() {{{
+/******************************************************************************
+
+                         FD_INIT_CACHE
+
+     Allocate the cells of the tiles of the cache, nb_cells per tile of dx
+     columns.
+
+******************************************************************************/
+void fd_init_cache(fd_ref_tile_cache cache, size_t nb_cells, int dx)
+{
+     int             _t;
+
+     memset(cache, 0, sizeof(*cache));
+     for (_t = 0; _t < FD_CACHE_TILES; _t++) {
+          cache->tiles[_t].ti = -1;
+          if ((cache->tiles[_t].cells = calloc(nb_cells, sizeof(fd_cell))) == NULL) {
+               fprintf(stderr, "Malloc error !\n");
+               exit(1);
+          }
+     }
+
+     if ((cache->cells = calloc(nb_cells, sizeof(fd_cell))) == NULL
+     ||  (cache->elts  = calloc(dx, FD_ELT_MAX_SIZE)) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     cache->origin.i     = FD_UNDEF_POS;
+     cache->origin.j     = FD_UNDEF_POS;
+     pthread_mutex_init(&cache->lock, NULL);
+     pthread_cond_init(&cache->work, NULL);
+     pthread_cond_init(&cache->computed, NULL);
+}
+
+// }}}
+// fd_init_viewport() {{{
+/******************************************************************************
+
+                         FD_INIT_VIEWPORT
+
+     Allocate the cells of the current and of the previous frames.
+
+******************************************************************************/
+void fd_init_viewport(fd_ref_viewport view, fd_ref_sub_matrix delta, int sz)
+{
+     size_t          _nb_cells;
+
+     view->dy       = delta->dy;
+     view->dx       = delta->dx;
+     view->sz       = sz;
+     view->valid    = FALSE;
+
+     _nb_cells      = (size_t) view->dy * view->dx;
+     if ((view->cells = calloc(_nb_cells, sizeof(fd_cell))) == NULL
+     ||  (view->prev  = calloc(_nb_cells, sizeof(fd_cell))) == NULL
+     ||  (view->line  = calloc((size_t) view->dx * (sz + 1), sizeof(chtype))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     view->missing  = 0;
+     view->done     = 0;
+
+     fd_init_cache(&view->cache, _nb_cells, view->dx);
+}
+
+// }}}
+// fd_init_window() {{{
+/******************************************************************************
+
+                         FD_INIT_WINDOW
+
+     Create the window of the matrix inside the rectangle. Line and
+     insert / delete line operations are enabled on it, so that a one row
+     move only sends the newly exposed row to the terminal.
+
+******************************************************************************/
+void fd_init_window(fd_ref_viewport view, fd_ref_rectangle rect)
+{
+     if ((view->win = newwin((3 * view->dy) - 1, ((view->sz + 1) * view->dx) + 1,
+                             rect->y1 + 1, rect->x1 + 1)) == NULL) {
+          endwin();
+          fprintf(stderr, "Cannot create the matrix window !\n");
+          exit(1);
+     }
+     scrollok(view->win, TRUE);
+     idlok(view->win, TRUE);
+}
+
+// }}}
+// fd_invalidate_cell() {{{
+/******************************************************************************
+
+                         FD_INVALIDATE_CELL
+
+     Mark a cell as not displayed.
+
+******************************************************************************/
+void fd_invalidate_cell(fd_ref_cell cell)
+{
+     cell->pos.i         = FD_UNDEF_POS;
+     cell->pos.j         = FD_UNDEF_POS;
+     cell->color         = 0;
+     cell->ready         = FALSE;
+     cell->text[0]       = 0;
+}
+
+// }}}
+// fd_scroll_viewport() {{{
+/******************************************************************************
+
+                         FD_SCROLL_VIEWPORT
+
+     Scroll the content of the window and the cells of the previous frame
+     by di rows (0 < |di| < dy) or by dj columns (0 < |dj| < dx) : only the
+     cells of the exposed rows or columns remain to be drawn.
+
+******************************************************************************/
+void fd_scroll_viewport(fd_ref_viewport view, int di, int dj)
+{
+     int             _r, _c, _k, _y, _dx, _dy, _sz, _nb;
+     fd_ref_cell     _row;
+
+     _dx            = view->dx;
+     _dy            = view->dy;
+     _sz            = view->sz;
+
+     if (di != 0) {
+          /* Vertical scrolling : let the terminal move the lines
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          wscrl(view->win, 3 * di);
+
+          _nb            = abs(di);
+          if (di > 0) {
+               memmove(view->prev, view->prev + (_nb * _dx),
+                       (size_t) (_dy - _nb) * _dx * sizeof(fd_cell));
+               _row           = view->prev + ((_dy - _nb) * _dx);
+          }
+          else {
+               memmove(view->prev + (_nb * _dx), view->prev,
+                       (size_t) (_dy - _nb) * _dx * sizeof(fd_cell));
+               _row           = view->prev;
+          }
+
+          for (_c = 0; _c < _nb * _dx; _c++) {
+               fd_invalidate_cell(&_row[_c]);
+          }
+     }
+     else {
+          /* Horizontal scrolling : shift the characters of the lines
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _nb            = abs(dj);
+          for (_y = 0; _y < (3 * _dy) - 1; _y++) {
+               wmove(view->win, _y, 1);
+               for (_k = 0; _k < (_sz + 1) * _nb; _k++) {
+                    if (dj > 0) {
+                         wdelch(view->win);
+                    }
+                    else {
+                         winsch(view->win, ' ');
+                    }
+               }
+          }
+
+          for (_r = 0; _r < _dy; _r++) {
+               _row           = view->prev + (_r * _dx);
+               if (dj > 0) {
+                    memmove(_row, _row + _nb, (_dx - _nb) * sizeof(fd_cell));
+                    _row          += _dx - _nb;
+               }
+               else {
+                    memmove(_row + _nb, _row, (_dx - _nb) * sizeof(fd_cell));
+               }
+               for (_c = 0; _c < _nb; _c++) {
+                    fd_invalidate_cell(&_row[_c]);
+               }
+          }
+     }
+
+     view->origin.pos.i  += di;
+     view->origin.pos.j  += dj;
+}
+
+// }}}
+// fd_put_str() {{{
+/******************************************************************************
+
+                         FD_PUT_STR
+
+     Copy at most max characters of a string into an attributed characters
+     buffer.
+     Return the number of characters copied.
+
+******************************************************************************/
+int fd_put_str(chtype *dst, const char *str, int max, int color_pair)
+{
+     chtype          _attr = COLOR_PAIR(color_pair);
+     int             _len;
+
+     for (_len = 0; _len < max && str[_len] != 0; _len++) {
+          dst[_len]      = (unsigned char) str[_len] | _attr;
+     }
+
+     return _len;
+}
+
+// }}}
+// fd_put_int() {{{
+/******************************************************************************
+
+                         FD_PUT_INT
+
+     Copy the decimal representation of an integer into an attributed
+     characters buffer.
+     Return the number of characters copied.
+
+******************************************************************************/
+int fd_put_int(chtype *dst, int64_t value, int color_pair)
+{
+     char            _digits[FD_FMT_MAX_LEN + 1];
+
+     fd_fmt_int(_digits, value, 0);
+
+     return fd_put_str(dst, _digits, FD_FMT_MAX_LEN, color_pair);
+}
+
+// }}}
+// fd_coord_color() {{{
+/******************************************************************************
+
+                         FD_COORD_COLOR
+
+     Return the color pair of a coordinate.
+
+******************************************************************************/
+int fd_coord_color(int64_t coord, int64_t other, int64_t last)
+{
+     return fd_coord_colors[(coord == 1) | ((coord == last) << 1) | ((coord == other) << 2)];
+}
+
+// }}}
+// fd_coords_chstr() {{{
+/******************************************************************************
+
+                         FD_COORDS_CHSTR
+
+     Fill the (sz + 1) attributed characters of the coordinates of an element.
+
+******************************************************************************/
+void fd_coords_chstr(chtype *dst, fd_ref_matrix_elt matrix_elt, int sz)
+{
+     int64_t         _i, _j;
+     int             _len = 0;
+
+     _i             = matrix_elt->pos.i;
+     _j             = matrix_elt->pos.j;
+
+     _len          += fd_put_str(dst + _len, "[", 1, FD_BLUE);
+     _len          += fd_put_int(dst + _len, _i,
+                                 fd_coord_color(_i, _j, matrix_elt->n));
+     _len          += fd_put_str(dst + _len, ", ", 2, FD_BLUE);
+     _len          += fd_put_int(dst + _len, _j,
+                                 fd_coord_color(_j, _i, matrix_elt->p));
+     _len          += fd_put_str(dst + _len, "]", 1, FD_BLUE);
+
+     for ( ; _len < sz + 1; _len++) {
+          dst[_len]      = ' ' | COLOR_PAIR(FD_BLUE);
+     }
+}
+
+// }}}
+// fd_value_chstr() {{{
 /******************************************************************************
 
-                              FD_VALUE
+                         FD_VALUE_CHSTR
 
-     Generate component value of a fictitious matrix.
+     Fill the (sz + 1) attributed characters of the value of a cell.
 
 ******************************************************************************/
-int fd_value(fd_ref_matrix_elt matrix_elt)
+void fd_value_chstr(chtype *dst, fd_ref_cell cell, int sz)
 {
-     int                  _i, _j, _n, _p, _val;
-     int                  _coeff = 10;
+     int             _len;
+
+     _len           = fd_put_str(dst, cell->text, sz + 1, cell->color);
+     for ( ; _len < sz + 1; _len++) {
+          dst[_len]      = ' ';
+     }
+}
+
+// }}}
+// fd_set_colors_<type>() {{{
+/******************************************************************************
+
+                         FD_SET_COLORS_<TYPE>
+
+     Set the color pairs of nb elements (at most FD_SCALE_CHUNK), from their
+     levels in the color scale.
+
+******************************************************************************/
+#define   FD_DEFINE_SET_COLORS(code, suffix, type)                         \
+static void fd_set_colors_##suffix(const type *elts, int nb, double *levels,  \
+                                   short *colors)                          \
+{                                                                          \
+     int             _k;                                                   \
+                                                                           \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          levels[_k]     = FD_CELL_LEVEL_##suffix(elts[_k]);               \
+     }                                                                     \
+     fd_scale_classify(&fd_value_scale, levels, nb, colors);               \
+}
+
+FD_ELT_FOREACH(FD_DEFINE_SET_COLORS)
+
+// }}}
+// fd_set_cells_<type>() {{{
+/******************************************************************************
+
+                         FD_SET_CELLS_<TYPE>
+
+     Set the value, the color and the text of the cells not ready among
+     the nb cells of a line, from their elements. One function is generated
+     for each element type, so that the elements are formatted at their
+     native type. The colors of a whole chunk of the line are given by the
+     color scale at once, without a branch per cell.
+
+******************************************************************************/
+#define   FD_DEFINE_SET_CELLS(code, suffix, type)                          \
+static void fd_set_cells_##suffix(fd_ref_cell cells, const void *elts, int nb, int sz) \
+{                                                                          \
+     const type     *_elts = elts;                                         \
+     char            _text[FD_FMT_MAX_LEN + 256];                          \
+     double          _levels[FD_SCALE_CHUNK];                              \
+     short           _colors[FD_SCALE_CHUNK];                              \
+     int             _k, _len;                                             \
+                                                                           \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          if (_k % FD_SCALE_CHUNK == 0) {                                  \
+               fd_set_colors_##suffix(_elts + _k, fd_min(FD_SCALE_CHUNK, nb - _k), \
+                                      _levels, _colors);                   \
+          }                                                                \
+          if (cells[_k].ready) {                                           \
+               continue;                                                   \
+          }                                                                \
+                                                                           \
+          cells[_k].ready     = TRUE;                                      \
+          cells[_k].value     = FD_CELL_VALUE_##suffix(_elts[_k]);         \
+          cells[_k].color     = _colors[_k % FD_SCALE_CHUNK];              \
+                                                                           \
+          _len                = FD_CELL_TEXT_##suffix(_text, _elts[_k], sz);    \
+          if (_len >= sizeof(cells[_k].text)) {                            \
+               _len                = sizeof(cells[_k].text) - 1;           \
+          }                                                                \
+          memcpy(cells[_k].text, _text, _len);                             \
+          cells[_k].text[_len] = 0;                                        \
+     }                                                                     \
+}
+
+FD_ELT_FOREACH(FD_DEFINE_SET_CELLS)
+
+// }}}
+// fd_set_cells() {{{
+/******************************************************************************
+
+                         FD_SET_CELLS
+
+     Set the cells not ready among the nb cells of a line, from elements of
+     the specified type.
+
+******************************************************************************/
+void fd_set_cells(fd_ref_cell cells, int elt_type, const void *elts, int nb, int sz)
+{
+#define   FD_SET_CELLS_CASE(code, suffix, type)                            \
+     case code:                                                            \
+          fd_set_cells_##suffix(cells, elts, nb, sz);                      \
+          break;
+
+     switch (elt_type) {
+
+     FD_ELT_FOREACH(FD_SET_CELLS_CASE)
+
+     default:
+          break;
+     }
+
+#undef    FD_SET_CELLS_CASE
+}
+
+// }}}
+// fd_set_line() {{{
+/******************************************************************************
+
+                         FD_SET_LINE
+
+     Set the cells not ready among the nb cells of line i starting at column
+     j, from elements of the provider. Elements outside of the matrix are
+     white.
+
+******************************************************************************/
+void fd_set_line(fd_ref_cell cells, fd_ref_provider provider, int64_t i, int64_t j,
+                 const void *elts, int nb, int sz)
+{
+     int             _c;
+
+     fd_set_cells(cells, provider->elt_type, elts, nb, sz);
+
+     if (i > provider->n || j + nb - 1 > provider->p) {
+          for (_c = 0; _c < nb; _c++) {
+               if (i > provider->n || j + _c > provider->p) {
+                    cells[_c].color     = FD_WHITE;
+               }
+          }
+     }
+}
+
+// }}}
+// fd_placeholder() {{{
+/******************************************************************************
+
+                         FD_PLACEHOLDER
+
+     Display a cell whose value is not available yet.
+
+******************************************************************************/
+void fd_placeholder(fd_ref_cell cell, int sz)
+{
+     cell->value         = 0.0;
+     cell->color         = FD_WHITE;
+     cell->ready         = FALSE;
+     snprintf(cell->text, sizeof(cell->text), "%*s", sz, "...");
+}
+
+// }}}
+// fd_cache_find() {{{
+/******************************************************************************
+
+                         FD_CACHE_FIND
+
+     Return the tile (ti, tj) if it is in the cache, NULL otherwise. The
+     lock of the cache must be held.
+
+******************************************************************************/
+fd_ref_tile fd_cache_find(fd_ref_tile_cache cache, int64_t ti, int64_t tj)
+{
+     int             _t;
+
+     for (_t = 0; _t < FD_CACHE_TILES; _t++) {
+          if (cache->tiles[_t].ti == ti && cache->tiles[_t].tj == tj) {
+               cache->tiles[_t].stamp   = ++cache->clock;
+               return &cache->tiles[_t];
+          }
+     }
+
+     return NULL;
+}
+
+// }}}
+// fd_tile_last() {{{
+/******************************************************************************
+
+                         FD_TILE_LAST
+
+     Return the last line of tile ti whose values can be computed, when the
+     ready first lines of the matrix are available.
+
+******************************************************************************/
+int64_t fd_tile_last(fd_ref_viewport view, fd_ref_provider provider, int64_t ti, int64_t ready)
+{
+     int64_t         _last;
+
+     _last          = (ti + 1) * view->dy;
+     if (ready < provider->n && ready < _last) {
+          _last          = ready;
+     }
+
+     return _last;
+}
+
+// }}}
+// fd_cache_wanted() {{{
+/******************************************************************************
+
+                         FD_CACHE_WANTED
+
+     Check whether tile (ti, tj) is still needed by the new list : among
+     the tiles of the viewport, or anywhere in the list if the viewport
+     needs no tile. Remove it from the list. The lock of the cache must be
+     held.
+
+******************************************************************************/
+int fd_cache_wanted(fd_ref_tile_cache cache, int64_t ti, int64_t tj)
+{
+     int             _k, _end;
+
+     _end           = cache->next < cache->nb_visible ? cache->nb_visible : cache->nb_todo;
+     for (_k = cache->next; _k < _end; _k++) {
+          if (cache->todo[_k].i == ti && cache->todo[_k].j == tj) {
+               cache->todo[_k].i   = -1;
+               return TRUE;
+          }
+     }
+
+     return FALSE;
+}
+
+// }}}
+// fd_cache_compute() {{{
+/******************************************************************************
+
+                         FD_CACHE_COMPUTE
+
+     Compute and format the cells of tile (ti, tj) of generation gen, then
+     store them into the least recently used slot of the cache. The tile is
+     dropped if the list of a new generation does not contain it any more.
+     Called by the worker, the lock of the cache not being held.
+
+******************************************************************************/
+void fd_cache_compute(fd_ref_viewport view, int64_t ti, int64_t tj, long gen)
+{
+     fd_ref_tile_cache    _cache = &view->cache;
+     fd_ref_provider      _provider;
+     fd_ref_tile          _tile;
+     fd_ref_cell          _cells;
+     int                  _t, _r, _c, _dy, _dx, _wanted;
+     int64_t              _i, _i0, _j0, _ready;
+
+     _provider      = _cache->provider;
+     _dy            = view->dy;
+     _dx            = view->dx;
+     _i0            = (ti * _dy) + 1;
+     _j0            = (tj * _dx) + 1;
+     _ready         = fd_provider_ready(_provider);
+
+     for (_r = 0; _r < _dy; _r++) {
+          /* Drop the tile if the user went elsewhere
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          if (__atomic_load_n(&_cache->gen, __ATOMIC_ACQUIRE) != gen) {
+               pthread_mutex_lock(&_cache->lock);
+               gen            = _cache->gen;
+               _wanted        = fd_cache_wanted(_cache, ti, tj);
+               pthread_mutex_unlock(&_cache->lock);
+               if (!_wanted) {
+                    return;
+               }
+          }
+
+          _i             = _i0 + _r;
+          _cells         = _cache->cells + (_r * _dx);
+          for (_c = 0; _c < _dx; _c++) {
+               _cells[_c].pos.i    = _i;
+               _cells[_c].pos.j    = _j0 + _c;
+               _cells[_c].ready    = FALSE;
+          }
+
+          if (_i > _ready && _i <= _provider->n) {
+               /* Line not yet written in the matrix file
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               for (_c = 0; _c < _dx; _c++) {
+                    fd_placeholder(&_cells[_c], view->sz);
+               }
+          }
+          else {
+               fd_provider_fill(_provider, _i, _j0, 1, _dx, _cache->elts);
+               fd_set_line(_cells, _provider, _i, _j0, _cache->elts, _dx, view->sz);
+          }
+     }
+
+     /* Store the tile
+        ~~~~~~~~~~~~~~ */
+     pthread_mutex_lock(&_cache->lock);
+     if ((_tile = fd_cache_find(_cache, ti, tj)) == NULL) {
+          _tile          = &_cache->tiles[0];
+          for (_t = 1; _t < FD_CACHE_TILES; _t++) {
+               if (_cache->tiles[_t].stamp < _tile->stamp) {
+                    _tile          = &_cache->tiles[_t];
+               }
+          }
+     }
+     memcpy(_tile->cells, _cache->cells, (size_t) _dy * _dx * sizeof(fd_cell));
+     _tile->ti      = ti;
+     _tile->tj      = tj;
+     _tile->last    = fd_tile_last(view, _provider, ti, _ready);
+     _tile->stamp   = ++_cache->clock;
+     _cache->done++;
+     pthread_mutex_unlock(&_cache->lock);
+}
+
+// }}}
+// fd_cache_worker() {{{
+/******************************************************************************
+
+                         FD_CACHE_WORKER
+
+     Thread computing the tiles of the list, then telling the provider
+     which elements the next moves will probably need. It is the only
+     thread calling the provider, except for fd_provider_ready().
+
+******************************************************************************/
+void *fd_cache_worker(void *arg)
+{
+     fd_ref_viewport      _view = arg;
+     fd_ref_tile_cache    _cache = &_view->cache;
+     fd_ref_tile          _tile;
+     fd_pos               _todo, _origin;
+     int                  _di, _dj;
+     long                 _gen;
+
+     pthread_mutex_lock(&_cache->lock);
+     while (!_cache->stop) {
+          if (_cache->paused) {
+               /* The provider is used by another thread
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               pthread_cond_wait(&_cache->work, &_cache->lock);
+          }
+          else if (_cache->next < _cache->nb_todo
+          &&  (_cache->next < _cache->nb_visible || _cache->advised)) {
+               _todo          = _cache->todo[_cache->next++];
+               if (_todo.i < 0) {
+                    continue;
+               }
+
+               /* Skip the tiles already complete
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if ((_tile = fd_cache_find(_cache, _todo.i, _todo.j)) != NULL
+               &&  _tile->last >= fd_tile_last(_view, _cache->provider, _todo.i,
+                                               fd_provider_ready(_cache->provider))) {
+                    continue;
+               }
+
+               _cache->busy   = TRUE;
+               _gen           = _cache->gen;
+               pthread_mutex_unlock(&_cache->lock);
+
+               fd_cache_compute(_view, _todo.i, _todo.j, _gen);
+
+               pthread_mutex_lock(&_cache->lock);
+               _cache->busy   = FALSE;
+               pthread_cond_broadcast(&_cache->computed);
+          }
+          else if (!_cache->advised) {
+               /* The tiles on the screen are ready
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               _cache->advised     = TRUE;
+               _origin             = _cache->origin;
+               _di                 = _cache->di;
+               _dj                 = _cache->dj;
+               _cache->prefetching = TRUE;
+               pthread_cond_broadcast(&_cache->computed);
+               pthread_mutex_unlock(&_cache->lock);
+
+               fd_provider_prefetch(_cache->provider, _origin.i, _origin.j,
+                                    _view->dy, _view->dx, _di, _dj);
+
+               pthread_mutex_lock(&_cache->lock);
+               _cache->prefetching = FALSE;
+               pthread_cond_broadcast(&_cache->computed);
+          }
+          else {
+               pthread_cond_wait(&_cache->work, &_cache->lock);
+          }
+     }
+     pthread_mutex_unlock(&_cache->lock);
+
+     return NULL;
+}
+
+// }}}
+// fd_cache_start() {{{
+/******************************************************************************
+
+                         FD_CACHE_START
+
+     Start the worker computing the tiles of the viewport.
+
+******************************************************************************/
+void fd_cache_start(fd_ref_viewport view, fd_ref_provider provider)
+{
+     view->cache.provider     = provider;
+
+     if (pthread_create(&view->cache.worker, NULL, fd_cache_worker, view) != 0) {
+          fprintf(stderr, "Cannot create thread !\n");
+          exit(1);
+     }
+}
+
+// }}}
+// fd_cache_stop() {{{
+/******************************************************************************
+
+                         FD_CACHE_STOP
+
+     Stop the worker : the provider can then be closed.
+
+******************************************************************************/
+void fd_cache_stop(fd_ref_viewport view)
+{
+     pthread_mutex_lock(&view->cache.lock);
+     view->cache.stop    = TRUE;
+     pthread_cond_signal(&view->cache.work);
+     pthread_mutex_unlock(&view->cache.lock);
+
+     pthread_join(view->cache.worker, NULL);
+}
+
+// }}}
+// fd_cache_pause() {{{
+/******************************************************************************
+
+                         FD_CACHE_PAUSE
+
+     Stop the worker from calling the provider, and wait for its current
+     call to end : the provider can then be used by other threads.
+
+******************************************************************************/
+void fd_cache_pause(fd_ref_viewport view)
+{
+     pthread_mutex_lock(&view->cache.lock);
+     view->cache.paused  = TRUE;
+     while (view->cache.busy || view->cache.prefetching) {
+          pthread_cond_wait(&view->cache.computed, &view->cache.lock);
+     }
+     pthread_mutex_unlock(&view->cache.lock);
+}
+
+// }}}
+// fd_cache_resume() {{{
+/******************************************************************************
+
+                         FD_CACHE_RESUME
+
+     Let the worker compute the tiles again.
+
+******************************************************************************/
+void fd_cache_resume(fd_ref_viewport view)
+{
+     pthread_mutex_lock(&view->cache.lock);
+     view->cache.paused  = FALSE;
+     pthread_cond_signal(&view->cache.work);
+     pthread_mutex_unlock(&view->cache.lock);
+}
+
+// }}}
+// fd_cache_plan() {{{
+/******************************************************************************
+
+                         FD_CACHE_PLAN
+
+     Give the worker a new list of tiles : first the tiles of the viewport
+     at (i0, j0), then the tiles the next moves will probably need :
+     FD_CACHE_AHEAD pages in the direction of the last move, then one page
+     in each direction. Tiles already complete, and tiles of the next pages
+     whose lines are not all available yet, are skipped.
+
+******************************************************************************/
+void fd_cache_plan(fd_ref_viewport view, int64_t i0, int64_t j0, int di, int dj)
+{
+     fd_ref_tile_cache    _cache = &view->cache;
+     fd_ref_provider      _provider = _cache->provider;
+     fd_ref_tile          _tile;
+     int                  _dirs[FD_CACHE_AHEAD + 5][2], _nb_dirs, _d, _k, _dy, _dx;
+     int64_t              _i, _j, _ti, _tj, _last, _ready;
+     static int           _around[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+     _dy            = view->dy;
+     _dx            = view->dx;
+     _ready         = fd_provider_ready(_provider);
+
+     pthread_mutex_lock(&_cache->lock);
+
+     if (_cache->origin.i != i0 || _cache->origin.j != j0) {
+          _cache->advised     = FALSE;
+     }
+     _cache->origin.i    = i0;
+     _cache->origin.j    = j0;
+     if (di != 0 || dj != 0) {
+          _cache->di          = di;
+          _cache->dj          = dj;
+     }
+
+     /* Pages to prepare, the viewport itself first
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _dirs[0][0]    = _dirs[0][1]    = 0;
+     _nb_dirs       = 1;
+     if (_cache->di != 0 || _cache->dj != 0) {
+          for (_k = 1; _k <= FD_CACHE_AHEAD; _k++) {
+               _dirs[_nb_dirs][0]  = _k * _cache->di;
+               _dirs[_nb_dirs][1]  = _k * _cache->dj;
+               _nb_dirs++;
+          }
+     }
+     for (_d = 0; _d < 4; _d++) {
+          if (_around[_d][0] != _cache->di || _around[_d][1] != _cache->dj) {
+               _dirs[_nb_dirs][0]  = _around[_d][0];
+               _dirs[_nb_dirs][1]  = _around[_d][1];
+               _nb_dirs++;
+          }
+     }
+
+     /* Tiles covering these pages
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _cache->nb_todo     = 0;
+     _cache->nb_visible  = 0;
+     for (_d = 0; _d < _nb_dirs; _d++) {
+          _i             = i0 + (_dirs[_d][0] * _dy);
+          _j             = j0 + (_dirs[_d][1] * _dx);
+          if (_d > 0) {
+               _i             = _i < _provider->n - _dy + 1 ? _i : _provider->n - _dy + 1;
+               _j             = _j < _provider->p - _dx + 1 ? _j : _provider->p - _dx + 1;
+          }
+          _i             = fd_max(1, _i);
+          _j             = fd_max(1, _j);
+
+          for (_ti = (_i - 1) / _dy; _ti <= (_i + _dy - 2) / _dy; _ti++) {
+               _last          = fd_tile_last(view, _provider, _ti, _ready);
+               if (_d == 0 ? (_last <= _ti * _dy && (_ti + 1) * _dy <= _provider->n)
+                           : _last < (_ti + 1) * _dy) {
+                    continue;
+               }
+
+               for (_tj = (_j - 1) / _dx; _tj <= (_j + _dx - 2) / _dx; _tj++) {
+                    if ((_tile = fd_cache_find(_cache, _ti, _tj)) != NULL && _tile->last >= _last) {
+                         continue;
+                    }
+
+                    for (_k = 0; _k < _cache->nb_todo; _k++) {
+                         if (_cache->todo[_k].i == _ti && _cache->todo[_k].j == _tj) {
+                              break;
+                         }
+                    }
+                    if (_k < _cache->nb_todo || _cache->nb_todo == FD_CACHE_TODO) {
+                         continue;
+                    }
+
+                    _cache->todo[_cache->nb_todo].i    = _ti;
+                    _cache->todo[_cache->nb_todo].j    = _tj;
+                    _cache->nb_todo++;
+               }
+          }
+
+          if (_d == 0) {
+               _cache->nb_visible  = _cache->nb_todo;
+          }
+     }
+
+     _cache->next        = 0;
+     __atomic_store_n(&_cache->gen, _cache->gen + 1, __ATOMIC_RELEASE);
+     pthread_cond_signal(&_cache->work);
+
+     pthread_mutex_unlock(&_cache->lock);
+}
+
+// }}}
+// fd_cache_wait() {{{
+/******************************************************************************
+
+                         FD_CACHE_WAIT
+
+     Wait at most delay ms for the worker to compute the tiles of the
+     viewport.
+
+******************************************************************************/
+void fd_cache_wait(fd_ref_tile_cache cache, int delay)
+{
+     struct timespec      _limit;
+
+     clock_gettime(CLOCK_REALTIME, &_limit);
+     _limit.tv_nsec     += delay * 1000000L;
+     _limit.tv_sec      += _limit.tv_nsec / 1000000000L;
+     _limit.tv_nsec     %= 1000000000L;
+
+     pthread_mutex_lock(&cache->lock);
+     while (cache->next < cache->nb_visible || cache->busy) {
+          if (pthread_cond_timedwait(&cache->computed, &cache->lock, &_limit) != 0) {
+               break;
+          }
+     }
+     pthread_mutex_unlock(&cache->lock);
+}
+
+// }}}
+// fd_get_key() {{{
+/******************************************************************************
+
+                         FD_GET_KEY
+
+     Wait for a key. Return ERR if no key was pressed within delay ms (delay
+     < 0 : wait forever), or as soon as new values of the viewport are
+     available.
+
+******************************************************************************/
+int fd_get_key(fd_ref_viewport view, int delay)
+{
+     int             _ch;
+     long            _done;
+
+     while (view->missing > 0) {
+          /* Values of the viewport are being computed
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          timeout(FD_FRAME_DELAY);
+          if ((_ch = getch()) != ERR) {
+               return _ch;
+          }
+
+          pthread_mutex_lock(&view->cache.lock);
+          _done          = view->cache.done;
+          pthread_mutex_unlock(&view->cache.lock);
+          if (_done != view->done) {
+               return ERR;
+          }
+     }
+
+     timeout(delay);
+     return getch();
+}
+
+// }}}
+// fd_lookup_cells() {{{
+/******************************************************************************
+
+                         FD_LOOKUP_CELLS
+
+     Set the cells of the current frame from the previous frame or from the
+     tile cache, and display a placeholder in the others. Return the number
+     of placeholders the worker will replace with values.
+
+******************************************************************************/
+int fd_lookup_cells(fd_ref_viewport view, fd_ref_matrix_elt matrix_elt)
+{
+     int             _r, _c, _dx, _dy, _reuse, _missing;
+     int64_t         _i, _j, _pr, _pc;
+     fd_ref_matrix_elt _old;
+     fd_ref_provider _provider;
+     fd_ref_cell     _cell, _tmp;
+     fd_ref_tile     _tile;
+     int64_t         _ready;
+     static char     _zero[FD_ELT_MAX_SIZE];
+
+     _dx            = view->dx;
+     _dy            = view->dy;
+     _old           = &view->origin;
+     _provider      = matrix_elt->provider;
+     _ready         = fd_provider_ready(_provider);
+     _missing       = 0;
+
+     /* Values of the previous frame can only be reused for the same matrix
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _reuse         = view->valid
+                    && _old->n == matrix_elt->n && _old->p == matrix_elt->p;
+
+     pthread_mutex_lock(&view->cache.lock);
+     view->done     = view->cache.done;
+
+     for (_r = 0; _r < _dy; _r++) {
+          for (_c = 0; _c < _dx; _c++) {
+               _cell               = &view->cells[(_r * _dx) + _c];
+
+               _i                  = matrix_elt->pos.i + _r;
+               _j                  = matrix_elt->pos.j + _c;
+               _cell->pos.i        = _i;
+               _cell->pos.j        = _j;
+
+               /* Get the value from the previous frame if it was visible
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               _pr                 = _i - _old->pos.i;
+               _pc                 = _j - _old->pos.j;
+               _tmp                = NULL;
+               if (_reuse && 0 <= _pr && _pr < _dy && 0 <= _pc && _pc < _dx
+               &&  view->prev[(_pr * _dx) + _pc].pos.i != FD_UNDEF_POS
+               &&  view->prev[(_pr * _dx) + _pc].ready) {
+                    _tmp                = &view->prev[(_pr * _dx) + _pc];
+               }
+               else if (_i < 1 || _j < 1) {
+                    /* Element before the first line or column
+                       ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+                    _cell->ready        = FALSE;
+                    fd_set_cells(_cell, _provider->elt_type, _zero, 1, view->sz);
+                    continue;
+               }
+               else if ((_tile = fd_cache_find(&view->cache, (_i - 1) / _dy, (_j - 1) / _dx)) != NULL
+                    &&  (_i <= _tile->last || _i > _provider->n)) {
+                    /* Value computed by the worker
+                       ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+                    _tmp                = &_tile->cells[(((_i - 1) % _dy) * _dx) + ((_j - 1) % _dx)];
+               }
+
+               if (_tmp != NULL) {
+                    _cell->value        = _tmp->value;
+                    _cell->color        = _tmp->color;
+                    _cell->ready        = TRUE;
+                    strcpy(_cell->text, _tmp->text);
+               }
+               else {
+                    fd_placeholder(_cell, view->sz);
+                    if (_i <= _ready || _i > _provider->n) {
+                         _missing++;
+                    }
+               }
+          }
+     }
+
+     pthread_mutex_unlock(&view->cache.lock);
+
+     return _missing;
+}
+
+// }}}
+// fd_print_matrix() {{{
+/******************************************************************************
+
+                         FD_PRINT_MATRIX
+
+     Only the cells whose content changed since the previous frame are
+     redrawn : values still visible after a move are taken from the previous
+     frame instead of being recomputed. The other values are computed by
+     the worker : the frame waits for them at most FD_FRAME_DELAY ms, then
+     displays placeholders instead of the missing values.
+
+******************************************************************************/
+void fd_print_matrix(fd_ref_viewport view, fd_ref_matrix_elt matrix_elt,
+                     fd_ref_rectangle rect)
+{
+     int             _x, _y, _sz, _r, _c, _dx, _dy, _reuse,
+                     _first_coords, _last_coords, _first_value, _last_value;
+     int64_t         _di, _dj;
+     fd_matrix_elt   _matrix_elt, *_old;
+     fd_ref_cell     _cell, _prev, _tmp;
+
+     /* Copy viewport parameters locally
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _dx            = view->dx;
+     _dy            = view->dy;
+     _sz            = view->sz;
+     _old           = &view->origin;
+
+     /* Copy matrix parameters locally
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _matrix_elt.n  = matrix_elt->n;
+     _matrix_elt.p  = matrix_elt->p;
+
+     /* Scroll the window for a move along the lines or along the columns
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _reuse         = view->valid
+                    && _old->n == matrix_elt->n && _old->p == matrix_elt->p;
+     _di            = matrix_elt->pos.i - _old->pos.i;
+     _dj            = matrix_elt->pos.j - _old->pos.j;
+     if (_reuse && ((_di != 0 && llabs(_di) < _dy && _dj == 0)
+                ||  (_di == 0 && _dj != 0 && llabs(_dj) < _dx))) {
+          fd_scroll_viewport(view, _di, _dj);
+     }
+
+     /* Get the values, waiting a little for the worker if needed
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if ((view->missing = fd_lookup_cells(view, matrix_elt)) > 0) {
+          fd_cache_wait(&view->cache, FD_FRAME_DELAY);
+          view->missing  = fd_lookup_cells(view, matrix_elt);
+     }
+
+     _x             = 1;
+
+     for (_r = 0; _r < _dy; _r++) {
+          _y             = 3 * _r;
+          _first_coords  = _first_value = _dx;
+          _last_coords   = _last_value  = -1;
+
+          for (_c = 0; _c < _dx; _c++) {
+               _cell               = &view->cells[(_r * _dx) + _c];
+               _prev               = &view->prev[(_r * _dx) + _c];
+
+               /* Find the span of the cells to redraw
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (!view->valid
+               ||  _prev->pos.i != _cell->pos.i || _prev->pos.j != _cell->pos.j) {
+                    if (_first_coords == _dx) {
+                         _first_coords       = _c;
+                    }
+                    _last_coords        = _c;
+               }
+
+               if (!view->valid || _prev->color != _cell->color
+               ||  strcmp(_prev->text, _cell->text) != 0) {
+                    if (_first_value == _dx) {
+                         _first_value        = _c;
+                    }
+                    _last_value         = _c;
+               }
+          }
+
+          /* Display colorized coordinates of the elements
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          if (_last_coords >= 0) {
+               for (_c = _first_coords; _c <= _last_coords; _c++) {
+                    fd_copy_pos(&_matrix_elt.pos, &view->cells[(_r * _dx) + _c].pos);
+                    fd_coords_chstr(view->line + ((_sz + 1) * _c), &_matrix_elt, _sz);
+               }
+               mvwaddchnstr(view->win, _y, _x + ((_sz + 1) * _first_coords),
+                           view->line + ((_sz + 1) * _first_coords),
+                           (_sz + 1) * (_last_coords - _first_coords + 1));
+          }
+
+          /* Colorize component values
+             ~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          if (_last_value >= 0) {
+               for (_c = _first_value; _c <= _last_value; _c++) {
+                    fd_value_chstr(view->line + ((_sz + 1) * _c),
+                                   &view->cells[(_r * _dx) + _c], _sz);
+               }
+               mvwaddchnstr(view->win, _y + 1, _x + ((_sz + 1) * _first_value),
+                           view->line + ((_sz + 1) * _first_value),
+                           (_sz + 1) * (_last_value - _first_value + 1));
+          }
+     }
+
+     /* The current frame becomes the previous one
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _tmp           = view->prev;
+     view->prev     = view->cells;
+     view->cells    = _tmp;
+     view->origin   = *matrix_elt;
+     view->valid    = TRUE;
+
+     move(rect->y2, 1);
+     wnoutrefresh(stdscr);
+     wnoutrefresh(view->win);
+     doupdate();
+}
+
+// }}}
+// fd_get_pos() {{{
+
+/******************************************************************************
+
+                         FD_GET_POS
+
+******************************************************************************/
+void fd_get_pos(char letter, fd_pos *pos, fd_matrix_elt *mat, fd_pos *corner)
+{
+     pos->i         = corner->i + (letter - 'a') / 6;
+     pos->j         = corner->j + ((letter - 'a') % 6) * (6 + mat->sz_n + mat->sz_p);
+}
+
+// }}}
+// fd_disp_markers() {{{
+
+/******************************************************************************
+
+                         FD_DISP_MARKERS
+
+******************************************************************************/
+void fd_disp_markers(fd_pos *pos, fd_matrix_elt *matrix, fd_pos *corner)
+{
+     char                 _l;
+     int                  _n;
+     fd_pos               _pos;
+
+     for (_l = 'a'; _l <= 'z'; _l++) {
+          _n                  = FD_POS_IDX(_l);
+          fd_get_pos(_l, &_pos, matrix, corner);
+          move(_pos.i, _pos.j);
+          if (pos[_n].i != FD_UNDEF_POS && pos[_n].j != FD_UNDEF_POS) {
+               printw("%c[%*ld, %*ld]", _l, matrix->sz_n, (long) pos[_n].i,
+                      matrix->sz_p, (long) pos[_n].j);
+          }
+     }
+
+     fd_get_pos('z' + 1, &_pos, matrix, corner);
+     move(_pos.i, _pos.j);
+     _n                  = 0;
+     if (pos[_n].i != FD_UNDEF_POS && pos[_n].j != FD_UNDEF_POS) {
+          printw("%c[%*ld, %*ld]", '\'', matrix->sz_n, (long) pos[_n].i,
+                 matrix->sz_p, (long) pos[_n].j);
+     }
+}
+
+// }}}
+// fd_init_pos() {{{
+/******************************************************************************
+
+                              FD_INIT_POS
+
+******************************************************************************/
+void fd_init_pos(fd_ref_pos ref_pos)
+{
+     int             _i = 0;
+     fd_ref_pos      _pos = ref_pos;
+
+     for (_i = 0; _i <= FD_POS_IDX('z'); _i++) {
+          _pos->i        = FD_UNDEF_POS;
+          _pos->j        = FD_UNDEF_POS;
+          _pos++;
+     }
+}
+
+// }}}
+// fd_search_prompt() {{{
+/******************************************************************************
+
+                         FD_SEARCH_PROMPT
+
+     Read the description of a search on line y. Return -1 if it is empty
+     or invalid.
+
+******************************************************************************/
+int fd_search_prompt(fd_ref_search search, int y)
+{
+     char                 _text[128];
+     int                  _ret;
+
+     move(y, 0);
+     clrtoeol();
+     printw("/");
+     echo();
+     timeout(-1);
+     _ret           = getnstr(_text, sizeof(_text) - 1);
+     noecho();
+
+     move(y, 0);
+     clrtoeol();
+     if (_ret == ERR || _text[0] == 0) {
+          return -1;
+     }
+     if (fd_search_parse(search, _text) < 0) {
+          printw("Invalid search : %s", _text);
+          return -1;
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_search_cmd() {{{
+/******************************************************************************
+
+                         FD_SEARCH_CMD
+
+     Run a search from element (i, j) with one thread per processor, the
+     worker being paused, and display its result on line y. Return 1 if an
+     element was found, 0 otherwise.
+
+******************************************************************************/
+int fd_search_cmd(fd_ref_viewport view, fd_ref_provider provider, fd_ref_search search,
+                  int64_t i, int64_t j, int y)
+{
+     struct timespec      _t0, _t1;
+     double               _elapsed;
+     int                  _found;
+
+     move(y, 0);
+     clrtoeol();
+     printw("Searching ...");
+     refresh();
+
+     fd_cache_pause(view);
+     clock_gettime(CLOCK_MONOTONIC, &_t0);
+     _found         = fd_search_run(provider, search, i, j, sysconf(_SC_NPROCESSORS_ONLN));
+     clock_gettime(CLOCK_MONOTONIC, &_t1);
+     fd_cache_resume(view);
+
+     _elapsed       = (_t1.tv_sec - _t0.tv_sec) + (_t1.tv_nsec - _t0.tv_nsec) / 1e9;
+
+     move(y, 0);
+     clrtoeol();
+     if (_found) {
+          printw("Found (%ld, %ld) = %g  (%.3f s)", (long) search->i, (long) search->j,
+                 search->value, _elapsed);
+     }
+     else {
+          printw("Not found  (%.3f s)", _elapsed);
+     }
+
+     return _found;
+}
+
+// }}}
+// fd_stats_cmd() {{{
+/******************************************************************************
+
+                         FD_STATS_CMD
+
+     Display on line y the sum, the number and the mean of the elements of
+     lines i1 to i2 and of columns j1 to j2. The summed-area tables are
+     built the first time, and built again if new lines of the matrix are
+     available. The worker is paused while the provider is read.
+
+******************************************************************************/
+void fd_stats_cmd(fd_ref_viewport view, fd_ref_provider provider, fd_ref_sat sat,
+                  int64_t i1, int64_t j1, int64_t i2, int64_t j2, int y)
+{
+     struct timespec      _t0, _t1;
+     fd_sat_stats         _stats;
+
+     fd_cache_pause(view);
+
+     if (sat->hi == NULL || fd_provider_ready(provider) != sat->ready) {
+          move(y, 0);
+          clrtoeol();
+          printw("Building the summed-area tables ...");
+          refresh();
+          fd_sat_build(sat, provider, sysconf(_SC_NPROCESSORS_ONLN));
+     }
+
+     clock_gettime(CLOCK_MONOTONIC, &_t0);
+     fd_sat_stats_get(sat, i1, j1, i2, j2, &_stats);
+     clock_gettime(CLOCK_MONOTONIC, &_t1);
+
+     fd_cache_resume(view);
+
+     move(y, 0);
+     clrtoeol();
+     printw("[%ld, %ld] .. [%ld, %ld] : sum = %.15g, count = %ld, mean = %.15g  (%.3f ms)",
+            (long) i1, (long) j1, (long) i2, (long) j2, _stats.sum, (long) _stats.count, _stats.mean,
+            ((_t1.tv_sec - _t0.tv_sec) * 1e3) + ((_t1.tv_nsec - _t0.tv_nsec) / 1e6));
+}
+
+// }}}
+// fd_auto_parse() {{{
+/******************************************************************************
+
+                              FD_AUTO_PARSE
+
+     Read the percentiles of the red, yellow and green color bands in text,
+     as three increasing numbers separated by commas.
+     Return 0 if they are valid, -1 otherwise.
+
+******************************************************************************/
+int fd_auto_parse(char *text, double *pct)
+{
+     char                *_end;
+     int                  _k;
+
+     for (_k = 0; _k < 3; _k++) {
+          pct[_k]        = strtod(text, &_end);
+          if (_end == text || pct[_k] < 0 || pct[_k] > 100
+          ||  (_k > 0 && pct[_k] < pct[_k - 1])) {
+               return -1;
+          }
+          if (*_end != (_k < 2 ? ',' : 0)) {
+               return -1;
+          }
+          text           = _end + 1;
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_resolve_scale() {{{
+/******************************************************************************
+
+                              FD_RESOLVE_SCALE
+
+     Set the thresholds of a scale given as percentiles, from a quantile
+     sketch of the elements of the matrix built in one parallel pass (on a
+     sample of the lines for huge matrices). A threshold lower than the
+     previous one is raised to it, so that the thresholds stay sorted.
+     Return the number of elements read (0 if the scale has no percentile).
+
+******************************************************************************/
+int64_t fd_resolve_scale(fd_ref_scale scale, fd_ref_provider provider)
+{
+     fd_kll               _kll;
+     int64_t              _nb;
+     int                  _t;
+
+     for (_t = 0; _t < scale->nb && isnan(scale->pct[_t]); _t++) {
+     }
+     if (_t == scale->nb) {
+          return 0;
+     }
+
+     fd_kll_init(&_kll, 1);
+     _nb                 = fd_kll_scan(&_kll, provider, sysconf(_SC_NPROCESSORS_ONLN));
+
+     for (_t = 0; _t < scale->nb; _t++) {
+          if (!isnan(scale->pct[_t])) {
+               scale->thr[_t]      = _nb > 0 ? fd_kll_quantile(&_kll, scale->pct[_t] / 100) : 0;
+          }
+          if (_t > 0 && scale->thr[_t] < scale->thr[_t - 1]) {
+               scale->thr[_t]      = scale->thr[_t - 1];
+          }
+     }
+     fd_kll_free(&_kll);
+
+     return _nb;
+}
+
+// }}}
+// fd_heat_pair() {{{
+
+/******************************************************************************
+
+                         FD_HEAT_PAIR
+
+     Return the color pair of a block of the heatmap starting at element
+     (i, j) : 0 outside of the matrix, white if no element is available,
+     the color pair of the aggregate otherwise.
+
+******************************************************************************/
+int fd_heat_pair(fd_ref_zoom zoom, int64_t i, int64_t j)
+{
+     fd_aggr         _aggr;
+     double          _v;
+
+     if (i > zoom->pyr.provider->n || j > zoom->pyr.provider->p) {
+          return 0;
+     }
+
+     fd_pyramid_get(&zoom->pyr, i, j, zoom->block, &_aggr);
+     if (_aggr.count == 0) {
+          return FD_WHITE;
+     }
+
+     switch (zoom->aggr) {
 
-     _i                  = matrix_elt->pos.i;
-     _j                  = matrix_elt->pos.j;
-     _n                  = matrix_elt->n;
-     _p                  = matrix_elt->p;
+     case FD_ZOOM_MIN:
+          _v             = _aggr.min;
+          break;
 
-     if (_i == _j) {
-          _val           = _n * _coeff;
-     }
-     else {
-          _val           = (_n - abs(_i - _j)) * _coeff;
+     case FD_ZOOM_MAX:
+          _v             = _aggr.max;
+          break;
+
+     default:
+          _v             = _aggr.mean;
+          break;
      }
 
-     return _val;
+     return fd_scale_color(&fd_value_scale, _v);
 }
 
 // }}}
-// fd_max() {{{
+// fd_zoom_origin() {{{
 /******************************************************************************
 
-                         FD_MAX
+                         FD_ZOOM_ORIGIN
+
+     Set the first element of the heatmap, the heatmap being centered on
+     element (ci, cj) as far as possible.
 
 ******************************************************************************/
-int fd_max(int x, int y)
+void fd_zoom_origin(fd_ref_zoom zoom, int64_t ci, int64_t cj)
 {
-     int             _max;
+     int64_t         _n, _p, _i0, _j0, _block;
 
-     if (x >= y) {
-          _max           = x;
+     _n             = zoom->pyr.provider->n;
+     _p             = zoom->pyr.provider->p;
+     _block         = zoom->block;
+
+     _i0            = ci - ((zoom->rows * _block) / 2);
+     _j0            = cj - ((zoom->cols * _block) / 2);
+     if (_i0 + (zoom->rows * _block) - 1 > _n) {
+          _i0            = _n - (zoom->rows * _block) + 1;
      }
-     else {
-          _max           = y;
+     if (_j0 + (zoom->cols * _block) - 1 > _p) {
+          _j0            = _p - (zoom->cols * _block) + 1;
      }
 
-     return _max;
+     /* The blocks start at multiples of their size
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     zoom->i0       = _i0 < 1 ? 1 : (((_i0 - 1) / _block) * _block) + 1;
+     zoom->j0       = _j0 < 1 ? 1 : (((_j0 - 1) / _block) * _block) + 1;
 }
 
 // }}}
-// fd_save_pos() {{{
+// fd_zoom_enter() {{{
 /******************************************************************************
 
-                         FD_SAVE_POS
+                         FD_ZOOM_ENTER
+
+     Display the heatmap of the blocks of 2 x 2 elements around element
+     (ci, cj). The pyramid is built the first time, and built again if new
+     lines of the matrix are available. The worker is paused, the display
+     thread reading the provider while the heatmap is displayed.
 
 ******************************************************************************/
-void fd_save_pos(fd_ref_matrix_elt ref_mat, fd_ref_pos ref_pos)
+void fd_zoom_enter(fd_ref_zoom zoom, fd_ref_viewport view, fd_ref_provider provider,
+                   int64_t ci, int64_t cj, int y)
 {
-     ref_pos->i          = ref_mat->pos.i;
-     ref_pos->j          = ref_mat->pos.j;
-}
+     struct timespec      _t0, _t1;
 
-// }}}
-// fd_copy_pos() {{{
-/******************************************************************************
+     fd_cache_pause(view);
 
-                         FD_COPY_POS
+     if (!zoom->built || fd_provider_ready(provider) != zoom->pyr.ready) {
+          move(y, 0);
+          clrtoeol();
+          printw("Building the pyramid ...");
+          refresh();
 
-******************************************************************************/
-void fd_copy_pos(fd_ref_pos dst_pos, fd_ref_pos src_pos)
-{
-     dst_pos->i          = src_pos->i;
-     dst_pos->j          = src_pos->j;
+          clock_gettime(CLOCK_MONOTONIC, &_t0);
+          fd_pyramid_build(&zoom->pyr, provider, sysconf(_SC_NPROCESSORS_ONLN));
+          clock_gettime(CLOCK_MONOTONIC, &_t1);
+          zoom->built    = TRUE;
+
+          move(y, 0);
+          clrtoeol();
+          printw("Pyramid of %d levels built in %.3f s", zoom->pyr.nb_levels,
+                 (_t1.tv_sec - _t0.tv_sec) + (_t1.tv_nsec - _t0.tv_nsec) / 1e9);
+     }
+
+     zoom->half     = MB_CUR_MAX > 1 && COLOR_PAIRS > FD_HEAT_PAIR(7, 7);
+     zoom->rows     = ((3 * view->dy) - 1) * (zoom->half ? 2 : 1);
+     zoom->cols     = ((view->sz + 1) * view->dx) + 1;
+     zoom->block    = 2;
+     fd_zoom_origin(zoom, ci, cj);
+
+     view->missing  = 0;
+     werase(view->win);
 }
 
 // }}}
-// fd_new_pos() {{{
+// fd_zoom_leave() {{{
 /******************************************************************************
 
-                         FD_NEW_POS
+                         FD_ZOOM_LEAVE
+
+     Go back to the display of the elements, and let the worker compute
+     them again.
 
 ******************************************************************************/
-void fd_new_pos(fd_ref_pos curr_pos, fd_ref_pos new_pos, fd_ref_pos old_pos)
+void fd_zoom_leave(fd_ref_zoom zoom, fd_ref_viewport view, int y)
 {
-     if ((curr_pos->i != new_pos->i) || (curr_pos->j != new_pos->j)) {
-          /* Store current position
-             ~~~~~~~~~~~~~~~~~~~~~~ */
-          old_pos->i          = curr_pos->i;
-          old_pos->j          = curr_pos->j;
+     zoom->block    = 1;
 
-          /* Setup new position
-             ~~~~~~~~~~~~~~~~~~ */
-          curr_pos->i         = new_pos->i;
-          curr_pos->j         = new_pos->j;
-     }
+     move(y, 0);
+     clrtoeol();
+     werase(view->win);
+     view->valid    = FALSE;
+
+     fd_cache_resume(view);
 }
 
 // }}}
-// fd_print_matrix() {{{
+// fd_zoom_key() {{{
 /******************************************************************************
 
-                         FD_PRINT_MATRIX
+                         FD_ZOOM_KEY
+
+     Apply a key to the heatmap. Return FALSE if the key is not a command
+     of the heatmap.
 
 ******************************************************************************/
-void fd_print_matrix(fd_ref_matrix_elt matrix_elt, fd_ref_sub_matrix delta,
-                     fd_ref_rectangle rect, int sz)
+int fd_zoom_key(fd_ref_zoom zoom, int ch)
 {
-     char            _buf[256], *_dyn_buf, *_ptr;
-     int             _min_width, _value, _color_pair,
-                     _x1, _x2, _y1, _y2, _x, _y,
-                     _i, _j, _i0, _j0,
-                     _n, _p, _dx, _dy;
-     fd_matrix_elt   _matrix_elt;
-
-     /* Copy rectangle parameters locally
-        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-     _x1            = rect->x1;
-     _x2            = rect->x2;
-     _y1            = rect->y1;
-     _y2            = rect->y2;
-
-     /* Copy delta parameters
-        ~~~~~~~~~~~~~~~~~~~~~ */
-     _dx            = delta->dx;
-     _dy            = delta->dy;
-
-     /* Copy matrix parameters locally
-        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-     _i0            = matrix_elt->pos.i;
-     _j0            = matrix_elt->pos.j;
-     _n             = matrix_elt->n;
-     _p             = matrix_elt->p;
-
-     _min_width     = _x2 - _x1 + 1;
-
-     /* Check buffer size
-        ~~~~~~~~~~~~~~~~~ */
-     if (sizeof(_buf) < (_min_width + 1)) {
-          if ((_dyn_buf = malloc(_min_width + 1)) == NULL) {
-               fprintf(stderr, "Malloc error !\n");
-               exit(1);
+     int64_t         _ci, _cj, _n, _p;
+
+     _n             = zoom->pyr.provider->n;
+     _p             = zoom->pyr.provider->p;
+     _ci            = zoom->i0 + ((zoom->rows * zoom->block) / 2);
+     _cj            = zoom->j0 + ((zoom->cols * zoom->block) / 2);
+
+     switch (ch) {
+
+     case KEY_LEFT:
+          _cj           -= zoom->block;
+          break;
+
+     case KEY_RIGHT:
+          _cj           += zoom->block;
+          break;
+
+     case KEY_UP:
+          _ci           -= zoom->block;
+          break;
+
+     case KEY_DOWN:
+          _ci           += zoom->block;
+          break;
+
+     case FD_CTRL_B:
+     case KEY_PPAGE:
+          _ci           -= zoom->rows * zoom->block;
+          break;
+
+     case FD_CTRL_F:
+     case KEY_NPAGE:
+          _ci           += zoom->rows * zoom->block;
+          break;
+
+     case KEY_BTAB:
+          _cj           -= zoom->cols * zoom->block;
+          break;
+
+     case KEY_STAB:
+     case '\t':
+          _cj           += zoom->cols * zoom->block;
+          break;
+
+     case KEY_HOME:
+          _ci            = 1;
+          _cj            = 1;
+          break;
+
+     case 'z':
+          /* Zoom out, up to the whole matrix
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          if (zoom->rows * zoom->block < _n || zoom->cols * zoom->block < _p) {
+               zoom->block   *= 2;
           }
-          _ptr           = _dyn_buf;
-     }
-     else {
-          _dyn_buf       = 0;
-          _ptr           = _buf;
-     }
-
-     /* Initialize next cursor position
-        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-     _y             = _y1 + 1;
-     _x             = _x1 + 2;
-
-     for (_i = _i0; _i < _i0 +_dy; _i++) {
-          move(_y, _x);
-
-          for (_j = _j0; _j < _j0 + _dx; _j++) {
-               int                 _sz = sz + 1;
+          break;
 
-               /* Display colorized coordinates of the element
-                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-               _color_pair         = FD_BLUE;
-               attron(COLOR_PAIR(_color_pair));
-               printw("[");
-               _sz--;
-               attroff(COLOR_PAIR(_color_pair));
-
-               if (_i == 1) {
-                    _color_pair         = FD_GREEN;
-               }
-               else if (_i == _n) {
-                    _color_pair         = FD_RED;
-               }
-               else if (_i == _j) {
-                    _color_pair         = FD_CYAN;
-               }
-               else {
-                    _color_pair         = FD_BLUE;
-               }
-               attron(COLOR_PAIR(_color_pair));
-               printw("%d", _i);
-               _sz                 -= sprintf(_buf, "%d", _i);
-               attroff(COLOR_PAIR(_color_pair));
+     case 'Z':
+          /* Zoom in, down to the elements
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          zoom->block   /= 2;
+          break;
 
-               _color_pair         = FD_BLUE;
-               attron(COLOR_PAIR(_color_pair));
-               printw(", ");
-               _sz                 -= 2;
-               attroff(COLOR_PAIR(_color_pair));
+     case '\n':
+     case KEY_ENTER:
+          zoom->block    = 1;
+          break;
 
-               if (_j == 1) {
-                    _color_pair         = FD_GREEN;
-               }
-               else if (_j == _p) {
-                    _color_pair         = FD_RED;
-               }
-               else if (_i == _j) {
-                    _color_pair         = FD_CYAN;
-               }
-               else {
-                    _color_pair         = FD_BLUE;
-               }
-               attron(COLOR_PAIR(_color_pair));
-               printw("%d", _j);
-               _sz                 -= sprintf(_buf, "%d", _j);
-               attroff(COLOR_PAIR(_color_pair));
+     case 'A':
+          zoom->aggr     = (zoom->aggr + 1) % FD_ZOOM_NB;
+          break;
 
-               _color_pair         = FD_BLUE;
-               attron(COLOR_PAIR(_color_pair));
-               printw("%-*s", _sz, "]");
-               attroff(COLOR_PAIR(_color_pair));
-          }
-          _y++;
-          move(_y, _x);
+     case ERR:
+          break;
 
-          _matrix_elt.pos.i   = matrix_elt->pos.i;
-          _matrix_elt.pos.j   = matrix_elt->pos.j;
-          _matrix_elt.n       = matrix_elt->n;
-          _matrix_elt.p       = matrix_elt->p;
+     case '\033':
+     case 'q':
+     case KEY_F(4):
+          return FALSE;
 
-          /* Colorize component value
-             ~~~~~~~~~~~~~~~~~~~~~~~~ */
-          for (_j = _j0; _j < _j0 + _dx; _j++) {
-               _matrix_elt.pos.i   = _i;
-               _matrix_elt.pos.j   = _j;
-               _value              = fd_value(&_matrix_elt);
-               if (_i > _matrix_elt.n || _j > _matrix_elt.p) {
-                    _color_pair         = FD_WHITE;
-               }
-               else if (_value >= 9000) {
-                    _color_pair         = FD_GREEN;
-               }
-               else if (_value >= 8000) {
-                    _color_pair         = FD_YELLOW;
-               }
-               else if (_value >= 7000) {
-                    _color_pair         = FD_RED;
-               }
-               else if (_value < 0) {
-                    _color_pair         = FD_RED_REV;
-               }
-               else {
-                    _color_pair         = FD_BLUE;
-               }
-               attron(COLOR_PAIR(_color_pair));
-               printw("%*f", sz, (double) fd_value(&_matrix_elt));
-               attroff(COLOR_PAIR(_color_pair));
-               printw(" ");
-          }
-          _y        += 2;
-// mvprintw(y1 + 1, _x1 + 2, s);
+     default:
+          return TRUE;
      }
 
-     move(_y, 1);
-     refresh();
-
-     if (_dyn_buf) {
-          free(_dyn_buf);
+     if (zoom->block > 1) {
+          fd_zoom_origin(zoom, _ci, _cj);
+     }
+     else {
+          /* Center of the heatmap, for the display of the elements
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          zoom->i0       = _ci < 1 ? 1 : _ci > _n ? _n : _ci;
+          zoom->j0       = _cj < 1 ? 1 : _cj > _p ? _p : _cj;
      }
-}
-
-// }}}
-// fd_get_pos() {{{
-
-/******************************************************************************
-
-                         FD_GET_POS
 
-******************************************************************************/
-void fd_get_pos(char letter, fd_pos *pos, fd_matrix_elt *mat, fd_pos *corner)
-{
-     pos->i         = corner->i + (letter - 'a') / 6;
-     pos->j         = corner->j + ((letter - 'a') % 6)
-                                   * (8 + log10(mat->n) + log10(mat->p));
+     return TRUE;
 }
 
 // }}}
-// fd_disp_markers() {{{
-
+// fd_print_heatmap() {{{
 /******************************************************************************
 
-                         FD_DISP_MARKERS
+                         FD_PRINT_HEATMAP
+
+     Display the heatmap of the blocks, and its description on line y.
+     Each block costs a single read of the pyramid.
 
 ******************************************************************************/
-void fd_disp_markers(fd_pos *pos, fd_matrix_elt *matrix, fd_pos *corner)
+void fd_print_heatmap(fd_ref_viewport view, fd_ref_zoom zoom, fd_ref_rectangle rect, int y)
 {
-     char                 _l;
-     int                  _n, _sz_n, _sz_p;
-     fd_pos               _pos;
-
-     _sz_n               = log10(matrix->n) + 1;
-     _sz_p               = log10(matrix->p) + 1;
-
-     for (_l = 'a'; _l <= 'z'; _l++) {
-          _n                  = FD_POS_IDX(_l);
-          fd_get_pos(_l, &_pos, matrix, corner);
-          move(_pos.i, _pos.j);
-          if (pos[_n].i != FD_UNDEF_POS && pos[_n].j != FD_UNDEF_POS) {
-               printw("%c[%*d, %*d]", _l, _sz_n, pos[_n].i, _sz_p, pos[_n].j);
+     int             _y, _x, _up, _down, _lines;
+     int64_t         _i, _j, _block;
+     cchar_t         _half;
+
+     _block         = zoom->block;
+     _lines         = (3 * view->dy) - 1;
+
+     /* The lower right character must not scroll the window
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     scrollok(view->win, FALSE);
+
+     for (_y = 0; _y < _lines; _y++) {
+          for (_x = 0; _x < zoom->cols; _x++) {
+               _j             = zoom->j0 + (_x * _block);
+               if (zoom->half) {
+                    _i             = zoom->i0 + (2 * _y * _block);
+                    _up            = fd_heat_pair(zoom, _i, _j);
+                    _down          = fd_heat_pair(zoom, _i + _block, _j);
+                    setcchar(&_half, FD_HALF_BLOCK, A_NORMAL,
+                             FD_HEAT_PAIR(fd_heat_colors[_up], fd_heat_colors[_down]), NULL);
+                    mvwadd_wch(view->win, _y, _x, &_half);
+               }
+               else {
+                    /* One block per character, with the colors of the values
+                       ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+                    _i             = zoom->i0 + (_y * _block);
+                    _up            = fd_heat_pair(zoom, _i, _j);
+                    mvwaddch(view->win, _y, _x, ' ' | COLOR_PAIR(_up)
+                                                | (_up != FD_RED_REV && _up != 0 ? A_REVERSE : 0));
+               }
           }
      }
 
-     fd_get_pos('z' + 1, &_pos, matrix, corner);
-     move(_pos.i, _pos.j);
-     _n                  = 0;
-     if (pos[_n].i != FD_UNDEF_POS && pos[_n].j != FD_UNDEF_POS) {
-          printw("%c[%*d, %*d]", '\'', _sz_n, pos[_n].i, _sz_p, pos[_n].j);
-     }
+     scrollok(view->win, TRUE);
+
+     move(y, 0);
+     clrtoeol();
+     printw("Zoom : %s of %ld x %ld blocks from (%ld, %ld)", fd_zoom_names[zoom->aggr],
+            (long) _block, (long) _block, (long) zoom->i0, (long) zoom->j0);
+
+     move(rect->y2, 1);
+     wnoutrefresh(stdscr);
+     wnoutrefresh(view->win);
+     doupdate();
 }
 
 // }}}
-// fd_init_pos() {{{
+// fd_usage() {{{
+
 /******************************************************************************
 
-                              FD_INIT_POS
+                              FD_USAGE
 
 ******************************************************************************/
-void fd_init_pos(fd_ref_pos ref_pos)
+void fd_usage(char *progname)
 {
-     int             _i = 0;
-     fd_ref_pos      _pos = ref_pos;
-
-     for (_i = 0; _i <= FD_POS_IDX('z'); _i++) {
-          _pos->i        = FD_UNDEF_POS;
-          _pos->j        = FD_UNDEF_POS;
-          _pos++;
-     }
+     fprintf(stderr, "Usage: %s [--expr formula] l c n p dy dx i0 j0\n", progname);
+     fprintf(stderr, "       %s -f file l c dy dx i0 j0\n", progname);
+     fprintf(stderr, "       %s -m file l c dy dx i0 j0\n", progname);
+     fprintf(stderr, "       %s -c file l c dy dx i0 j0\n", progname);
+     fprintf(stderr, "       %s -s file l c dy dx i0 j0\n", progname);
+     fprintf(stderr, "       %s -P plugin[:arg] l c dy dx i0 j0\n", progname);
+     fprintf(stderr, "  l  : line number of rectangle top\n");
+     fprintf(stderr, "  c  : column number of rectangle top\n");
+     fprintf(stderr, "  n  : number of lines of the matrix\n");
+     fprintf(stderr, "  p  : number of columns of the matrix\n");
+     fprintf(stderr, "  dy : height of the sub-matrix\n");
+     fprintf(stderr, "  dx : width of the sub-matrix\n");
+     fprintf(stderr, "  i0 : index of the first sub-matrix element\n");
+     fprintf(stderr, "  j0 : index of the first sub-matrix element\n");
+     fprintf(stderr, "  --expr : formula of the generated matrix, in i, j, n and p\n");
+     fprintf(stderr, "           (default : %s)\n", FD_DEFAULT_EXPR);
+     fprintf(stderr, "  -f : display the matrix of a binary matrix file\n");
+     fprintf(stderr, "  -m : same as -f, the matrix being loaded in memory\n");
+     fprintf(stderr, "  -c : same as -m, the matrix being compressed\n");
+     fprintf(stderr, "  -s : display the sparse matrix of a Matrix Market file\n");
+     fprintf(stderr, "  -P : display the matrix of a provider loaded from a shared object,\n");
+     fprintf(stderr, "       which receives arg\n");
+     fprintf(stderr, "  --auto[=r,y,g] : set the thresholds of the red, yellow and green\n");
+     fprintf(stderr, "                   colors at percentiles of the elements\n");
+     fprintf(stderr, "                   (default : %s)\n", FD_DEFAULT_AUTO);
+     fprintf(stderr, "  -T, --scale scale|@file : color scale of the values, as colors\n");
+     fprintf(stderr, "                   (%s) separated by increasing thresholds,\n",
+             FD_PALETTE);
+     fprintf(stderr, "                   a threshold followed by %% being a percentile\n");
+     fprintf(stderr, "                   (default : %s)\n", FD_DEFAULT_SCALE);
+     fprintf(stderr, "  --bytes : display the number of bytes sent to the terminal for\n");
+     fprintf(stderr, "            each frame (curses then writes to a pseudo-terminal)\n");
+     exit(1);
 }
 
 // }}}
@@ -491,53 +2258,216 @@ void fd_init_pos(fd_ref_pos ref_pos)
 ******************************************************************************/
 int main(int argc, char *argv[])
 {
-     int                  _ch, _sz, _n = 0, _prev_cmd = FD_CMD_NIL, _i, _j;
+     int                  _ch, _sz, _prev_cmd = FD_CMD_NIL, _opt;
+     int64_t              _n = 0, _i, _j;
      fd_rectangle         _rect;
      fd_matrix_elt        _matrix_elt;
+     fd_mmap              _map;
+     fd_csr               _csr;
+     fd_tiled             _tiled;
+     fd_ctiled            _ctiled;
+     fd_provider          _provider;
+     char                *_file = NULL, *_sparse_file = NULL, **_args;
+     char                *_plugin = NULL, *_plugin_arg = NULL;
+     char                *_expr = NULL, *_auto = NULL, *_scale = NULL;
+     double               _pct[3];
+     int64_t              _nb_auto = 0;
+     struct timespec      _t0, _t1;
+     static struct option _long_opts[] = {
+          { "expr",      required_argument,  NULL, 'e' },
+          { "auto",      optional_argument,  NULL, 'a' },
+          { "scale",     required_argument,  NULL, 'T' },
+          { "bytes",     no_argument,        NULL, 'B' },
+          { NULL,        0,                  NULL, 0   }
+     };
+     int                  _in_memory = FALSE, _compressed = FALSE, _di = 0, _dj = 0;
+     int                  _count_bytes = FALSE;
+     int                  _next = ERR, _nb_fold = 0, _found = FALSE;
+     fd_search            _search, _extremum;
+     fd_zoom              _zoom;
+     fd_sat               _sat;
+     short                _up, _down;
+     MEVENT               _event;
      fd_sub_matrix        _sub_matrix;
+     fd_viewport          _view;
      char                 _buf[256];         // XXX
      fd_pos               _pos['z' - 'a' + 2], _prev_pos, _new_pos, _corner;
 
+     fd_scale_parse(&fd_value_scale, FD_DEFAULT_SCALE, FD_PALETTE);
+
      /* Check command arguments
         ~~~~~~~~~~~~~~~~~~~~~~~ */
-     if (argc != 9) {
-          fprintf(stderr, "Usage: %s l c n p i0 j0\n", argv[0]);
-          fprintf(stderr, "  l  : line number of rectangle top\n");
-          fprintf(stderr, "  c  : column number of rectangle top\n");
-          fprintf(stderr, "  n  : number of lines of the matrix\n");
-          fprintf(stderr, "  p  : number of columns of the matrix\n");
-          fprintf(stderr, "  dy : height of the sub-matrix\n");
-          fprintf(stderr, "  dx : width of the sub-matrix\n");
-          fprintf(stderr, "  i0 : index of the first sub-matrix element\n");
-          fprintf(stderr, "  j0 : index of the first sub-matrix element\n");
-          exit(1);
+     while ((_opt = getopt_long(argc, argv, "c:e:f:m:s:P:T:", _long_opts, NULL)) != -1) {
+          switch (_opt) {
+
+          case 'c':
+               _compressed    = TRUE;
+               /* FALLTHROUGH */
+          case 'm':
+               _in_memory     = TRUE;
+               /* FALLTHROUGH */
+          case 'f':
+               _file          = optarg;
+               break;
+
+          case 'e':
+               _expr          = optarg;
+               break;
+
+          case 'a':
+               _auto          = optarg ? optarg : FD_DEFAULT_AUTO;
+               if (fd_auto_parse(_auto, _pct) < 0) {
+                    fprintf(stderr, "%s: %s: invalid percentiles !\n", argv[0], _auto);
+                    exit(1);
+               }
+               snprintf(_buf, sizeof(_buf), FD_AUTO_SCALE, _pct[0], _pct[1], _pct[2]);
+               fd_scale_parse(&fd_value_scale, _buf, FD_PALETTE);
+               break;
+
+          case 'T':
+               _scale         = optarg;
+               if (*_scale == '@') {
+                    if (fd_scale_load(&fd_value_scale, _scale + 1, FD_PALETTE) < 0) {
+                         fprintf(stderr, "%s: %s: %s\n", argv[0], _scale + 1, strerror(errno));
+                         exit(1);
+                    }
+               }
+               else if (fd_scale_parse(&fd_value_scale, _scale, FD_PALETTE) < 0) {
+                    fprintf(stderr, "%s: %s: invalid scale !\n", argv[0], _scale);
+                    exit(1);
+               }
+               break;
+
+          case 's':
+               _sparse_file   = optarg;
+               break;
+
+          case 'B':
+               _count_bytes   = TRUE;
+               break;
+
+          case 'P':
+               _plugin        = optarg;
+               if ((_plugin_arg = strchr(_plugin, ':')) != NULL) {
+                    *_plugin_arg++ = 0;
+               }
+               break;
+
+          default:
+               fd_usage(argv[0]);
+               break;
+          }
+     }
+     _args               = argv + optind;
+
+     if ((_file != NULL) + (_sparse_file != NULL) + (_plugin != NULL) + (_expr != NULL) > 1
+     ||  (_auto != NULL && _scale != NULL)
+     ||  argc - optind != (_file == NULL && _sparse_file == NULL && _plugin == NULL ? 8 : 6)) {
+          fd_usage(argv[0]);
+     }
+
+     /* Select the provider of the elements
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (_file != NULL) {
+          if (fd_mmap_open(&_map, _file) < 0) {
+               fprintf(stderr, "%s: %s: %s\n", argv[0], _file, strerror(errno));
+               exit(1);
+          }
+          fd_provider_mmap(&_provider, &_map);
+          _args              += 2;
+
+          /* Copy the matrix in tiles, which keep the elements of a
+             viewport close in memory whatever the direction of the moves
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          if (_compressed) {
+               if (fd_ctile_load(&_ctiled, &_map) < 0) {
+                    fprintf(stderr, "%s: %s: %s\n", argv[0], _file, strerror(errno));
+                    exit(1);
+               }
+               fd_mmap_close(&_map);
+               fd_provider_ctiled(&_provider, &_ctiled);
+          }
+          else if (_in_memory) {
+               if (fd_tiled_load(&_tiled, &_map, FD_TILED_MORTON) < 0) {
+                    fprintf(stderr, "%s: %s: %s\n", argv[0], _file, strerror(errno));
+                    exit(1);
+               }
+               fd_mmap_close(&_map);
+               fd_provider_tiled(&_provider, &_tiled);
+          }
+     }
+     else if (_sparse_file != NULL) {
+          if (fd_sparse_load(&_csr, _sparse_file) < 0) {
+               fprintf(stderr, "%s: %s: %s\n", argv[0], _sparse_file, strerror(errno));
+               exit(1);
+          }
+          fd_provider_sparse(&_provider, &_csr);
+          _file               = _sparse_file;
+          _args              += 2;
+     }
+     else if (_plugin != NULL) {
+          if (fd_provider_open(&_provider, _plugin, _plugin_arg) < 0) {
+               fprintf(stderr, "%s: %s: %s\n", argv[0], _plugin, fd_provider_error());
+               exit(1);
+          }
+          _file               = _plugin;
+          _args              += 2;
+     }
+     else {
+          if (fd_provider_expr(&_provider, atoll(_args[2]), atoll(_args[3]),
+                               _expr ? _expr : FD_DEFAULT_EXPR) < 0) {
+               fprintf(stderr, "%s: %s: %s\n", argv[0], _expr ? _expr : FD_DEFAULT_EXPR,
+                       fd_provider_error());
+               exit(1);
+          }
+          _file               = _expr ? _expr : FD_DEFAULT_EXPR;
+          _args              += 4;
      }
 
-     /* Copy matrix dimensions
-        ~~~~~~~~~~~~~~~~~~~~~~ */
-     _matrix_elt.n       = atoi(argv[3]);
-     _matrix_elt.p       = atoi(argv[4]);
-     _matrix_elt.pos.i   = atoi(argv[7]);
-     _matrix_elt.pos.j   = atoi(argv[8]);
+     /* Copy matrix dimensions, and the widths of the coordinates
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _matrix_elt.n       = _provider.n;
+     _matrix_elt.p       = _provider.p;
+     _matrix_elt.sz_n    = fd_fmt_nb_digits(_matrix_elt.n);
+     _matrix_elt.sz_p    = fd_fmt_nb_digits(_matrix_elt.p);
+     _matrix_elt.provider = &_provider;
+     _matrix_elt.pos.i   = atoll(_args[2]);
+     _matrix_elt.pos.j   = atoll(_args[3]);
 
      /* Copy sub-matrix parameters
         ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-     _sub_matrix.dy      = atoi(argv[5]);
-     _sub_matrix.dx      = atoi(argv[6]);
+     _sub_matrix.dy      = atoi(_args[0]);
+     _sub_matrix.dx      = atoi(_args[1]);
 
      _sz                 = 12;
-     _sz                 = fd_max(_sz, sprintf(_buf, "(%d, %d)", _matrix_elt.n, _matrix_elt.p));
+     _sz                 = fd_max(_sz, _matrix_elt.sz_n + _matrix_elt.sz_p + 4);
 
      /* Copy rectangle parameters
         ~~~~~~~~~~~~~~~~~~~~~~~~~ */
-     _rect.y1            = atoi(argv[1]);
-     _rect.x1            = atoi(argv[2]);
+     _rect.y1            = atoi(argv[optind]);
+     _rect.x1            = atoi(argv[optind + 1]);
      _rect.y2            = _rect.y1 + (3 * _sub_matrix.dy);
      _rect.x2            = _rect.x1 + ((_sz + 1) * _sub_matrix.dx) + 2;
 
-     /* Initialize position marks
-        ~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     /* Set the thresholds of the color scale given as percentiles, from a
+        quantile sketch of the elements built in one parallel pass
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     clock_gettime(CLOCK_MONOTONIC, &_t0);
+     _nb_auto            = fd_resolve_scale(&fd_value_scale, &_provider);
+     clock_gettime(CLOCK_MONOTONIC, &_t1);
+
+     /* Initialize the cells of the viewport
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     fd_init_viewport(&_view, &_sub_matrix, _sz);
+     fd_cache_start(&_view, &_provider);
+
+     /* Initialize position marks and searches
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
      fd_init_pos(_pos);
+     memset(&_search, 0, sizeof(_search));
+     memset(&_zoom, 0, sizeof(_zoom));
+     memset(&_sat, 0, sizeof(_sat));
+     _zoom.block         = 1;
      fd_save_pos(&_matrix_elt, &_prev_pos);
 
      _corner.i           = 1;
@@ -545,11 +2475,31 @@ int main(int argc, char *argv[])
 
      /* Initialize window
         ~~~~~~~~~~~~~~~~~ */
-     initscr();               /* Start curses mode */
+     setlocale(LC_CTYPE, "");   /* Half blocks of the heatmap */
+     if (_count_bytes) {
+          /* Start curses mode on a pseudo-terminal, to count the bytes
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          if (fd_term_open(&fd_terminal, STDOUT_FILENO) < 0) {
+               fprintf(stderr, "%s: cannot create a pseudo-terminal : %s\n", argv[0],
+                       strerror(errno));
+               exit(1);
+          }
+          if (newterm(NULL, fd_terminal.ofp, stdin) == NULL) {
+               fd_term_close(&fd_terminal);
+               fprintf(stderr, "%s: cannot initialize the terminal !\n", argv[0]);
+               exit(1);
+          }
+          fd_term_watch_size(&fd_terminal);
+     }
+     else {
+          initscr();          /* Start curses mode */
+     }
      start_color();           /* Use colors */
      raw();                   /* Line buffering disabled */
      keypad(stdscr, TRUE);    /* We get F1, F2 etc.. */
      noecho();                /* Don't echo() while we do getch */
+     mousemask(BUTTON4_PRESSED | BUTTON5_PRESSED, NULL);   /* Mouse wheel */
+     mouseinterval(0);
 
      init_color(COLOR_BLACK,    0,   0,     0);
      init_color(COLOR_RED,    800,   0,     0);
@@ -567,24 +2517,81 @@ int main(int argc, char *argv[])
      init_pair(FD_RED_REV, COLOR_BLACK,  COLOR_RED);
      init_pair(FD_WHITE,   COLOR_WHITE,  COLOR_BLACK);
 
-     printw("RPN test of matrix display\n");
-     printw("Matrix dimensions        : %5d x %5d\n", _matrix_elt.n, _matrix_elt.p);
+     if (COLOR_PAIRS > FD_HEAT_PAIR(7, 7)) {
+          for (_up = 0; _up < 8; _up++) {
+               for (_down = 0; _down < 8; _down++) {
+                    init_pair(FD_HEAT_PAIR(_up, _down), _up, _down);
+               }
+          }
+     }
+
+     printw("RPN test of matrix display%s%s\n", _file ? " : " : "", _file ? _file : "");
+     printw("Matrix dimensions        : %5ld x %5ld\n", (long) _matrix_elt.n, (long) _matrix_elt.p);
      printw("Sub-matrix dimensions    : %5d x %5d\n", _sub_matrix.dy, _sub_matrix.dx);
      printw("Rectangle position       : %3d (lines), %3d (columns)\n", _rect.y1, _rect.x1);
      printw("Rectangle dimensions     : %3d (lines), %3d (columns)\n", _rect.y2, _rect.x2);
-     printw("First sub-matrix element : (%d, %d)\n", _matrix_elt.pos.i, _matrix_elt.pos.j);
+     printw("First sub-matrix element : (%ld, %ld)\n", (long) _matrix_elt.pos.i,
+            (long) _matrix_elt.pos.j);
+     if (_auto != NULL || _scale != NULL) {
+          fd_scale_format(&fd_value_scale, _buf, sizeof(_buf), FD_PALETTE);
+          printw("Color scale              : %s", _buf);
+          if (_nb_auto > 0) {
+               printw(" (%ld values, %.3f s)", (long) _nb_auto,
+                      (_t1.tv_sec - _t0.tv_sec) + ((_t1.tv_nsec - _t0.tv_nsec) / 1e9));
+          }
+          printw("\n");
+     }
 
      /* Draw the borders of the rectangle
         ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
      fd_draw_rectangle(&_rect);
+     fd_init_window(&_view, &_rect);
 
      for (;;) {
-          /* Print visible values of the matrix
-             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-          fd_print_matrix(&_matrix_elt, &_sub_matrix, &_rect, _sz);
-          refresh();
-          move(_rect.y2 + 5, 0);
-          _ch            = getch();
+          if (_next == ERR) {
+               /* Ask the worker for the values of the viewport, and for
+                  the elements the next move will probably need
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (_count_bytes) {
+                    fd_term_count(&fd_terminal);
+               }
+               if (_zoom.block > 1) {
+                    /* Print the heatmap of the blocks
+                       ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+                    fd_print_heatmap(&_view, &_zoom, &_rect, _rect.y2 + 4);
+               }
+               else {
+                    fd_cache_plan(&_view, _matrix_elt.pos.i, _matrix_elt.pos.j, _di, _dj);
+
+                    /* Print visible values of the matrix
+                       ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+                    fd_print_matrix(&_view, &_matrix_elt, &_rect);
+               }
+               if (_count_bytes) {
+                    fd_nb_bytes    = fd_term_count(&fd_terminal);
+                    mvprintw(_rect.y2 + 2, 0, "Last frame               : %7ld bytes", fd_nb_bytes);
+               }
+               refresh();
+               move(_rect.y2 + 5, 0);
+
+               /* Poll the matrix file while it is being written
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               _ch            = fd_get_key(&_view,
+                                           fd_provider_ready(&_provider) < _matrix_elt.n
+                                           ? FD_POLL_DELAY : -1);
+               _nb_fold       = 0;
+          }
+          else {
+               _ch            = _next;
+          }
+
+          /* Keys already typed are applied before the next frame
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _next          = ERR;
+          if (_ch != ERR && ++_nb_fold < FD_MAX_FOLD) {
+               timeout(0);
+               _next          = getch();
+          }
 
           /* Copy coordinates to local variables
              ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -596,6 +2603,21 @@ int main(int argc, char *argv[])
              ~~~~~~~~~~~~~~~~~~~~~ */
           fd_save_pos(&_matrix_elt, &_prev_pos);
 
+          if (_zoom.block > 1 && fd_zoom_key(&_zoom, _ch)) {
+               if (_zoom.block > 1) {
+                    continue;
+               }
+
+               /* Back to the elements around the center of the heatmap
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               fd_zoom_leave(&_zoom, &_view, _rect.y2 + 4);
+               _i             = fd_max(1, fd_min(_zoom.i0 - (_sub_matrix.dy / 2),
+                                                 _matrix_elt.n - _sub_matrix.dy + 1));
+               _j             = fd_max(1, fd_min(_zoom.j0 - (_sub_matrix.dx / 2),
+                                                 _matrix_elt.p - _sub_matrix.dx + 1));
+               _ch            = ERR;
+          }
+
           if (FD_IS_LOWER(_ch)) {
                switch (_prev_cmd) {
 
@@ -722,6 +2744,26 @@ int main(int argc, char *argv[])
                }
                break;
 
+          case KEY_MOUSE:
+               if (getmouse(&_event) != OK) {
+                    break;
+               }
+               if (_event.bstate & BUTTON4_PRESSED) {
+                    /* Wheel up
+                       ~~~~~~~~ */
+                    _i             = fd_max(1, _i - FD_WHEEL_LINES);
+               }
+               else if ((_event.bstate & BUTTON5_PRESSED)
+                    &&  (_i + _sub_matrix.dy - 1) < _matrix_elt.n) {
+                    /* Wheel down
+                       ~~~~~~~~~~ */
+                    _i             = _i + FD_WHEEL_LINES;
+                    if ((_i + _sub_matrix.dy - 1) > _matrix_elt.n) {
+                         _i             = _matrix_elt.n - _sub_matrix.dy + 1;
+                    }
+               }
+               break;
+
           case KEY_HOME:
                _i        = 1;
                _j        = 1;
@@ -739,6 +2781,11 @@ int main(int argc, char *argv[])
                _j         = _matrix_elt.p - _sub_matrix.dx + 1;
                break;
 
+          case ERR:
+               /* No key pressed before the timeout
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               break;
+
           case '\033':
           case 'q':
                goto end;
@@ -748,6 +2795,7 @@ int main(int argc, char *argv[])
                /* Exit key
                   ~~~~~~~~ */
                printw("F4 Key pressed");
+               timeout(-1);
                getch();
                goto end;
                break;
@@ -762,7 +2810,9 @@ int main(int argc, char *argv[])
           case '7':
           case '8':
           case '9':
-               _n                  = (_n * 10) + (_ch - '0');
+               if (_n <= (INT64_MAX - 9) / 10) {
+                    _n                  = (_n * 10) + (_ch - '0');
+               }
                break;
 
           case KEY_BACKSPACE:
@@ -800,6 +2850,93 @@ int main(int argc, char *argv[])
                _n                  = 0;
                break;
 
+          case '/':
+               /* New search, from the upper left element
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (fd_search_prompt(&_search, _rect.y2 + 3) < 0) {
+                    _found         = FALSE;
+                    break;
+               }
+               _found         = fd_search_cmd(&_view, &_provider, &_search, _i, _j - 1,
+                                              _rect.y2 + 3);
+               goto found;
+
+          case 'n':
+               /* Next element of the last search
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (_search.kind == 0) {
+                    break;
+               }
+               if (_found) {
+                    _found         = fd_search_cmd(&_view, &_provider, &_search,
+                                                   _search.i, _search.j, _rect.y2 + 3);
+               }
+               else {
+                    _found         = fd_search_cmd(&_view, &_provider, &_search, _i, _j - 1,
+                                                   _rect.y2 + 3);
+               }
+               goto found;
+
+          case '+':
+          case '-':
+               /* Maximum or minimum of the matrix
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               memset(&_extremum, 0, sizeof(_extremum));
+               _extremum.kind = (_ch == '+') ? FD_SEARCH_MAX : FD_SEARCH_MIN;
+               if (!fd_search_cmd(&_view, &_provider, &_extremum, 0, 0, _rect.y2 + 3)) {
+                    break;
+               }
+               _i             = _extremum.i;
+               _j             = _extremum.j;
+               goto jump;
+
+          found:
+               if (!_found) {
+                    break;
+               }
+               _i             = _search.i;
+               _j             = _search.j;
+
+          jump:
+               /* Display the element found in the upper left cell
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if ((_i + _sub_matrix.dy - 1) > _matrix_elt.n) {
+                    _i             = fd_max(1, _matrix_elt.n - _sub_matrix.dy + 1);
+               }
+               if ((_j + _sub_matrix.dx - 1) > _matrix_elt.p) {
+                    _j             = fd_max(1, _matrix_elt.p - _sub_matrix.dx + 1);
+               }
+               break;
+
+          case 'z':
+               /* Heatmap of the blocks around the center of the viewport
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               fd_zoom_enter(&_zoom, &_view, &_provider, _i + (_sub_matrix.dy / 2),
+                             _j + (_sub_matrix.dx / 2), _rect.y2 + 4);
+               break;
+
+          case 'S':
+               /* Statistics of the viewport
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               fd_stats_cmd(&_view, &_provider, &_sat, _i, _j, _i + _sub_matrix.dy - 1,
+                            _j + _sub_matrix.dx - 1, _rect.y2 + 3);
+               break;
+
+          case 'R':
+               /* Statistics of the region between marks 'a and 'b
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (_pos[FD_POS_IDX('a')].i == FD_UNDEF_POS
+               ||  _pos[FD_POS_IDX('b')].i == FD_UNDEF_POS) {
+                    move(_rect.y2 + 3, 0);
+                    clrtoeol();
+                    printw("Marks 'a and 'b are not set");
+                    break;
+               }
+               fd_stats_cmd(&_view, &_provider, &_sat,
+                            _pos[FD_POS_IDX('a')].i, _pos[FD_POS_IDX('a')].j,
+                            _pos[FD_POS_IDX('b')].i, _pos[FD_POS_IDX('b')].j, _rect.y2 + 3);
+               break;
+
           case FD_CMD_MARK:
                _prev_cmd      = FD_CMD_MARK;
                break;
@@ -829,12 +2966,25 @@ int main(int argc, char *argv[])
 
           fd_new_pos(&_matrix_elt.pos, &_new_pos, &_pos[0]);
           fd_disp_markers(_pos, &_matrix_elt, &_corner);
+
+          /* Direction of the move
+             ~~~~~~~~~~~~~~~~~~~~~ */
+          _di            = FD_SIGN(_matrix_elt.pos.i - _prev_pos.i);
+          _dj            = FD_SIGN(_matrix_elt.pos.j - _prev_pos.j);
      }
 
 end:
      /* End curses mode
         ~~~~~~~~~~~~~~~ */
      endwin();
+     if (_count_bytes) {
+          fd_term_close(&fd_terminal);
+     }
+
+     fd_cache_stop(&_view);
+     fd_pyramid_free(&_zoom.pyr);
+     fd_sat_free(&_sat);
+     fd_provider_close(&_provider);
 
      return 0;
 }
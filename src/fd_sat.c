@@ -0,0 +1,400 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_sat.c Version 1.1 du 24/08/06 -
+ *
+ *   Summed-area tables of a matrix, giving the sum, the number and the
+ *   mean of the elements of any rectangle.
+ *
+ *   The tables hold the prefix sums of square blocks of elements, the
+ *   blocks being the smallest powers of 2 such that the tables have at
+ *   most FD_SAT_MAX_BLOCKS blocks : for a matrix small enough, they are
+ *   single elements. The blocks inside of a rectangle are summed from four
+ *   elements of the tables, the elements of its borders outside of these
+ *   blocks are read from the provider.
+ *
+ *   The sums of the blocks are computed in parallel, one line of blocks
+ *   at a time, then summed along the lines and along the columns. All the
+ *   sums are compensated (double-double arithmetic).
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "fd_elt.h"
+#include "fd_sat.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+#define   FD_MAX(x, y)        ((x) > (y) ? (x) : (y))
+#define   FD_DIV_UP(x, y)     (((x) + (y) - 1) / (y))
+
+/* Index of element (bi, bj) of the tables
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SAT_IDX(sat, bi, bj)  (((bi) * ((sat)->p + 1)) + (bj))
+
+/* Columns of the tables summed at once by a thread
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SAT_COLUMNS      (256)
+
+// }}}
+// Structures definitions {{{
+struct fd_sat_work {
+     fd_ref_sat           sat;     // Tables being built
+     int64_t              next;    // Next line or columns of blocks
+};
+typedef struct fd_sat_work          fd_sat_work;
+typedef struct fd_sat_work         *fd_ref_sat_work;
+
+// }}}
+
+// fd_dd_add() {{{
+/******************************************************************************
+
+                         FD_DD_ADD
+
+     Add (b_hi + b_lo) to (*hi + *lo), without losing the rounding errors.
+
+******************************************************************************/
+static inline void fd_dd_add(double *hi, double *lo, double b_hi, double b_lo)
+{
+     double          _s, _v, _e;
+
+     _s             = *hi + b_hi;
+     _v             = _s - *hi;
+     _e             = (*hi - (_s - _v)) + (b_hi - _v);
+     _e            += *lo + b_lo;
+     *hi            = _s + _e;
+     *lo            = _e - (*hi - _s);
+}
+
+// }}}
+// fd_sat_add_elts() {{{
+/******************************************************************************
+
+                         FD_SAT_ADD_ELTS
+
+     Add the elements of lines i1 to i2 and of columns j1 to j2 to a sum
+     and to a number of elements.
+
+******************************************************************************/
+static void fd_sat_add_elts(fd_ref_sat sat, char *elts, double *values, int64_t i1,
+                            int64_t j1, int64_t i2, int64_t j2, double *hi, double *lo,
+                            int64_t *count)
+{
+     fd_ref_provider      _provider = sat->provider;
+     int64_t              _i, _j, _w, _k;
+
+     for (_i = i1; _i <= i2; _i++) {
+          for (_j = j1; _j <= j2; _j += _w) {
+               _w             = FD_MIN(FD_SAT_CHUNK, j2 - _j + 1);
+               fd_provider_fill(_provider, _i, _j, 1, _w, elts);
+               fd_elt_to_double(_provider->elt_type, elts, _w, values);
+
+               for (_k = 0; _k < _w; _k++) {
+                    if (values[_k] == values[_k]) {
+                         fd_dd_add(hi, lo, values[_k], 0.0);
+                         (*count)++;
+                    }
+               }
+          }
+     }
+}
+
+// }}}
+// fd_sat_lines() {{{
+/******************************************************************************
+
+                         FD_SAT_LINES
+
+     Compute lines of the tables : sums of the blocks of a line of blocks,
+     summed along the line.
+
+******************************************************************************/
+static void *fd_sat_lines(void *arg)
+{
+     fd_ref_sat_work      _build = arg;
+     fd_ref_sat           _sat = _build->sat;
+     fd_ref_provider      _provider = _sat->provider;
+     char                *_elts;
+     double              *_values, *_hi, *_lo, _v;
+     int64_t             *_count, _bi, _bj, _l, _l1, _c, _w, _k, _idx;
+
+     if ((_elts   = malloc(FD_SAT_CHUNK * FD_ELT_MAX_SIZE)) == NULL
+     ||  (_values = malloc(FD_SAT_CHUNK * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     while ((_bi = __atomic_fetch_add(&_build->next, 1, __ATOMIC_RELAXED)) < _sat->n) {
+          /* Line bi + 1 of the tables, column 0 being null
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _idx           = FD_SAT_IDX(_sat, _bi + 1, 1);
+          _hi            = _sat->hi    + _idx;
+          _lo            = _sat->lo    + _idx;
+          _count         = _sat->count + _idx;
+
+          _l1            = FD_MIN((_bi + 1) * _sat->block, _sat->ready);
+          for (_l = _bi * _sat->block; _l < _l1; _l++) {
+               for (_c = 0; _c < _provider->p; _c += _w) {
+                    _w             = FD_MIN(FD_SAT_CHUNK, _provider->p - _c);
+                    fd_provider_fill(_provider, _l + 1, _c + 1, 1, _w, _elts);
+                    fd_elt_to_double(_provider->elt_type, _elts, _w, _values);
+
+                    for (_k = 0; _k < _w; _k++) {
+                         _v             = _values[_k];
+                         if (_v != _v) {
+                              continue;
+                         }
+                         _bj            = (_c + _k) >> _sat->shift;
+                         fd_dd_add(&_hi[_bj], &_lo[_bj], _v, 0.0);
+                         _count[_bj]++;
+                    }
+               }
+          }
+
+          for (_bj = 1; _bj < _sat->p; _bj++) {
+               fd_dd_add(&_hi[_bj], &_lo[_bj], _hi[_bj - 1], _lo[_bj - 1]);
+               _count[_bj]   += _count[_bj - 1];
+          }
+     }
+
+     free(_elts);
+     free(_values);
+
+     return NULL;
+}
+
+// }}}
+// fd_sat_columns() {{{
+/******************************************************************************
+
+                         FD_SAT_COLUMNS
+
+     Sum columns of the tables along the columns.
+
+******************************************************************************/
+static void *fd_sat_columns(void *arg)
+{
+     fd_ref_sat_work      _build = arg;
+     fd_ref_sat           _sat = _build->sat;
+     int64_t              _bi, _bj, _bj0, _bj1, _idx, _up;
+
+     while ((_bj0 = __atomic_fetch_add(&_build->next, FD_SAT_COLUMNS, __ATOMIC_RELAXED) + 1)
+            <= _sat->p) {
+          _bj1           = FD_MIN(_bj0 + FD_SAT_COLUMNS - 1, _sat->p);
+          for (_bi = 2; _bi <= _sat->n; _bi++) {
+               for (_bj = _bj0; _bj <= _bj1; _bj++) {
+                    _idx           = FD_SAT_IDX(_sat, _bi, _bj);
+                    _up            = _idx - (_sat->p + 1);
+                    fd_dd_add(&_sat->hi[_idx], &_sat->lo[_idx], _sat->hi[_up], _sat->lo[_up]);
+                    _sat->count[_idx]   += _sat->count[_up];
+               }
+          }
+     }
+
+     return NULL;
+}
+
+// }}}
+// fd_sat_run() {{{
+/******************************************************************************
+
+                         FD_SAT_RUN
+
+     Run a step of the computation of the tables with nb_threads threads,
+     the calling thread being one of them.
+
+******************************************************************************/
+static void fd_sat_run(void *(*fct)(void *), fd_ref_sat sat, int nb_threads)
+{
+     fd_sat_work          _build;
+     pthread_t            _threads[FD_SAT_MAX_THREADS];
+     int                  _t;
+
+     _build.sat     = sat;
+     _build.next    = 0;
+
+     for (_t = 1; _t < nb_threads; _t++) {
+          if (pthread_create(&_threads[_t], NULL, fct, &_build) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+     (*fct)(&_build);
+     for (_t = 1; _t < nb_threads; _t++) {
+          pthread_join(_threads[_t], NULL);
+     }
+}
+
+// }}}
+// fd_sat_build() {{{
+/******************************************************************************
+
+                         FD_SAT_BUILD
+
+     Build the tables of the lines of the matrix already available, with
+     nb_threads threads (one thread reading the provider if it is not
+     reentrant). The tables must have been zeroed, or built before.
+
+******************************************************************************/
+void fd_sat_build(fd_ref_sat sat, fd_ref_provider provider, int nb_threads)
+{
+     size_t               _size;
+
+     fd_sat_free(sat);
+     sat->provider  = provider;
+     sat->ready     = fd_provider_ready(provider);
+
+     for (sat->block = 1, sat->shift = 0;
+          FD_DIV_UP(provider->n, sat->block) * FD_DIV_UP(provider->p, sat->block)
+          > FD_SAT_MAX_BLOCKS;
+          sat->block *= 2, sat->shift++) {
+          ;
+     }
+     sat->n         = FD_DIV_UP(provider->n, sat->block);
+     sat->p         = FD_DIV_UP(provider->p, sat->block);
+
+     _size          = (sat->n + 1) * (sat->p + 1);
+     if ((sat->hi     = calloc(_size, sizeof(double))) == NULL
+     ||  (sat->lo     = calloc(_size, sizeof(double))) == NULL
+     ||  (sat->count  = calloc(_size, sizeof(int64_t))) == NULL
+     ||  (sat->elts   = malloc(FD_SAT_CHUNK * FD_ELT_MAX_SIZE)) == NULL
+     ||  (sat->values = malloc(FD_SAT_CHUNK * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     if (nb_threads < 1) {
+          nb_threads     = 1;
+     }
+     if (nb_threads > FD_SAT_MAX_THREADS) {
+          nb_threads     = FD_SAT_MAX_THREADS;
+     }
+
+     fd_sat_run(fd_sat_lines, sat, provider->reentrant ? nb_threads : 1);
+     fd_sat_run(fd_sat_columns, sat, nb_threads);
+}
+
+// }}}
+// fd_sat_stats_get() {{{
+/******************************************************************************
+
+                         FD_SAT_STATS_GET
+
+     Compute the statistics of the elements of lines i1 to i2 and of
+     columns j1 to j2, restricted to the lines summed in the tables.
+
+******************************************************************************/
+void fd_sat_stats_get(fd_ref_sat sat, int64_t i1, int64_t j1, int64_t i2, int64_t j2,
+                      fd_ref_sat_stats stats)
+{
+     int64_t              _tmp, _bi1, _bj1, _bi2, _bj2, _l1, _c1, _l2, _c2, _count = 0;
+     double               _hi = 0.0, _lo = 0.0;
+     int64_t              _a, _b, _c, _d;
+
+     if (i1 > i2) {
+          _tmp           = i1;
+          i1             = i2;
+          i2             = _tmp;
+     }
+     if (j1 > j2) {
+          _tmp           = j1;
+          j1             = j2;
+          j2             = _tmp;
+     }
+     i1             = FD_MAX(i1, 1);
+     j1             = FD_MAX(j1, 1);
+     i2             = FD_MIN(i2, FD_MIN(sat->provider->n, sat->ready));
+     j2             = FD_MIN(j2, sat->provider->p);
+
+     if (i1 <= i2 && j1 <= j2) {
+          /* Blocks inside of the rectangle
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _bi1           = (i1 + sat->block - 2) >> sat->shift;
+          _bj1           = (j1 + sat->block - 2) >> sat->shift;
+          _bi2           = i2 >> sat->shift;
+          _bj2           = j2 >> sat->shift;
+
+          if (_bi1 < _bi2 && _bj1 < _bj2) {
+               _a             = FD_SAT_IDX(sat, _bi1, _bj1);
+               _b             = FD_SAT_IDX(sat, _bi1, _bj2);
+               _c             = FD_SAT_IDX(sat, _bi2, _bj1);
+               _d             = FD_SAT_IDX(sat, _bi2, _bj2);
+
+               fd_dd_add(&_hi, &_lo,  sat->hi[_d],  sat->lo[_d]);
+               fd_dd_add(&_hi, &_lo, -sat->hi[_b], -sat->lo[_b]);
+               fd_dd_add(&_hi, &_lo, -sat->hi[_c], -sat->lo[_c]);
+               fd_dd_add(&_hi, &_lo,  sat->hi[_a],  sat->lo[_a]);
+               _count         = sat->count[_d] - sat->count[_b] - sat->count[_c]
+                              + sat->count[_a];
+
+               /* Borders : above, below, on the left and on the right
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               _l1            = (_bi1 << sat->shift) + 1;
+               _c1            = (_bj1 << sat->shift) + 1;
+               _l2            = _bi2 << sat->shift;
+               _c2            = _bj2 << sat->shift;
+
+               fd_sat_add_elts(sat, sat->elts, sat->values, i1, j1, _l1 - 1, j2,
+                               &_hi, &_lo, &_count);
+               fd_sat_add_elts(sat, sat->elts, sat->values, _l2 + 1, j1, i2, j2,
+                               &_hi, &_lo, &_count);
+               fd_sat_add_elts(sat, sat->elts, sat->values, _l1, j1, _l2, _c1 - 1,
+                               &_hi, &_lo, &_count);
+               fd_sat_add_elts(sat, sat->elts, sat->values, _l1, _c2 + 1, _l2, j2,
+                               &_hi, &_lo, &_count);
+          }
+          else {
+               fd_sat_add_elts(sat, sat->elts, sat->values, i1, j1, i2, j2,
+                               &_hi, &_lo, &_count);
+          }
+     }
+
+     stats->count   = _count;
+     stats->sum     = _hi + _lo;
+     stats->mean    = _count > 0 ? stats->sum / _count : NAN;
+}
+
+// }}}
+// fd_sat_free() {{{
+/******************************************************************************
+
+                         FD_SAT_FREE
+
+     Free the tables.
+
+******************************************************************************/
+void fd_sat_free(fd_ref_sat sat)
+{
+     free(sat->hi);
+     free(sat->lo);
+     free(sat->count);
+     free(sat->elts);
+     free(sat->values);
+
+     sat->hi        = NULL;
+     sat->lo        = NULL;
+     sat->count     = NULL;
+     sat->elts      = NULL;
+     sat->values    = NULL;
+}
+
+// }}}
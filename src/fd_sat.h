@@ -0,0 +1,82 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_sat.h Version 1.1 du 24/08/06 -
+ *
+ *   Summed-area tables of a matrix.
+ */
+
+#ifndef FD_SAT_H
+#define FD_SAT_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_provider.h"
+
+// }}}
+// Macros definitions {{{
+/* Maximum number of blocks of the tables
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SAT_MAX_BLOCKS   (1 << 21)
+
+/* Elements read at once
+   ~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SAT_CHUNK        (4096)
+
+#define   FD_SAT_MAX_THREADS  (256)
+
+// }}}
+// Structures definitions {{{
+/* Element (bi, bj) of the tables holds the sum and the number of the
+ * elements (NaN excepted) of lines 1 to bi * block and of columns 1 to
+ * bj * block, line 0 and column 0 being null. A sum is kept as the
+ * unevaluated sum of two doubles (hi + lo), so that the differences of
+ * sums keep their precision.
+ */
+struct fd_sat {
+     fd_ref_provider      provider; // Provider of the elements
+     int64_t              ready;   // Lines of the matrix summed
+     int64_t              block;   // Size of the blocks
+     int                  shift;   // log2(block)
+     int64_t              n;       // Number of lines of blocks
+     int64_t              p;       // Number of columns of blocks
+     double              *hi;      // Sums, (n + 1) x (p + 1)
+     double              *lo;      // Rounding errors of the sums
+     int64_t             *count;   // Numbers of elements
+     char                *elts;    // Elements of the borders of a rectangle
+     double              *values;
+};
+typedef struct fd_sat               fd_sat;
+typedef struct fd_sat              *fd_ref_sat;
+
+struct fd_sat_stats {
+     int64_t              count;   // Number of elements, NaN excepted
+     double               sum;     // Sum of the elements
+     double               mean;    // Mean of the elements (NaN : no element)
+};
+typedef struct fd_sat_stats         fd_sat_stats;
+typedef struct fd_sat_stats        *fd_ref_sat_stats;
+
+// }}}
+// Functions prototypes {{{
+void      fd_sat_build(fd_ref_sat sat, fd_ref_provider provider, int nb_threads);
+void      fd_sat_stats_get(fd_ref_sat sat, int64_t i1, int64_t j1, int64_t i2, int64_t j2,
+                           fd_ref_sat_stats stats);
+void      fd_sat_free(fd_ref_sat sat);
+
+// }}}
+
+#endif	/* FD_SAT_H */
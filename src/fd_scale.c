@@ -0,0 +1,292 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_scale.c Version 1.3 du 24/08/10 -
+ *
+ *   Color scales : classification of values by sorted thresholds.
+ *
+ *   The color of a value is the number of thresholds lower than or equal
+ *   to it, looked up in the table of the colors : a single value is
+ *   classified by a branchless binary search in the thresholds, padded
+ *   with NaN (which compare as +infinity), and a line of values by the
+ *   vectorized kernel of fd_simd, so that no branch depends on the values.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fd_simd.h"
+#include "fd_scale.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+
+/* Separators of the tokens of a scale
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SCALE_SEPS       ", \t\r\n"
+
+/* Prefix of the color of NaN
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SCALE_NAN        "nan="
+
+// }}}
+
+// fd_scale_letter() {{{
+/******************************************************************************
+
+                         FD_SCALE_LETTER
+
+     Return the number of the color named by a letter of the palette, -1 if
+     it is not a color.
+
+******************************************************************************/
+static int fd_scale_letter(const char *token, int len, const char *palette)
+{
+     char                *_c;
+
+     if (len != 1 || (_c = strchr(palette, *token)) == NULL) {
+          return -1;
+     }
+
+     return _c - palette + 1;
+}
+
+// }}}
+// fd_scale_parse() {{{
+/******************************************************************************
+
+                         FD_SCALE_PARSE
+
+     Read a scale in text, colors being letters of the palette. Text may
+     span several lines, '#' starting a comment. Return 0 if the scale is
+     valid, -1 otherwise.
+
+******************************************************************************/
+int fd_scale_parse(fd_ref_scale scale, const char *text, const char *palette)
+{
+     const char          *_end;
+     char                 _token[64], *_num_end;
+     int                  _len, _nb_colors = 0, _color, _t;
+     double               _v, _last_thr = -INFINITY, _last_pct = -INFINITY;
+
+     memset(scale, 0, sizeof(*scale));
+
+     for (;;) {
+          /* Skip the separators and the comments
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          text          += strspn(text, FD_SCALE_SEPS);
+          if (*text == '#') {
+               text          += strcspn(text, "\n");
+               continue;
+          }
+          if (*text == 0) {
+               break;
+          }
+
+          _len           = strcspn(text, FD_SCALE_SEPS "#");
+          if (_len >= sizeof(_token)) {
+               return -1;
+          }
+          memcpy(_token, text, _len);
+          _token[_len]   = 0;
+          _end           = text + _len;
+
+          if (strncmp(_token, FD_SCALE_NAN, strlen(FD_SCALE_NAN)) == 0) {
+               /* Color of NaN
+                  ~~~~~~~~~~~~ */
+               if ((_color = fd_scale_letter(_token + strlen(FD_SCALE_NAN),
+                                             _len - strlen(FD_SCALE_NAN), palette)) < 0) {
+                    return -1;
+               }
+               scale->colors[FD_SCALE_MAX + 1] = _color;
+          }
+          else if (_nb_colors == scale->nb) {
+               /* Color of a band
+                  ~~~~~~~~~~~~~~~ */
+               if ((_color = fd_scale_letter(_token, _len, palette)) < 0) {
+                    return -1;
+               }
+               scale->colors[_nb_colors++] = _color;
+          }
+          else {
+               /* Threshold or percentile
+                  ~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (scale->nb == FD_SCALE_MAX) {
+                    return -1;
+               }
+               _v             = strtod(_token, &_num_end);
+               if (_num_end == _token || isnan(_v)) {
+                    return -1;
+               }
+               if (*_num_end == '%') {
+                    if (_num_end[1] != 0 || _v < 0 || _v > 100 || _v < _last_pct) {
+                         return -1;
+                    }
+                    scale->pct[scale->nb]    = _last_pct = _v;
+                    scale->thr[scale->nb]    = NAN;
+               }
+               else {
+                    if (*_num_end != 0 || _v < _last_thr) {
+                         return -1;
+                    }
+                    scale->pct[scale->nb]    = NAN;
+                    scale->thr[scale->nb]    = _last_thr = _v;
+               }
+               scale->nb++;
+          }
+          text           = _end;
+     }
+
+     /* A scale starts and ends with a color
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (_nb_colors == 0 || _nb_colors != scale->nb + 1) {
+          return -1;
+     }
+
+     scale->colors[scale->nb + 1] = scale->colors[FD_SCALE_MAX + 1];
+     for (_t = scale->nb; _t <= FD_SCALE_MAX; _t++) {
+          scale->thr[_t] = NAN;
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_scale_load() {{{
+/******************************************************************************
+
+                         FD_SCALE_LOAD
+
+     Read a scale from a file. Return 0 if the scale is valid, -1 otherwise
+     (errno is EINVAL if the file is not a valid scale).
+
+******************************************************************************/
+int fd_scale_load(fd_ref_scale scale, const char *file, const char *palette)
+{
+     char                 _text[FD_SCALE_MAX_FILE + 1];
+     int                  _fd, _len;
+
+     if ((_fd = open(file, O_RDONLY)) < 0) {
+          return -1;
+     }
+     _len           = read(_fd, _text, FD_SCALE_MAX_FILE + 1);
+     close(_fd);
+
+     if (_len < 0) {
+          return -1;
+     }
+     if (_len > FD_SCALE_MAX_FILE) {
+          errno          = EFBIG;
+          return -1;
+     }
+     _text[_len]    = 0;
+
+     if (fd_scale_parse(scale, _text, palette) < 0) {
+          errno          = EINVAL;
+          return -1;
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_scale_color() {{{
+/******************************************************************************
+
+                         FD_SCALE_COLOR
+
+     Return the color of a value.
+
+******************************************************************************/
+short fd_scale_color(fd_ref_scale scale, double value)
+{
+     const double        *_thr = scale->thr;
+     int                  _pos;
+
+     _pos           = (_thr[7] <= value) << 3;
+     _pos          += (_thr[_pos + 3] <= value) << 2;
+     _pos          += (_thr[_pos + 1] <= value) << 1;
+     _pos          += (_thr[_pos] <= value);
+     _pos           = isnan(value) ? scale->nb + 1 : _pos;
+
+     return scale->colors[_pos];
+}
+
+// }}}
+// fd_scale_classify() {{{
+/******************************************************************************
+
+                         FD_SCALE_CLASSIFY
+
+     Set the colors of nb values.
+
+******************************************************************************/
+void fd_scale_classify(fd_ref_scale scale, const double *values, int64_t nb, short *colors)
+{
+     int                  _idx[FD_SCALE_CHUNK], _k, _w;
+     int64_t              _k0;
+
+     for (_k0 = 0; _k0 < nb; _k0 += _w) {
+          _w             = FD_MIN(FD_SCALE_CHUNK, nb - _k0);
+          fd_simd_classify(_idx, values + _k0, _w, scale->thr, scale->nb);
+          for (_k = 0; _k < _w; _k++) {
+               colors[_k0 + _k]    = scale->colors[_idx[_k]];
+          }
+     }
+}
+
+// }}}
+// fd_scale_format() {{{
+/******************************************************************************
+
+                         FD_SCALE_FORMAT
+
+     Write a scale in buf, as it would be read by fd_scale_parse(), its
+     percentiles being resolved. Return the length of the text.
+
+******************************************************************************/
+int fd_scale_format(fd_ref_scale scale, char *buf, int size, const char *palette)
+{
+     int                  _len = 0, _t;
+
+#define   FD_SCALE_PRINT(...)                                              \
+     if (_len < size) {                                                    \
+          _len          += snprintf(buf + _len, size - _len, __VA_ARGS__); \
+     }
+
+     buf[0]         = 0;
+     for (_t = 0; _t <= scale->nb; _t++) {
+          FD_SCALE_PRINT("%c", scale->colors[_t] > 0 ? palette[scale->colors[_t] - 1] : '?');
+          if (_t < scale->nb) {
+               FD_SCALE_PRINT(",%g,", scale->thr[_t]);
+          }
+     }
+     if (scale->colors[scale->nb + 1] > 0) {
+          FD_SCALE_PRINT("," FD_SCALE_NAN "%c", palette[scale->colors[scale->nb + 1] - 1]);
+     }
+
+#undef    FD_SCALE_PRINT
+
+     return FD_MIN(_len, size - 1);
+}
+
+// }}}
@@ -0,0 +1,72 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_scale.h Version 1.3 du 24/08/10 -
+ *
+ *   Color scales : classification of values by sorted thresholds.
+ */
+
+#ifndef FD_SCALE_H
+#define FD_SCALE_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Macros definitions {{{
+/* Maximum number of thresholds of a scale : the table searched by
+   fd_scale_color() has FD_SCALE_MAX + 1 entries, a power of 2
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SCALE_MAX        (15)
+
+/* Values classified at once by fd_scale_classify()
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SCALE_CHUNK      (256)
+
+/* Maximum size of a scale file
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SCALE_MAX_FILE   (4096)
+
+// }}}
+// Structures definitions {{{
+/* A scale is written as colors separated by increasing thresholds, e.g.
+ * "R,0,b,7000,r,8000,y,9000,g" : a value v gets the color that follows the
+ * last threshold t such that t <= v, or the first color if v is lower than
+ * all the thresholds. A threshold followed by '%' is a percentile of the
+ * values : it stays NaN until the caller sets it from pct. Colors are
+ * letters, numbered from 1 by their position in the palette of the caller,
+ * and "nan=<letter>" sets the color of NaN.
+ */
+struct fd_scale {
+     int                  nb;      // Number of thresholds
+     double               thr[FD_SCALE_MAX + 1];   // Thresholds, NaN padded
+     double               pct[FD_SCALE_MAX];       // Percentiles (NaN : none)
+     short                colors[FD_SCALE_MAX + 2]; // Colors, NaN color last
+};
+typedef struct fd_scale             fd_scale;
+typedef struct fd_scale            *fd_ref_scale;
+
+// }}}
+// Functions prototypes {{{
+int       fd_scale_parse(fd_ref_scale scale, const char *text, const char *palette);
+int       fd_scale_load(fd_ref_scale scale, const char *file, const char *palette);
+short     fd_scale_color(fd_ref_scale scale, double value);
+void      fd_scale_classify(fd_ref_scale scale, const double *values, int64_t nb, short *colors);
+int       fd_scale_format(fd_ref_scale scale, char *buf, int size, const char *palette);
+
+// }}}
+
+#endif	/* FD_SCALE_H */
@@ -0,0 +1,457 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_search.c Version 1.2 du 24/08/10 -
+ *
+ *   Parallel search of values in the matrix of a provider.
+ *
+ *   The elements are numbered in reading order. The threads take blocks of
+ *   FD_SEARCH_LINES lines in turn, in that order, and record the smallest
+ *   number of a matching element : a thread stops as soon as its block
+ *   begins after it, so the scan ends once all the blocks before the
+ *   nearest match have been scanned. The extrema are searched by a full
+ *   scan, each thread keeping its own.
+ *
+ *   A provider whose fill function is not reentrant is scanned by one
+ *   thread only.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "fd_elt.h"
+#include "fd_search.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(x, y)        ((x) < (y) ? (x) : (y))
+
+/* Maximum length of a number of a search
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SEARCH_NUM_SIZE  (64)
+
+// }}}
+// Structures definitions {{{
+struct fd_scan {
+     fd_ref_provider      provider; // Provider of the elements
+     fd_ref_search        search;  // Kind of search
+     int64_t              first;   // Number of the first element to scan
+     int64_t              last;    // Number of the last element to scan
+     int64_t              next;    // Next block to scan
+     int64_t              best;    // Number of the nearest match
+};
+typedef struct fd_scan              fd_scan;
+typedef struct fd_scan             *fd_ref_scan;
+
+struct fd_scan_thread {
+     fd_ref_scan          scan;    // Common parameters
+     pthread_t            thread;  // Scanning thread
+     int                  found;   // An extremum was found
+     int64_t              pos;     // Number of the extremum
+     double               value;   // Value of the extremum
+};
+typedef struct fd_scan_thread       fd_scan_thread;
+typedef struct fd_scan_thread      *fd_ref_scan_thread;
+
+// }}}
+
+// fd_search_number() {{{
+/******************************************************************************
+
+                         FD_SEARCH_NUMBER
+
+     Read the number written from text to stop (excluded), spaces allowed
+     around it : the number is copied first, so that strtod() cannot read
+     the characters following it (the '.' of "..").
+     Return -1 if it is not a number.
+
+******************************************************************************/
+static int fd_search_number(const char *text, const char *stop, double *value)
+{
+     char            _buf[FD_SEARCH_NUM_SIZE], *_end;
+
+     if ((size_t) (stop - text) >= sizeof(_buf)) {
+          return -1;
+     }
+     memcpy(_buf, text, stop - text);
+     _buf[stop - text]   = 0;
+
+     *value         = strtod(_buf, &_end);
+     if (_end == _buf) {
+          return -1;
+     }
+
+     while (*_end == ' ') {
+          _end++;
+     }
+
+     return *_end == 0 ? 0 : -1;
+}
+
+// }}}
+// fd_search_parse() {{{
+/******************************************************************************
+
+                         FD_SEARCH_PARSE
+
+     Read the description of a search :
+          x, =x     : elements equal to x
+          >x, <x    : elements greater or less than x
+          x..y      : elements between x and y
+          max, min  : extrema of the matrix
+     Return -1 if the description is invalid.
+
+******************************************************************************/
+int fd_search_parse(fd_ref_search search, const char *text)
+{
+     const char     *_end, *_dots;
+
+     while (*text == ' ') {
+          text++;
+     }
+
+     memset(search, 0, sizeof(*search));
+
+     if (strcmp(text, "max") == 0) {
+          search->kind   = FD_SEARCH_MAX;
+          return 0;
+     }
+     if (strcmp(text, "min") == 0) {
+          search->kind   = FD_SEARCH_MIN;
+          return 0;
+     }
+
+     switch (*text) {
+
+     case '>':
+          search->kind   = FD_SEARCH_GT;
+          text++;
+          break;
+
+     case '<':
+          search->kind   = FD_SEARCH_LT;
+          text++;
+          break;
+
+     case '=':
+          text++;
+          /* FALLTHROUGH */
+     default:
+          search->kind   = FD_SEARCH_EQ;
+          break;
+     }
+
+     _end           = text + strlen(text);
+     if (search->kind == FD_SEARCH_EQ && (_dots = strstr(text, "..")) != NULL) {
+          /* Each bound must end exactly at its delimiter
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          search->kind   = FD_SEARCH_RANGE;
+          if (fd_search_number(text, _dots, &search->a) < 0
+          ||  fd_search_number(_dots + 2, _end, &search->b) < 0
+          ||  search->b < search->a) {
+               return -1;
+          }
+          return 0;
+     }
+
+     return fd_search_number(text, _end, &search->a);
+}
+
+// }}}
+// fd_search_match() {{{
+/******************************************************************************
+
+                         FD_SEARCH_MATCH
+
+     Return the index of the first of the nb values matching the search, or
+     -1.
+
+******************************************************************************/
+static int64_t fd_search_match(fd_ref_search search, const double *values, int64_t nb)
+{
+     int64_t         _k;
+     double          _a, _b;
+
+     _a             = search->a;
+     _b             = search->b;
+
+#define   FD_SEARCH_FIRST(cond)                                            \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          if (cond) {                                                      \
+               return _k;                                                  \
+          }                                                                \
+     }                                                                     \
+     break;
+
+     switch (search->kind) {
+
+     case FD_SEARCH_EQ:
+          FD_SEARCH_FIRST(values[_k] == _a)
+
+     case FD_SEARCH_GT:
+          FD_SEARCH_FIRST(values[_k] > _a)
+
+     case FD_SEARCH_LT:
+          FD_SEARCH_FIRST(values[_k] < _a)
+
+     case FD_SEARCH_RANGE:
+          FD_SEARCH_FIRST(_a <= values[_k] && values[_k] <= _b)
+
+     default:
+          break;
+     }
+
+#undef    FD_SEARCH_FIRST
+
+     return -1;
+}
+
+// }}}
+// fd_search_best() {{{
+/******************************************************************************
+
+                         FD_SEARCH_BEST
+
+     Record the number of a match, if it is nearer than the best one.
+
+******************************************************************************/
+static void fd_search_best(fd_ref_scan scan, int64_t pos)
+{
+     int64_t         _best;
+
+     _best          = __atomic_load_n(&scan->best, __ATOMIC_RELAXED);
+     while (pos < _best
+     &&    !__atomic_compare_exchange_n(&scan->best, &_best, pos, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+          ;
+     }
+}
+
+// }}}
+// fd_search_thread() {{{
+/******************************************************************************
+
+                         FD_SEARCH_THREAD
+
+     Scan blocks of lines until the end of the range, or until the blocks
+     begin after the nearest match.
+
+******************************************************************************/
+static void *fd_search_thread(void *arg)
+{
+     fd_ref_scan_thread   _thr = arg;
+     fd_ref_scan          _scan = _thr->scan;
+     fd_ref_provider      _provider = _scan->provider;
+     fd_ref_search        _search = _scan->search;
+     char                *_elts;
+     double              *_values, _v;
+     int64_t              _p, _l, _l0, _l1, _first_line, _last_line, _c, _c1, _w, _k,
+                          _block;
+     int                  _extremum, _max;
+
+     _p             = _provider->p;
+     _first_line    = _scan->first / _p;
+     _last_line     = _scan->last  / _p;
+     _extremum      = _search->kind == FD_SEARCH_MAX || _search->kind == FD_SEARCH_MIN;
+     _max           = _search->kind == FD_SEARCH_MAX;
+
+     if ((_elts   = malloc(FD_SEARCH_CHUNK * FD_ELT_MAX_SIZE)) == NULL
+     ||  (_values = malloc(FD_SEARCH_CHUNK * sizeof(double))) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     for (;;) {
+          _block         = __atomic_fetch_add(&_scan->next, 1, __ATOMIC_RELAXED);
+          _l0            = _first_line + (_block * FD_SEARCH_LINES);
+          if (_l0 > _last_line) {
+               break;
+          }
+          _l1            = FD_MIN(_l0 + FD_SEARCH_LINES - 1, _last_line);
+
+          for (_l = _l0; _l <= _l1; _l++) {
+               /* Nothing nearer can be found after the best match
+                  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+               if (_l * _p > __atomic_load_n(&_scan->best, __ATOMIC_RELAXED)) {
+                    goto end;
+               }
+
+               _c             = (_l == _first_line) ? _scan->first % _p : 0;
+               _c1            = (_l == _last_line)  ? _scan->last  % _p : _p - 1;
+               for ( ; _c <= _c1; _c += _w) {
+                    _w             = FD_MIN(FD_SEARCH_CHUNK, _c1 - _c + 1);
+                    fd_provider_fill(_provider, _l + 1, _c + 1, 1, _w, _elts);
+                    fd_elt_to_double(_provider->elt_type, _elts, _w, _values);
+
+                    if (!_extremum) {
+                         if ((_k = fd_search_match(_search, _values, _w)) >= 0) {
+                              fd_search_best(_scan, (_l * _p) + _c + _k);
+                              goto end;
+                         }
+                         continue;
+                    }
+
+                    for (_k = 0; _k < _w; _k++) {
+                         _v             = _values[_k];
+                         if (_v != _v) {
+                              continue;
+                         }
+                         if (!_thr->found || (_max ? _v > _thr->value : _v < _thr->value)) {
+                              _thr->found    = 1;
+                              _thr->value    = _v;
+                              _thr->pos      = (_l * _p) + _c + _k;
+                         }
+                    }
+               }
+          }
+     }
+
+end:
+     free(_elts);
+     free(_values);
+
+     return NULL;
+}
+
+// }}}
+// fd_search_scan() {{{
+/******************************************************************************
+
+                         FD_SEARCH_SCAN
+
+     Scan the elements numbered first to last with nb_threads threads.
+     Return 1 if an element was found, 0 otherwise.
+
+******************************************************************************/
+static int fd_search_scan(fd_ref_provider provider, fd_ref_search search, int64_t first,
+                          int64_t last, int nb_threads)
+{
+     fd_scan              _scan;
+     fd_scan_thread       _thr[FD_SEARCH_MAX_THREADS];
+     fd_ref_scan_thread   _best;
+     int                  _t;
+     char                 _elt[FD_ELT_MAX_SIZE];
+
+     _scan.provider = provider;
+     _scan.search   = search;
+     _scan.first    = first;
+     _scan.last     = last;
+     _scan.next     = 0;
+     _scan.best     = INT64_MAX;
+
+     for (_t = 0; _t < nb_threads; _t++) {
+          _thr[_t].scan       = &_scan;
+          _thr[_t].found      = 0;
+          if (_t > 0 && pthread_create(&_thr[_t].thread, NULL, fd_search_thread,
+                                       &_thr[_t]) != 0) {
+               fprintf(stderr, "Cannot create thread !\n");
+               exit(1);
+          }
+     }
+
+     /* The calling thread scans too
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     fd_search_thread(&_thr[0]);
+     for (_t = 1; _t < nb_threads; _t++) {
+          pthread_join(_thr[_t].thread, NULL);
+     }
+
+     if (search->kind == FD_SEARCH_MAX || search->kind == FD_SEARCH_MIN) {
+          /* Extremum of the threads, the first one in reading order
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          _best          = NULL;
+          for (_t = 0; _t < nb_threads; _t++) {
+               if (!_thr[_t].found) {
+                    continue;
+               }
+               if (_best == NULL
+               ||  (search->kind == FD_SEARCH_MAX ? _thr[_t].value > _best->value
+                                                  : _thr[_t].value < _best->value)
+               ||  (_thr[_t].value == _best->value && _thr[_t].pos < _best->pos)) {
+                    _best          = &_thr[_t];
+               }
+          }
+          if (_best == NULL) {
+               return 0;
+          }
+          _scan.best     = _best->pos;
+     }
+     else if (_scan.best == INT64_MAX) {
+          return 0;
+     }
+
+     search->found  = 1;
+     search->i      = (_scan.best / provider->p) + 1;
+     search->j      = (_scan.best % provider->p) + 1;
+     fd_provider_fill(provider, search->i, search->j, 1, 1, _elt);
+     fd_elt_to_double(provider->elt_type, _elt, 1, &search->value);
+
+     return 1;
+}
+
+// }}}
+// fd_search_run() {{{
+/******************************************************************************
+
+                         FD_SEARCH_RUN
+
+     Search the first element matching the search after element (i, j) in
+     reading order, going on from the beginning of the matrix after its
+     end, or search an extremum of the matrix. Return 1 and set search->i,
+     search->j and search->value if an element was found, 0 otherwise.
+
+******************************************************************************/
+int fd_search_run(fd_ref_provider provider, fd_ref_search search, int64_t i, int64_t j,
+                  int nb_threads)
+{
+     int64_t         _nb, _pos;
+
+     /* Only the lines already available are searched
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     search->found  = 0;
+     _nb            = fd_provider_ready(provider) * provider->p;
+     if (_nb == 0) {
+          return 0;
+     }
+
+     if (!provider->reentrant || nb_threads < 1) {
+          nb_threads     = 1;
+     }
+     if (nb_threads > FD_SEARCH_MAX_THREADS) {
+          nb_threads     = FD_SEARCH_MAX_THREADS;
+     }
+
+     if (search->kind == FD_SEARCH_MAX || search->kind == FD_SEARCH_MIN) {
+          return fd_search_scan(provider, search, 0, _nb - 1, nb_threads);
+     }
+
+     /* After (i, j), then from the beginning
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _pos           = ((i - 1) * provider->p) + (j - 1);
+     if (_pos < 0 || _pos >= _nb) {
+          _pos           = -1;
+     }
+
+     if (_pos + 1 < _nb && fd_search_scan(provider, search, _pos + 1, _nb - 1, nb_threads)) {
+          return 1;
+     }
+
+     return _pos >= 0 && fd_search_scan(provider, search, 0, _pos, nb_threads);
+}
+
+// }}}
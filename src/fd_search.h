@@ -0,0 +1,69 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_search.h Version 1.1 du 24/08/04 -
+ *
+ *   Parallel search of values in the matrix of a provider.
+ */
+
+#ifndef FD_SEARCH_H
+#define FD_SEARCH_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_provider.h"
+
+// }}}
+// Macros definitions {{{
+/* Kinds of search
+   ~~~~~~~~~~~~~~~ */
+#define   FD_SEARCH_EQ        (1)      // value == a
+#define   FD_SEARCH_GT        (2)      // value > a
+#define   FD_SEARCH_LT        (3)      // value < a
+#define   FD_SEARCH_RANGE     (4)      // a <= value <= b
+#define   FD_SEARCH_MAX       (5)      // Maximum of the matrix
+#define   FD_SEARCH_MIN       (6)      // Minimum of the matrix
+
+/* Lines of a block scanned by a thread, and elements read at once
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SEARCH_LINES     (64)
+#define   FD_SEARCH_CHUNK     (4096)
+
+#define   FD_SEARCH_MAX_THREADS    (256)
+
+// }}}
+// Structures definitions {{{
+struct fd_search {
+     int                  kind;    // Kind of search
+     double               a;       // Value searched, or lower bound
+     double               b;       // Upper bound
+     int                  found;   // An element was found
+     int64_t              i;       // Line of the element found
+     int64_t              j;       // Column of the element found
+     double               value;   // Value of the element found
+};
+typedef struct fd_search            fd_search;
+typedef struct fd_search           *fd_ref_search;
+
+// }}}
+// Functions prototypes {{{
+int       fd_search_parse(fd_ref_search search, const char *text);
+int       fd_search_run(fd_ref_provider provider, fd_ref_search search, int64_t i,
+                        int64_t j, int nb_threads);
+
+// }}}
+
+#endif	/* FD_SEARCH_H */
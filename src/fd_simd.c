@@ -0,0 +1,526 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_simd.c Version 1.2 du 24/08/07 -
+ *
+ *   Vectorized kernels of the built-in generators and of the color scales.
+ *
+ *   Each kernel computes a span of a line of the matrix, and exists for
+ *   SSE2, AVX2 and AVX-512 ; the fastest version supported by the processor
+ *   is selected at startup. The scalar versions perform the same operations
+ *   in the same order : as all the values are integers below 2^53, every
+ *   version gives bit-identical results.
+ *
+ *   Kernels :
+ *        band  : (n - |i - j|) * coeff      (banded Toeplitz matrix)
+ *        index : (i - 1) * p + j            (linear index of the element)
+ *        classify : number of thresholds <= value (nb_thr + 1 for NaN)
+ */
+
+// Includes {{{
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define   FD_SIMD_X86
+#endif
+#include "fd_simd.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_SCALAR_ATTR      __attribute__((optimize("no-tree-vectorize")))
+#define   FD_AVX2_ATTR        __attribute__((target("avx2")))
+#define   FD_AVX512_ATTR      __attribute__((target("avx512f")))
+
+// }}}
+// Structures definitions {{{
+struct fd_kernels {
+     void               (*band)(double *, int64_t, int64_t, int64_t, int64_t, int64_t);
+     void               (*index)(double *, int64_t, int64_t, int64_t, int64_t);
+     void               (*classify)(int *, const double *, int64_t, const double *, int);
+};
+typedef struct fd_kernels           fd_kernels;
+typedef struct fd_kernels          *fd_ref_kernels;
+
+// }}}
+// Global variables {{{
+static char                        *fd_simd_names[] = {
+     "scalar", "sse2", "avx2", "avx512"
+};
+
+// }}}
+
+// fd_band_scalar() {{{
+/******************************************************************************
+
+                         FD_BAND_SCALAR
+
+******************************************************************************/
+static FD_SCALAR_ATTR void fd_band_scalar(double *dst, int64_t dx, int64_t i, int64_t j0,
+                                          int64_t n, int64_t coeff)
+{
+     int64_t         _k;
+
+     for (_k = 0; _k < dx; _k++) {
+          dst[_k]        = ((double) n - fabs((double) i - (double) (j0 + _k))) * (double) coeff;
+     }
+}
+
+// }}}
+// fd_index_scalar() {{{
+/******************************************************************************
+
+                         FD_INDEX_SCALAR
+
+******************************************************************************/
+static FD_SCALAR_ATTR void fd_index_scalar(double *dst, int64_t dx, int64_t i, int64_t j0,
+                                           int64_t p)
+{
+     int64_t         _k;
+
+     for (_k = 0; _k < dx; _k++) {
+          dst[_k]        = (double) ((i - 1) * p) + (double) (j0 + _k);
+     }
+}
+
+// }}}
+// fd_classify_scalar() {{{
+/******************************************************************************
+
+                         FD_CLASSIFY_SCALAR
+
+******************************************************************************/
+static FD_SCALAR_ATTR void fd_classify_scalar(int *dst, const double *values, int64_t nb,
+                                              const double *thr, int nb_thr)
+{
+     int64_t         _k;
+     int             _t, _idx;
+
+     for (_k = 0; _k < nb; _k++) {
+          _idx           = isnan(values[_k]) ? nb_thr + 1 : 0;
+          for (_t = 0; _t < nb_thr; _t++) {
+               _idx          += values[_k] >= thr[_t];
+          }
+          dst[_k]        = _idx;
+     }
+}
+
+// }}}
+#if defined(FD_SIMD_X86)
+// fd_band_sse2() {{{
+/******************************************************************************
+
+                         FD_BAND_SSE2
+
+******************************************************************************/
+static void fd_band_sse2(double *dst, int64_t dx, int64_t i, int64_t j0, int64_t n,
+                         int64_t coeff)
+{
+     __m128d         _i, _j, _n, _c, _step, _sign;
+     int64_t         _k;
+
+     _i             = _mm_set1_pd((double) i);
+     _n             = _mm_set1_pd((double) n);
+     _c             = _mm_set1_pd((double) coeff);
+     _j             = _mm_setr_pd((double) j0, (double) (j0 + 1));
+     _step          = _mm_set1_pd(2.0);
+     _sign          = _mm_set1_pd(-0.0);
+
+     for (_k = 0; _k + 2 <= dx; _k += 2) {
+          _mm_storeu_pd(dst + _k,
+                        _mm_mul_pd(_mm_sub_pd(_n, _mm_andnot_pd(_sign, _mm_sub_pd(_i, _j))), _c));
+          _j             = _mm_add_pd(_j, _step);
+     }
+
+     fd_band_scalar(dst + _k, dx - _k, i, j0 + _k, n, coeff);
+}
+
+// }}}
+// fd_index_sse2() {{{
+/******************************************************************************
+
+                         FD_INDEX_SSE2
+
+******************************************************************************/
+static void fd_index_sse2(double *dst, int64_t dx, int64_t i, int64_t j0, int64_t p)
+{
+     __m128d         _j, _base, _step;
+     int64_t         _k;
+
+     _base          = _mm_set1_pd((double) ((i - 1) * p));
+     _j             = _mm_setr_pd((double) j0, (double) (j0 + 1));
+     _step          = _mm_set1_pd(2.0);
+
+     for (_k = 0; _k + 2 <= dx; _k += 2) {
+          _mm_storeu_pd(dst + _k, _mm_add_pd(_base, _j));
+          _j             = _mm_add_pd(_j, _step);
+     }
+
+     fd_index_scalar(dst + _k, dx - _k, i, j0 + _k, p);
+}
+
+// }}}
+// fd_classify_sse2() {{{
+/******************************************************************************
+
+                         FD_CLASSIFY_SSE2
+
+     The comparison masks of the thresholds are accumulated as doubles :
+     an ordered comparison with a NaN being false, the count of a NaN is
+     null, and nb_thr + 1 is added to it.
+
+******************************************************************************/
+static void fd_classify_sse2(int *dst, const double *values, int64_t nb,
+                             const double *thr, int nb_thr)
+{
+     __m128d         _v, _idx, _one, _nan;
+     int64_t         _k;
+     int             _t;
+
+     _one           = _mm_set1_pd(1.0);
+     _nan           = _mm_set1_pd((double) (nb_thr + 1));
+
+     for (_k = 0; _k + 2 <= nb; _k += 2) {
+          _v             = _mm_loadu_pd(values + _k);
+          _idx           = _mm_and_pd(_mm_cmpunord_pd(_v, _v), _nan);
+          for (_t = 0; _t < nb_thr; _t++) {
+               _idx           = _mm_add_pd(_idx, _mm_and_pd(_mm_cmpge_pd(_v, _mm_set1_pd(thr[_t])),
+                                                            _one));
+          }
+          _mm_storel_epi64((__m128i *) (dst + _k), _mm_cvtpd_epi32(_idx));
+     }
+
+     fd_classify_scalar(dst + _k, values + _k, nb - _k, thr, nb_thr);
+}
+
+// }}}
+// fd_band_avx2() {{{
+/******************************************************************************
+
+                         FD_BAND_AVX2
+
+******************************************************************************/
+static FD_AVX2_ATTR void fd_band_avx2(double *dst, int64_t dx, int64_t i, int64_t j0,
+                                      int64_t n, int64_t coeff)
+{
+     __m256d         _i, _j, _n, _c, _step, _sign;
+     int64_t         _k;
+
+     _i             = _mm256_set1_pd((double) i);
+     _n             = _mm256_set1_pd((double) n);
+     _c             = _mm256_set1_pd((double) coeff);
+     _j             = _mm256_setr_pd((double) j0, (double) (j0 + 1), (double) (j0 + 2),
+                                     (double) (j0 + 3));
+     _step          = _mm256_set1_pd(4.0);
+     _sign          = _mm256_set1_pd(-0.0);
+
+     for (_k = 0; _k + 4 <= dx; _k += 4) {
+          _mm256_storeu_pd(dst + _k,
+                           _mm256_mul_pd(_mm256_sub_pd(_n, _mm256_andnot_pd(_sign,
+                                                       _mm256_sub_pd(_i, _j))), _c));
+          _j             = _mm256_add_pd(_j, _step);
+     }
+
+     fd_band_scalar(dst + _k, dx - _k, i, j0 + _k, n, coeff);
+}
+
+// }}}
+// fd_index_avx2() {{{
+/******************************************************************************
+
+                         FD_INDEX_AVX2
+
+******************************************************************************/
+static FD_AVX2_ATTR void fd_index_avx2(double *dst, int64_t dx, int64_t i, int64_t j0,
+                                       int64_t p)
+{
+     __m256d         _j, _base, _step;
+     int64_t         _k;
+
+     _base          = _mm256_set1_pd((double) ((i - 1) * p));
+     _j             = _mm256_setr_pd((double) j0, (double) (j0 + 1), (double) (j0 + 2),
+                                     (double) (j0 + 3));
+     _step          = _mm256_set1_pd(4.0);
+
+     for (_k = 0; _k + 4 <= dx; _k += 4) {
+          _mm256_storeu_pd(dst + _k, _mm256_add_pd(_base, _j));
+          _j             = _mm256_add_pd(_j, _step);
+     }
+
+     fd_index_scalar(dst + _k, dx - _k, i, j0 + _k, p);
+}
+
+// }}}
+// fd_classify_avx2() {{{
+/******************************************************************************
+
+                         FD_CLASSIFY_AVX2
+
+******************************************************************************/
+static FD_AVX2_ATTR void fd_classify_avx2(int *dst, const double *values, int64_t nb,
+                                          const double *thr, int nb_thr)
+{
+     __m256d         _v, _idx, _one, _nan;
+     int64_t         _k;
+     int             _t;
+
+     _one           = _mm256_set1_pd(1.0);
+     _nan           = _mm256_set1_pd((double) (nb_thr + 1));
+
+     for (_k = 0; _k + 4 <= nb; _k += 4) {
+          _v             = _mm256_loadu_pd(values + _k);
+          _idx           = _mm256_and_pd(_mm256_cmp_pd(_v, _v, _CMP_UNORD_Q), _nan);
+          for (_t = 0; _t < nb_thr; _t++) {
+               _idx           = _mm256_add_pd(_idx,
+                                              _mm256_and_pd(_mm256_cmp_pd(_v,
+                                                            _mm256_set1_pd(thr[_t]), _CMP_GE_OQ),
+                                                            _one));
+          }
+          _mm_storeu_si128((__m128i *) (dst + _k), _mm256_cvtpd_epi32(_idx));
+     }
+
+     fd_classify_scalar(dst + _k, values + _k, nb - _k, thr, nb_thr);
+}
+
+// }}}
+// fd_band_avx512() {{{
+/******************************************************************************
+
+                         FD_BAND_AVX512
+
+******************************************************************************/
+static FD_AVX512_ATTR void fd_band_avx512(double *dst, int64_t dx, int64_t i, int64_t j0,
+                                          int64_t n, int64_t coeff)
+{
+     __m512d         _i, _j, _n, _c, _step;
+     int64_t         _k;
+
+     _i             = _mm512_set1_pd((double) i);
+     _n             = _mm512_set1_pd((double) n);
+     _c             = _mm512_set1_pd((double) coeff);
+     _j             = _mm512_add_pd(_mm512_set1_pd((double) j0),
+                                    _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0));
+     _step          = _mm512_set1_pd(8.0);
+
+     for (_k = 0; _k + 8 <= dx; _k += 8) {
+          _mm512_storeu_pd(dst + _k,
+                           _mm512_mul_pd(_mm512_sub_pd(_n, _mm512_abs_pd(_mm512_sub_pd(_i, _j))),
+                                         _c));
+          _j             = _mm512_add_pd(_j, _step);
+     }
+
+     fd_band_scalar(dst + _k, dx - _k, i, j0 + _k, n, coeff);
+}
+
+// }}}
+// fd_index_avx512() {{{
+/******************************************************************************
+
+                         FD_INDEX_AVX512
+
+******************************************************************************/
+static FD_AVX512_ATTR void fd_index_avx512(double *dst, int64_t dx, int64_t i, int64_t j0,
+                                           int64_t p)
+{
+     __m512d         _j, _base, _step;
+     int64_t         _k;
+
+     _base          = _mm512_set1_pd((double) ((i - 1) * p));
+     _j             = _mm512_add_pd(_mm512_set1_pd((double) j0),
+                                    _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0));
+     _step          = _mm512_set1_pd(8.0);
+
+     for (_k = 0; _k + 8 <= dx; _k += 8) {
+          _mm512_storeu_pd(dst + _k, _mm512_add_pd(_base, _j));
+          _j             = _mm512_add_pd(_j, _step);
+     }
+
+     fd_index_scalar(dst + _k, dx - _k, i, j0 + _k, p);
+}
+
+// }}}
+// fd_classify_avx512() {{{
+/******************************************************************************
+
+                         FD_CLASSIFY_AVX512
+
+******************************************************************************/
+static FD_AVX512_ATTR void fd_classify_avx512(int *dst, const double *values, int64_t nb,
+                                              const double *thr, int nb_thr)
+{
+     __m512d         _v;
+     __m512i         _idx, _one;
+     int64_t         _k;
+     int             _t;
+
+     _one           = _mm512_set1_epi64(1);
+
+     for (_k = 0; _k + 8 <= nb; _k += 8) {
+          _v             = _mm512_loadu_pd(values + _k);
+          _idx           = _mm512_maskz_set1_epi64(_mm512_cmp_pd_mask(_v, _v, _CMP_UNORD_Q),
+                                                   nb_thr + 1);
+          for (_t = 0; _t < nb_thr; _t++) {
+               _idx           = _mm512_mask_add_epi64(_idx,
+                                                      _mm512_cmp_pd_mask(_v, _mm512_set1_pd(thr[_t]),
+                                                                         _CMP_GE_OQ),
+                                                      _idx, _one);
+          }
+          _mm256_storeu_si256((__m256i *) (dst + _k), _mm512_cvtepi64_epi32(_idx));
+     }
+
+     fd_classify_scalar(dst + _k, values + _k, nb - _k, thr, nb_thr);
+}
+
+// }}}
+#endif	/* FD_SIMD_X86 */
+
+// Global variables {{{
+static fd_kernels                   fd_kernels_tab[] = {
+     [FD_SIMD_SCALAR]    = { fd_band_scalar,    fd_index_scalar,    fd_classify_scalar },
+#if defined(FD_SIMD_X86)
+     [FD_SIMD_SSE2]      = { fd_band_sse2,      fd_index_sse2,      fd_classify_sse2 },
+     [FD_SIMD_AVX2]      = { fd_band_avx2,      fd_index_avx2,      fd_classify_avx2 },
+     [FD_SIMD_AVX512]    = { fd_band_avx512,    fd_index_avx512,    fd_classify_avx512 },
+#endif
+};
+
+static int                          fd_simd_selected = -1;
+static fd_ref_kernels               fd_kern = &fd_kernels_tab[FD_SIMD_SCALAR];
+
+// }}}
+
+// fd_simd_init() {{{
+/******************************************************************************
+
+                         FD_SIMD_INIT
+
+     Select the fastest instruction set supported by the processor, not
+     above the one named by the environment variable FD_SIMD_ENV.
+
+******************************************************************************/
+static __attribute__((constructor)) void fd_simd_init(void)
+{
+     char           *_env;
+     int             _level, _max;
+
+     _level         = FD_SIMD_SCALAR;
+#if defined(FD_SIMD_X86)
+     __builtin_cpu_init();
+     if (__builtin_cpu_supports("avx512f")) {
+          _level         = FD_SIMD_AVX512;
+     }
+     else if (__builtin_cpu_supports("avx2")) {
+          _level         = FD_SIMD_AVX2;
+     }
+     else if (__builtin_cpu_supports("sse2")) {
+          _level         = FD_SIMD_SSE2;
+     }
+#endif
+
+     if ((_env = getenv(FD_SIMD_ENV)) != NULL) {
+          for (_max = FD_SIMD_SCALAR; _max <= FD_SIMD_AVX512; _max++) {
+               if (strcmp(_env, fd_simd_names[_max]) == 0 && _max < _level) {
+                    _level         = _max;
+               }
+          }
+     }
+
+     fd_simd_selected    = _level;
+     fd_kern             = &fd_kernels_tab[_level];
+}
+
+// }}}
+// fd_simd_level() {{{
+/******************************************************************************
+
+                         FD_SIMD_LEVEL
+
+     Return the selected instruction set.
+
+******************************************************************************/
+int fd_simd_level(void)
+{
+     if (fd_simd_selected < 0) {
+          fd_simd_init();
+     }
+
+     return fd_simd_selected;
+}
+
+// }}}
+// fd_simd_name() {{{
+/******************************************************************************
+
+                         FD_SIMD_NAME
+
+******************************************************************************/
+const char *fd_simd_name(int level)
+{
+     if (level < FD_SIMD_SCALAR || level > FD_SIMD_AVX512) {
+          return "unknown";
+     }
+
+     return fd_simd_names[level];
+}
+
+// }}}
+// fd_simd_band() {{{
+/******************************************************************************
+
+                         FD_SIMD_BAND
+
+     Compute the dx elements (n - |i - j|) * coeff of line i, starting at
+     column j0.
+
+******************************************************************************/
+void fd_simd_band(double *dst, int64_t dx, int64_t i, int64_t j0, int64_t n, int64_t coeff)
+{
+     fd_kern->band(dst, dx, i, j0, n, coeff);
+}
+
+// }}}
+// fd_simd_index() {{{
+/******************************************************************************
+
+                         FD_SIMD_INDEX
+
+     Compute the dx elements (i - 1) * p + j of line i, starting at column
+     j0.
+
+******************************************************************************/
+void fd_simd_index(double *dst, int64_t dx, int64_t i, int64_t j0, int64_t p)
+{
+     fd_kern->index(dst, dx, i, j0, p);
+}
+
+// }}}
+// fd_simd_classify() {{{
+/******************************************************************************
+
+                         FD_SIMD_CLASSIFY
+
+     Set dst[k] to the number of the nb_thr sorted thresholds thr that are
+     lower than or equal to values[k], or to nb_thr + 1 if values[k] is NaN.
+
+******************************************************************************/
+void fd_simd_classify(int *dst, const double *values, int64_t nb, const double *thr,
+                      int nb_thr)
+{
+     fd_kern->classify(dst, values, nb, thr, nb_thr);
+}
+
+// }}}
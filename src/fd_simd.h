@@ -0,0 +1,53 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_simd.h Version 1.2 du 24/08/07 -
+ *
+ *   Vectorized kernels of the built-in generators and of the color scales.
+ */
+
+#ifndef FD_SIMD_H
+#define FD_SIMD_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Macros definitions {{{
+/* Instruction sets, from the slowest to the fastest
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SIMD_SCALAR      (0)
+#define   FD_SIMD_SSE2        (1)
+#define   FD_SIMD_AVX2        (2)
+#define   FD_SIMD_AVX512      (3)
+
+/* Environment variable limiting the instruction set (scalar, sse2, ...)
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_SIMD_ENV         "FD_SIMD"
+
+// }}}
+// Functions prototypes {{{
+int       fd_simd_level(void);
+const char *fd_simd_name(int level);
+void      fd_simd_band(double *dst, int64_t dx, int64_t i, int64_t j0, int64_t n,
+                       int64_t coeff);
+void      fd_simd_index(double *dst, int64_t dx, int64_t i, int64_t j0, int64_t p);
+void      fd_simd_classify(int *dst, const double *values, int64_t nb, const double *thr,
+                           int nb_thr);
+
+// }}}
+
+#endif	/* FD_SIMD_H */
@@ -0,0 +1,451 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_sparse.c Version 1.2 du 24/08/10 - 
+ *
+ *   Sparse matrices in compressed sparse row (CSR) format.
+ *
+ *   Matrices are read from Matrix Market coordinate files. The nonzeros of
+ *   a part of a line are found by a binary search on the sorted column
+ *   indexes of the line : filling a viewport of dy lines costs
+ *   O(dy x log(nnz)) plus the number of nonzeros displayed, whatever the
+ *   width of the matrix.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fd_csv.h"
+#include "fd_sparse.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MM_BANNER        "%%MatrixMarket"
+
+/* Symmetry of a Matrix Market file
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_MM_GENERAL       (0)
+#define   FD_MM_SYMMETRIC     (1)
+#define   FD_MM_SKEW          (2)
+
+// }}}
+// Structures definitions {{{
+struct fd_entry {
+     int64_t              col;     // Column index
+     double               val;     // Value
+};
+typedef struct fd_entry             fd_entry;
+typedef struct fd_entry            *fd_ref_entry;
+
+// }}}
+
+// fd_sparse_cmp_entries() {{{
+/******************************************************************************
+
+                         FD_SPARSE_CMP_ENTRIES
+
+     Compare the column indexes of two entries (for qsort()).
+
+******************************************************************************/
+static int fd_sparse_cmp_entries(const void *e1, const void *e2)
+{
+     int64_t         _c1, _c2;
+
+     _c1            = ((fd_ref_entry) e1)->col;
+     _c2            = ((fd_ref_entry) e2)->col;
+
+     return (_c1 > _c2) - (_c1 < _c2);
+}
+
+// }}}
+// fd_sparse_from_coo() {{{
+/******************************************************************************
+
+                         FD_SPARSE_FROM_COO
+
+     Build a CSR matrix from nnz (row, column, value) triplets, numbered
+     from 1. The values of duplicate entries are added.
+     Return 0, or -1 with errno set on error.
+
+******************************************************************************/
+int fd_sparse_from_coo(fd_ref_csr csr, int64_t n, int64_t p, int64_t nnz,
+                       int64_t *rows, int64_t *cols, double *vals)
+{
+     fd_ref_entry    _entries;
+     int64_t        *_next = NULL, _i, _k, _nb;
+
+     memset(csr, 0, sizeof(*csr));
+     csr->n         = n;
+     csr->p         = p;
+
+     for (_k = 0; _k < nnz; _k++) {
+          if (rows[_k] < 1 || rows[_k] > n || cols[_k] < 1 || cols[_k] > p) {
+               errno          = EINVAL;
+               return -1;
+          }
+     }
+
+     if ((csr->row = calloc(n + 1, sizeof(int64_t))) == NULL
+     ||  (_next    = malloc((n + 1) * sizeof(int64_t))) == NULL
+     ||  (_entries = malloc((nnz + 1) * sizeof(fd_entry))) == NULL) {
+          free(_next);
+          fd_sparse_free(csr);
+          errno          = ENOMEM;
+          return -1;
+     }
+
+     /* Counting sort of the entries by line
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_k = 0; _k < nnz; _k++) {
+          csr->row[rows[_k]]++;
+     }
+     for (_i = 1; _i <= n; _i++) {
+          csr->row[_i]  += csr->row[_i - 1];
+     }
+     memcpy(_next, csr->row, (n + 1) * sizeof(int64_t));
+     for (_k = 0; _k < nnz; _k++) {
+          _entries[_next[rows[_k] - 1]].col   = cols[_k];
+          _entries[_next[rows[_k] - 1]].val   = vals[_k];
+          _next[rows[_k] - 1]++;
+     }
+
+     /* Sort the columns of each line and merge the duplicates
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_i = 1, _nb = 0; _i <= n; _i++) {
+          int64_t             _first = csr->row[_i - 1], _last = csr->row[_i];
+
+          qsort(_entries + _first, _last - _first, sizeof(fd_entry),
+                fd_sparse_cmp_entries);
+
+          csr->row[_i - 1]    = _nb;
+          for (_k = _first; _k < _last; _k++) {
+               if (_nb > csr->row[_i - 1] && _entries[_nb - 1].col == _entries[_k].col) {
+                    _entries[_nb - 1].val    += _entries[_k].val;
+               }
+               else {
+                    _entries[_nb++]           = _entries[_k];
+               }
+          }
+     }
+     csr->row[n]    = _nb;
+     csr->nnz       = _nb;
+
+     if ((csr->col = malloc((_nb + 1) * sizeof(int64_t))) == NULL
+     ||  (csr->val = malloc((_nb + 1) * sizeof(double))) == NULL) {
+          free(_entries);
+          free(_next);
+          fd_sparse_free(csr);
+          errno          = ENOMEM;
+          return -1;
+     }
+
+     for (_k = 0; _k < _nb; _k++) {
+          csr->col[_k]   = _entries[_k].col;
+          csr->val[_k]   = _entries[_k].val;
+     }
+
+     free(_entries);
+     free(_next);
+
+     return 0;
+}
+
+// }}}
+// fd_sparse_number() {{{
+/******************************************************************************
+
+                         FD_SPARSE_NUMBER
+
+     Convert the next number of a line, skipping the leading blanks.
+     Return 0, or -1 if there is no number.
+
+******************************************************************************/
+static int fd_sparse_number(const char **ptr, const char *eol, double *value)
+{
+     const char      *_stop;
+
+     while (*ptr < eol && (**ptr == ' ' || **ptr == '\t')) {
+          (*ptr)++;
+     }
+
+     *value         = fd_csv_parse_double(*ptr, eol, &_stop);
+     if (_stop == *ptr) {
+          return -1;
+     }
+     *ptr           = _stop;
+
+     return 0;
+}
+
+// }}}
+// fd_sparse_load() {{{
+/******************************************************************************
+
+                         FD_SPARSE_LOAD
+
+     Read a sparse matrix from a Matrix Market coordinate file (real,
+     integer or pattern ; general, symmetric or skew-symmetric).
+     Return 0, or -1 with errno set on error.
+
+******************************************************************************/
+int fd_sparse_load(fd_ref_csr csr, const char *path)
+{
+     struct stat      _st;
+     const char      *_text, *_end, *_ptr, *_eol;
+     int64_t         *_rows = NULL, *_cols = NULL, _n, _p, _nnz, _k = 0, _max;
+     double          *_vals = NULL, _v[3];
+     int              _fd, _pattern, _symmetry, _ret = -1, _errno = EINVAL;
+     char             _banner[256];
+
+     memset(csr, 0, sizeof(*csr));
+
+     if ((_fd = open(path, O_RDONLY)) < 0) {
+          return -1;
+     }
+     if (fstat(_fd, &_st) < 0) {
+          _errno         = errno;
+          close(_fd);
+          errno          = _errno;
+          return -1;
+     }
+     if (_st.st_size == 0) {
+          close(_fd);
+          errno          = _errno;
+          return -1;
+     }
+     if ((_text = mmap(NULL, _st.st_size, PROT_READ, MAP_PRIVATE, _fd, 0)) == MAP_FAILED) {
+          _errno         = errno;
+          close(_fd);
+          errno          = _errno;
+          return -1;
+     }
+     close(_fd);
+     madvise((void *) _text, _st.st_size, MADV_SEQUENTIAL);
+     _end           = _text + _st.st_size;
+
+     /* Banner
+        ~~~~~~ */
+     _eol           = fd_csv_next_line(_text, _end);
+     if (_eol - _text >= sizeof(_banner)) {
+          goto end;
+     }
+     memcpy(_banner, _text, _eol - _text);
+     _banner[_eol - _text]    = 0;
+     if (strncmp(_banner, FD_MM_BANNER, strlen(FD_MM_BANNER)) != 0
+     ||  strstr(_banner, "coordinate") == NULL
+     ||  strstr(_banner, "complex") != NULL) {
+          goto end;
+     }
+     _pattern       = (strstr(_banner, "pattern") != NULL);
+     if (strstr(_banner, "skew-symmetric") != NULL) {
+          _symmetry      = FD_MM_SKEW;
+     }
+     else if (strstr(_banner, "symmetric") != NULL) {
+          _symmetry      = FD_MM_SYMMETRIC;
+     }
+     else {
+          _symmetry      = FD_MM_GENERAL;
+     }
+
+     /* Skip the comments
+        ~~~~~~~~~~~~~~~~~ */
+     for (_ptr = _eol; _ptr < _end && *_ptr == '%'; _ptr = fd_csv_next_line(_ptr, _end)) {
+          ;
+     }
+
+     /* Dimensions
+        ~~~~~~~~~~ */
+     _eol           = fd_csv_next_line(_ptr, _end);
+     if (fd_sparse_number(&_ptr, _eol, &_v[0]) < 0
+     ||  fd_sparse_number(&_ptr, _eol, &_v[1]) < 0
+     ||  fd_sparse_number(&_ptr, _eol, &_v[2]) < 0
+     ||  _v[0] < 0 || _v[1] < 0 || _v[2] < 0) {
+          goto end;
+     }
+     _n             = _v[0];
+     _p             = _v[1];
+     _nnz           = _v[2];
+     _max           = (_symmetry == FD_MM_GENERAL) ? _nnz : 2 * _nnz;
+
+     if ((_rows = malloc((_max + 1) * sizeof(int64_t))) == NULL
+     ||  (_cols = malloc((_max + 1) * sizeof(int64_t))) == NULL
+     ||  (_vals = malloc((_max + 1) * sizeof(double))) == NULL) {
+          _errno         = ENOMEM;
+          goto end;
+     }
+
+     /* Entries
+        ~~~~~~~ */
+     for (_ptr = _eol; _ptr < _end && _k < _max; _ptr = _eol) {
+          _eol           = fd_csv_next_line(_ptr, _end);
+          if (*_ptr == '%' || *_ptr == '\n') {
+               continue;
+          }
+
+          if (fd_sparse_number(&_ptr, _eol, &_v[0]) < 0
+          ||  fd_sparse_number(&_ptr, _eol, &_v[1]) < 0) {
+               goto end;
+          }
+          if (_pattern) {
+               _v[2]          = 1.0;
+          }
+          else if (fd_sparse_number(&_ptr, _eol, &_v[2]) < 0) {
+               goto end;
+          }
+
+          _rows[_k]      = _v[0];
+          _cols[_k]      = _v[1];
+          _vals[_k++]    = _v[2];
+
+          if (_symmetry != FD_MM_GENERAL && _v[0] != _v[1]) {
+               _rows[_k]      = _v[1];
+               _cols[_k]      = _v[0];
+               _vals[_k++]    = (_symmetry == FD_MM_SKEW) ? -_v[2] : _v[2];
+          }
+     }
+
+     if (fd_sparse_from_coo(csr, _n, _p, _k, _rows, _cols, _vals) == 0) {
+          _ret           = 0;
+     }
+     else {
+          _errno         = errno;
+     }
+
+end:
+     free(_rows);
+     free(_cols);
+     free(_vals);
+     munmap((void *) _text, _st.st_size);
+
+     if (_ret < 0) {
+          errno          = _errno;
+     }
+
+     return _ret;
+}
+
+// }}}
+// fd_sparse_lower_bound() {{{
+/******************************************************************************
+
+                         FD_SPARSE_LOWER_BOUND
+
+     Return the index of the first nonzero of line i whose column is
+     greater than or equal to j.
+
+******************************************************************************/
+static int64_t fd_sparse_lower_bound(fd_ref_csr csr, int64_t i, int64_t j)
+{
+     int64_t         _lo, _hi, _mid;
+
+     _lo            = csr->row[i - 1];
+     _hi            = csr->row[i];
+
+     while (_lo < _hi) {
+          _mid           = _lo + ((_hi - _lo) / 2);
+          if (csr->col[_mid] < j) {
+               _lo            = _mid + 1;
+          }
+          else {
+               _hi            = _mid;
+          }
+     }
+
+     return _lo;
+}
+
+// }}}
+// fd_sparse_value() {{{
+/******************************************************************************
+
+                         FD_SPARSE_VALUE
+
+     Return the value of element (i, j), numbered from 1.
+
+******************************************************************************/
+double fd_sparse_value(fd_ref_csr csr, int64_t i, int64_t j)
+{
+     int64_t         _k;
+
+     if (i < 1 || i > csr->n || j < 1 || j > csr->p) {
+          return 0.0;
+     }
+
+     _k             = fd_sparse_lower_bound(csr, i, j);
+     if (_k < csr->row[i] && csr->col[_k] == j) {
+          return csr->val[_k];
+     }
+
+     return 0.0;
+}
+
+// }}}
+// fd_sparse_fill_row() {{{
+/******************************************************************************
+
+                         FD_SPARSE_FILL_ROW
+
+     Fill values with the dx elements of line i starting at column j0.
+     Return the number of nonzeros found.
+
+******************************************************************************/
+int64_t fd_sparse_fill_row(fd_ref_csr csr, int64_t i, int64_t j0, int64_t dx,
+                           double *values)
+{
+     int64_t         _k, _last, _nb = 0;
+
+     memset(values, 0, dx * sizeof(double));
+
+     if (i < 1 || i > csr->n) {
+          return 0;
+     }
+
+     _last          = csr->row[i];
+     for (_k = fd_sparse_lower_bound(csr, i, j0);
+          _k < _last && csr->col[_k] < j0 + dx; _k++) {
+          values[csr->col[_k] - j0]     = csr->val[_k];
+          _nb++;
+     }
+
+     return _nb;
+}
+
+// }}}
+// fd_sparse_free() {{{
+/******************************************************************************
+
+                         FD_SPARSE_FREE
+
+     Free the arrays of a CSR matrix.
+
+******************************************************************************/
+void fd_sparse_free(fd_ref_csr csr)
+{
+     free(csr->row);
+     free(csr->col);
+     free(csr->val);
+     csr->row       = NULL;
+     csr->col       = NULL;
+     csr->val       = NULL;
+}
+
+// }}}
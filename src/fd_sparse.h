@@ -0,0 +1,57 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_sparse.h Version 1.1 du 24/07/27 - 
+ *
+ *   Sparse matrices in compressed sparse row (CSR) format.
+ */
+
+#ifndef FD_SPARSE_H
+#define FD_SPARSE_H
+
+// Includes {{{
+#include <stdint.h>
+
+// }}}
+// Structures definitions {{{
+/* The column indexes of the nonzeros of line i (numbered from 1) are
+ * col[row[i - 1]] ... col[row[i] - 1], sorted in increasing order, and
+ * their values are val[row[i - 1]] ... val[row[i] - 1].
+ */
+struct fd_csr {
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int64_t              nnz;     // Number of nonzeros
+     int64_t             *row;     // Index of the first nonzero of the lines
+     int64_t             *col;     // Column indexes of the nonzeros
+     double              *val;     // Values of the nonzeros
+};
+typedef struct fd_csr               fd_csr;
+typedef struct fd_csr              *fd_ref_csr;
+
+// }}}
+// Functions prototypes {{{
+int       fd_sparse_load(fd_ref_csr csr, const char *path);
+int       fd_sparse_from_coo(fd_ref_csr csr, int64_t n, int64_t p, int64_t nnz,
+                             int64_t *rows, int64_t *cols, double *vals);
+double    fd_sparse_value(fd_ref_csr csr, int64_t i, int64_t j);
+int64_t   fd_sparse_fill_row(fd_ref_csr csr, int64_t i, int64_t j0, int64_t dx,
+                             double *values);
+void      fd_sparse_free(fd_ref_csr csr);
+
+// }}}
+
+#endif	/* FD_SPARSE_H */
@@ -0,0 +1,358 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_term.c Version 1.2 du 24/08/10 -
+ *
+ *   Output of the terminal through a pseudo-terminal, counting the bytes
+ *   sent to the terminal.
+ *
+ *   curses writes with write() on the file descriptor of its output stream
+ *   (not through the stream itself) : the stream given to newterm() is the
+ *   slave side of a pseudo-terminal, which has the modes and the size of
+ *   the real terminal. A thread forwards what the master side reads to the
+ *   real terminal, which stays in raw mode, and counts the bytes.
+ *   fd_term_count() forwards the output still pending in the current
+ *   thread : a non-blocking read of the master side only fails once all
+ *   the bytes written on the slave side have been read, so the count of a
+ *   frame is exact once doupdate() has returned.
+ *
+ *   The size of the slave side follows the real terminal : on SIGWINCH,
+ *   the new size is copied to it before the handler of curses is called,
+ *   curses then resizing its screen from the size of the slave side.
+ */
+
+#define   _GNU_SOURCE
+
+// Includes {{{
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "fd_term.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_TERM_BUF_SIZE    (16384)
+
+// }}}
+// Global variables {{{
+/* Terminal restored at exit, the program exiting on errors in curses mode
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static fd_ref_term             fd_term_current = NULL;
+
+/* Handler of SIGWINCH replaced by fd_term_watch_size()
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static struct sigaction        fd_term_old_winch;
+static int                     fd_term_watching = 0;
+
+// }}}
+
+// fd_term_forward() {{{
+/******************************************************************************
+
+                         FD_TERM_FORWARD
+
+     Forward to the real terminal the bytes available on the master side.
+     The lock must be held.
+     Return 0, or -1 if the slave side is closed or on error.
+
+******************************************************************************/
+static int fd_term_forward(fd_ref_term term)
+{
+     char                 _buf[FD_TERM_BUF_SIZE];
+     ssize_t              _len, _w, _off;
+
+     for (;;) {
+          if ((_len = read(term->master, _buf, sizeof(_buf))) < 0) {
+               if (errno == EINTR) {
+                    continue;
+               }
+               return errno == EAGAIN ? 0 : -1;
+          }
+          if (_len == 0) {
+               return -1;
+          }
+
+          for (_off = 0; _off < _len; _off += _w) {
+               if ((_w = write(term->out, _buf + _off, _len - _off)) < 0) {
+                    if (errno == EINTR) {
+                         _w             = 0;
+                         continue;
+                    }
+                    return -1;
+               }
+          }
+          term->nb_bytes += _len;
+     }
+}
+
+// }}}
+// fd_term_relay() {{{
+/******************************************************************************
+
+                         FD_TERM_RELAY
+
+     Thread forwarding the output of curses as it is written, until the
+     slave side is closed.
+
+******************************************************************************/
+static void *fd_term_relay(void *arg)
+{
+     fd_ref_term          _term = arg;
+     struct pollfd        _pfd;
+     int                  _ret;
+
+     _pfd.fd        = _term->master;
+     _pfd.events    = POLLIN;
+
+     for (;;) {
+          if (poll(&_pfd, 1, -1) < 0) {
+               if (errno == EINTR) {
+                    continue;
+               }
+               break;
+          }
+
+          pthread_mutex_lock(&_term->lock);
+          _ret           = fd_term_forward(_term);
+          pthread_mutex_unlock(&_term->lock);
+          if (_ret < 0) {
+               break;
+          }
+     }
+
+     return NULL;
+}
+
+// }}}
+// fd_term_restore() {{{
+/******************************************************************************
+
+                         FD_TERM_RESTORE
+
+     Forward the pending output, and restore the modes of the real terminal.
+
+******************************************************************************/
+static void fd_term_restore(void)
+{
+     if (fd_term_current == NULL) {
+          return;
+     }
+
+     fd_term_count(fd_term_current);
+     tcsetattr(fd_term_current->out, TCSADRAIN, &fd_term_current->saved);
+}
+
+// }}}
+// fd_term_winch() {{{
+/******************************************************************************
+
+                         FD_TERM_WINCH
+
+     Handler of SIGWINCH : copy the size of the real terminal to the slave
+     side, then call the previous handler (the one of curses).
+
+******************************************************************************/
+static void fd_term_winch(int sig, siginfo_t *info, void *uctx)
+{
+     struct winsize       _ws;
+     int                  _errno = errno;
+
+     if (fd_term_current != NULL
+     &&  ioctl(fd_term_current->out, TIOCGWINSZ, &_ws) == 0) {
+          ioctl(fd_term_current->slave, TIOCSWINSZ, &_ws);
+     }
+     errno          = _errno;
+
+     if (fd_term_old_winch.sa_flags & SA_SIGINFO) {
+          (*fd_term_old_winch.sa_sigaction)(sig, info, uctx);
+     }
+     else if (fd_term_old_winch.sa_handler != SIG_DFL
+          &&  fd_term_old_winch.sa_handler != SIG_IGN) {
+          (*fd_term_old_winch.sa_handler)(sig);
+     }
+}
+
+// }}}
+// fd_term_open() {{{
+/******************************************************************************
+
+                         FD_TERM_OPEN
+
+     Create the pseudo-terminal of the output of curses, out being the real
+     terminal. The terminal must then be initialized with
+     newterm(NULL, term->ofp, stdin).
+     Return 0, or -1 if out is not a terminal or on error : curses must
+     then write directly to the terminal (initscr()).
+
+******************************************************************************/
+int fd_term_open(fd_ref_term term, int out)
+{
+     struct termios       _raw;
+     struct winsize       _ws;
+     sigset_t             _winch, _mask;
+     int                  _ret;
+
+     memset(term, 0, sizeof(*term));
+     term->master   = term->slave = -1;
+     term->out      = out;
+
+     if (tcgetattr(out, &term->saved) < 0 || ioctl(out, TIOCGWINSZ, &_ws) < 0) {
+          return -1;
+     }
+
+     if ((term->master = posix_openpt(O_RDWR | O_NOCTTY)) < 0
+     ||  grantpt(term->master) < 0 || unlockpt(term->master) < 0
+     ||  (term->slave = open(ptsname(term->master), O_RDWR | O_NOCTTY)) < 0
+     ||  tcsetattr(term->slave, TCSANOW, &term->saved) < 0
+     ||  ioctl(term->slave, TIOCSWINSZ, &_ws) < 0
+     ||  fcntl(term->master, F_SETFL, O_NONBLOCK) < 0
+     ||  (term->ofp = fdopen(term->slave, "w")) == NULL) {
+          goto error;
+     }
+
+     /* SIGWINCH must interrupt the reads of curses, not the relay
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     sigemptyset(&_winch);
+     sigaddset(&_winch, SIGWINCH);
+     pthread_sigmask(SIG_BLOCK, &_winch, &_mask);
+
+     pthread_mutex_init(&term->lock, NULL);
+     _ret           = pthread_create(&term->relay, NULL, fd_term_relay, term);
+     pthread_sigmask(SIG_SETMASK, &_mask, NULL);
+     if (_ret != 0) {
+          pthread_mutex_destroy(&term->lock);
+          fclose(term->ofp);
+          term->slave    = -1;
+          goto error;
+     }
+
+     /* The keys are read on the real terminal : curses sets the modes of
+        the slave side only
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     _raw           = term->saved;
+     cfmakeraw(&_raw);
+     tcsetattr(out, TCSADRAIN, &_raw);
+
+     fd_term_current     = term;
+     atexit(fd_term_restore);
+
+     return 0;
+
+error:
+     if (term->slave >= 0) {
+          close(term->slave);
+     }
+     if (term->master >= 0) {
+          close(term->master);
+     }
+     term->master   = term->slave = -1;
+
+     return -1;
+}
+
+// }}}
+// fd_term_watch_size() {{{
+/******************************************************************************
+
+                         FD_TERM_WATCH_SIZE
+
+     Pass the resizes of the real terminal to the slave side. To be called
+     after newterm(), once curses has installed its handler of SIGWINCH.
+
+******************************************************************************/
+void fd_term_watch_size(fd_ref_term term)
+{
+     struct sigaction     _act;
+
+     if (term->master < 0 || fd_term_watching) {
+          return;
+     }
+
+     memset(&_act, 0, sizeof(_act));
+     _act.sa_sigaction   = fd_term_winch;
+     _act.sa_flags       = SA_SIGINFO;
+     sigemptyset(&_act.sa_mask);
+     if (sigaction(SIGWINCH, &_act, &fd_term_old_winch) == 0) {
+          fd_term_watching    = 1;
+     }
+}
+
+// }}}
+// fd_term_count() {{{
+/******************************************************************************
+
+                         FD_TERM_COUNT
+
+     Forward the output written so far, and return the number of bytes sent
+     to the terminal since the previous call (0 without pseudo-terminal).
+
+******************************************************************************/
+long fd_term_count(fd_ref_term term)
+{
+     long                 _nb;
+
+     if (term->master < 0) {
+          return 0;
+     }
+
+     pthread_mutex_lock(&term->lock);
+     fd_term_forward(term);
+     _nb            = term->nb_bytes;
+     term->nb_bytes = 0;
+     pthread_mutex_unlock(&term->lock);
+
+     return _nb;
+}
+
+// }}}
+// fd_term_close() {{{
+/******************************************************************************
+
+                         FD_TERM_CLOSE
+
+     Forward the last output, restore the real terminal and release the
+     pseudo-terminal. To be called after endwin().
+
+******************************************************************************/
+void fd_term_close(fd_ref_term term)
+{
+     if (term->master < 0) {
+          return;
+     }
+
+     if (fd_term_watching) {
+          sigaction(SIGWINCH, &fd_term_old_winch, NULL);
+          fd_term_watching    = 0;
+     }
+
+     fd_term_restore();
+     fd_term_current     = NULL;
+
+     /* Closing the slave side stops the relay
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     fclose(term->ofp);
+     pthread_join(term->relay, NULL);
+     pthread_mutex_destroy(&term->lock);
+     close(term->master);
+     term->master   = term->slave = -1;
+}
+
+// }}}
@@ -0,0 +1,55 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_term.h Version 1.2 du 24/08/10 -
+ *
+ *   Output of the terminal through a pseudo-terminal, counting the bytes
+ *   sent to the terminal.
+ */
+
+#ifndef FD_TERM_H
+#define FD_TERM_H
+
+// Includes {{{
+#include <stdio.h>
+#include <termios.h>
+#include <pthread.h>
+
+// }}}
+// Structures definitions {{{
+struct fd_term {
+     int                  master;  // Master side of the pseudo-terminal
+     int                  slave;   // Slave side, the output of curses
+     int                  out;     // Real terminal
+     FILE                *ofp;     // Stream of the slave side, for newterm()
+     struct termios       saved;   // Modes of the real terminal
+     long                 nb_bytes; // Bytes sent since the last count
+     pthread_mutex_t      lock;    // Protects nb_bytes and the forwarding
+     pthread_t            relay;   // Thread forwarding the output
+};
+typedef struct fd_term              fd_term;
+typedef struct fd_term             *fd_ref_term;
+
+// }}}
+// Functions prototypes {{{
+int       fd_term_open(fd_ref_term term, int out);
+void      fd_term_watch_size(fd_ref_term term);
+long      fd_term_count(fd_ref_term term);
+void      fd_term_close(fd_ref_term term);
+
+// }}}
+
+#endif	/* FD_TERM_H */
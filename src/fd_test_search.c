@@ -0,0 +1,117 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_test_search.c Version 1.1 du 24/08/10 -
+ *
+ *   Test of the descriptions of searches, and of a search of a range.
+ *   Exit status : number of failed checks.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include "fd_search.h"
+
+// }}}
+// Structures definitions {{{
+struct fd_parse_case {
+     const char          *text;    // Description of the search
+     int                  ret;     // Expected result of fd_search_parse()
+     int                  kind;    // Expected kind of search
+     double               a;       // Expected value, or lower bound
+     double               b;       // Expected upper bound
+};
+typedef struct fd_parse_case        fd_parse_case;
+
+// }}}
+// Global variables {{{
+static const fd_parse_case     fd_cases[] = {
+     { "10..12",          0, FD_SEARCH_RANGE,   10.0,   12.0 },
+     { "7000..9000",      0, FD_SEARCH_RANGE, 7000.0, 9000.0 },
+     { "-5..5",           0, FD_SEARCH_RANGE,   -5.0,    5.0 },
+     { " 3 .. 4 ",        0, FD_SEARCH_RANGE,    3.0,    4.0 },
+     { "1.5..3",          0, FD_SEARCH_RANGE,    1.5,    3.0 },
+     { "10.0..12",        0, FD_SEARCH_RANGE,   10.0,   12.0 },
+     { "-1e3..-2",        0, FD_SEARCH_RANGE, -1000.0,  -2.0 },
+     { "42",              0, FD_SEARCH_EQ,      42.0,    0.0 },
+     { "=-7",             0, FD_SEARCH_EQ,      -7.0,    0.0 },
+     { ">2.5",            0, FD_SEARCH_GT,       2.5,    0.0 },
+     { "<0",              0, FD_SEARCH_LT,       0.0,    0.0 },
+     { "max",             0, FD_SEARCH_MAX,      0.0,    0.0 },
+     { "min",             0, FD_SEARCH_MIN,      0.0,    0.0 },
+     { "12..10",         -1, 0,                  0.0,    0.0 },
+     { "..5",            -1, 0,                  0.0,    0.0 },
+     { "5..",            -1, 0,                  0.0,    0.0 },
+     { "1..2..3",        -1, 0,                  0.0,    0.0 },
+     { ">1..2",          -1, 0,                  0.0,    0.0 },
+     { "abc",            -1, 0,                  0.0,    0.0 },
+     { "",               -1, 0,                  0.0,    0.0 },
+};
+
+// }}}
+
+// main() {{{
+/******************************************************************************
+
+                              MAIN
+
+******************************************************************************/
+int main(void)
+{
+     fd_search            _search;
+     fd_provider          _provider;
+     const fd_parse_case *_case;
+     int                  _k, _ret, _nb_errors = 0;
+
+     /* Descriptions of searches
+        ~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_k = 0; _k < (int) (sizeof(fd_cases) / sizeof(fd_cases[0])); _k++) {
+          _case          = &fd_cases[_k];
+          _ret           = fd_search_parse(&_search, _case->text);
+          if (_ret != _case->ret
+          ||  (_ret == 0 && (_search.kind != _case->kind || _search.a != _case->a
+                             || (_case->kind == FD_SEARCH_RANGE && _search.b != _case->b)))) {
+               fprintf(stderr, "\"%s\" : parse error\n", _case->text);
+               _nb_errors++;
+          }
+     }
+
+     /* Integer range on a matrix, the values being i * 100 + j
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (fd_provider_expr(&_provider, 30, 25, "i * 100 + j") < 0) {
+          fprintf(stderr, "Expression : %s\n", fd_provider_error());
+          return 1;
+     }
+
+     if (fd_search_parse(&_search, "1505..1507") < 0
+     ||  !fd_search_run(&_provider, &_search, 1, 1, 4)
+     ||  _search.i != 15 || _search.j != 5 || _search.value != 1505.0) {
+          fprintf(stderr, "\"1505..1507\" : search error\n");
+          _nb_errors++;
+     }
+
+     if (fd_search_parse(&_search, "-5..5") < 0
+     ||  fd_search_run(&_provider, &_search, 1, 1, 4)) {
+          fprintf(stderr, "\"-5..5\" : search error\n");
+          _nb_errors++;
+     }
+     fd_provider_close(&_provider);
+
+     printf("%s\n", _nb_errors == 0 ? "OK" : "FAILED");
+
+     return _nb_errors;
+}
+
+// }}}
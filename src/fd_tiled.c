@@ -0,0 +1,465 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_tiled.c Version 1.1 du 24/07/28 -
+ *
+ *   In-memory matrices stored in square tiles.
+ *
+ *   In a row-major array, the elements of a column are one line apart :
+ *   moving vertically or jumping to another column touches a different
+ *   cache line and often a different page for each line of the viewport.
+ *   With tiles of FD_TILE_SIZE x FD_TILE_SIZE elements, a viewport of a
+ *   few dozen lines and columns lies in at most four tiles, whatever the
+ *   direction of the move. In Morton order, neighbouring tiles are also
+ *   close in memory. Elements are stored at their native width.
+ */
+
+// Includes {{{
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fd_tiled.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_MIN(a, b)        ((a) < (b) ? (a) : (b))
+
+// }}}
+// Structures definitions {{{
+struct fd_tile_key {
+     uint64_t             key;     // Morton code of the tile
+     int64_t              idx;     // Index of the tile in the grid
+};
+typedef struct fd_tile_key          fd_tile_key;
+typedef struct fd_tile_key         *fd_ref_tile_key;
+
+// }}}
+
+// fd_tiled_spread() {{{
+/******************************************************************************
+
+                         FD_TILED_SPREAD
+
+     Insert a null bit before each of the 32 low order bits of x.
+
+******************************************************************************/
+static uint64_t fd_tiled_spread(uint64_t x)
+{
+     x              &= 0xFFFFFFFFULL;
+     x               = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+     x               = (x | (x <<  8)) & 0x00FF00FF00FF00FFULL;
+     x               = (x | (x <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+     x               = (x | (x <<  2)) & 0x3333333333333333ULL;
+     x               = (x | (x <<  1)) & 0x5555555555555555ULL;
+
+     return x;
+}
+
+// }}}
+// fd_tiled_cmp_keys() {{{
+/******************************************************************************
+
+                         FD_TILED_CMP_KEYS
+
+     Compare the Morton codes of two tiles (for qsort()).
+
+******************************************************************************/
+static int fd_tiled_cmp_keys(const void *k1, const void *k2)
+{
+     uint64_t        _c1, _c2;
+
+     _c1            = ((fd_ref_tile_key) k1)->key;
+     _c2            = ((fd_ref_tile_key) k2)->key;
+
+     return (_c1 > _c2) - (_c1 < _c2);
+}
+
+// }}}
+// fd_tiled_morton() {{{
+/******************************************************************************
+
+                         FD_TILED_MORTON
+
+     Store the tiles in the order of the Morton codes of their coordinates.
+     The grid is generally not a square of a power of two : the codes are
+     sorted and replaced by their ranks, so that no space is lost.
+
+******************************************************************************/
+static int fd_tiled_morton(fd_ref_tiled tiled)
+{
+     fd_ref_tile_key      _keys;
+     int64_t              _ti, _tj, _k, _nb;
+
+     _nb            = tiled->tn * tiled->tp;
+     if ((_keys = malloc(_nb * sizeof(*_keys))) == NULL) {
+          return -1;
+     }
+
+     for (_ti = 0, _k = 0; _ti < tiled->tn; _ti++) {
+          for (_tj = 0; _tj < tiled->tp; _tj++, _k++) {
+               _keys[_k].key  = (fd_tiled_spread(_ti) << 1) | fd_tiled_spread(_tj);
+               _keys[_k].idx  = _k;
+          }
+     }
+     qsort(_keys, _nb, sizeof(*_keys), fd_tiled_cmp_keys);
+
+     for (_k = 0; _k < _nb; _k++) {
+          tiled->tile[_keys[_k].idx]    = _k * FD_TILE_ELTS;
+     }
+     free(_keys);
+
+     return 0;
+}
+
+// }}}
+// fd_tiled_create() {{{
+/******************************************************************************
+
+                         FD_TILED_CREATE
+
+     Allocate a null n x p matrix of elements of the specified type, its
+     tiles being stored in the specified order. Return 0, or -1 with errno
+     set.
+
+******************************************************************************/
+int fd_tiled_create(fd_ref_tiled tiled, int64_t n, int64_t p, int elt_type, int order)
+{
+     int64_t              _k, _nb;
+
+     if (n < 1 || p < 1 || fd_elt_size(elt_type) == 0
+     || (order != FD_TILED_ROW_MAJOR && order != FD_TILED_MORTON)) {
+          errno          = EINVAL;
+          return -1;
+     }
+
+     tiled->n       = n;
+     tiled->p       = p;
+     tiled->tn      = (n + FD_TILE_MASK) >> FD_TILE_SHIFT;
+     tiled->tp      = (p + FD_TILE_MASK) >> FD_TILE_SHIFT;
+     tiled->order   = order;
+     tiled->elt_type = elt_type;
+     tiled->elt_size = fd_elt_size(elt_type);
+     tiled->tile    = NULL;
+     tiled->data    = NULL;
+
+     if (tiled->tn > (int64_t) (SIZE_MAX / tiled->elt_size / FD_TILE_ELTS) / tiled->tp) {
+          errno          = ENOMEM;
+          return -1;
+     }
+     _nb            = tiled->tn * tiled->tp;
+
+     /* Pages of the tiles never written are never touched
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if ((tiled->tile = malloc(_nb * sizeof(*tiled->tile))) == NULL
+     ||  (tiled->data = calloc(_nb * FD_TILE_ELTS, tiled->elt_size)) == NULL) {
+          fd_tiled_free(tiled);
+          return -1;
+     }
+
+     if (order == FD_TILED_MORTON) {
+          if (fd_tiled_morton(tiled) < 0) {
+               fd_tiled_free(tiled);
+               return -1;
+          }
+     }
+     else {
+          for (_k = 0; _k < _nb; _k++) {
+               tiled->tile[_k]     = _k * FD_TILE_ELTS;
+          }
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_tiled_elt() {{{
+/******************************************************************************
+
+                         FD_TILED_ELT
+
+     Return the address of element (i, j), numbered from 1.
+
+******************************************************************************/
+static inline char *fd_tiled_elt(fd_ref_tiled tiled, int64_t i, int64_t j)
+{
+     i--;
+     j--;
+
+     return tiled->data + (tiled->tile[((i >> FD_TILE_SHIFT) * tiled->tp) + (j >> FD_TILE_SHIFT)]
+                        + ((i & FD_TILE_MASK) << FD_TILE_SHIFT) + (j & FD_TILE_MASK))
+                        * tiled->elt_size;
+}
+
+// }}}
+// fd_tiled_copy() {{{
+/******************************************************************************
+
+                         FD_TILED_COPY
+
+     Copy nb elements of size elt_size, whose addresses are src_step and
+     dst_step elements apart. The parts of lines and columns copied are
+     short : typed loops are faster than calls to memcpy().
+
+******************************************************************************/
+static inline void fd_tiled_copy(void *dst, int64_t dst_step, const void *src,
+                                 int64_t src_step, int64_t nb, int elt_size)
+{
+     int64_t         _k;
+
+#define   FD_TILED_COPY_LOOP(type)                                         \
+     for (_k = 0; _k < nb; _k++) {                                         \
+          ((type *) dst)[_k * dst_step]  = ((const type *) src)[_k * src_step];  \
+     }
+
+     switch (elt_size) {
+
+     case 1:
+          FD_TILED_COPY_LOOP(uint8_t);
+          break;
+
+     case 2:
+          FD_TILED_COPY_LOOP(uint16_t);
+          break;
+
+     case 4:
+          FD_TILED_COPY_LOOP(uint32_t);
+          break;
+
+     case 8:
+          FD_TILED_COPY_LOOP(uint64_t);
+          break;
+
+     default:
+          for (_k = 0; _k < nb; _k++) {
+               memcpy((char *) dst + (_k * dst_step * elt_size),
+                      (const char *) src + (_k * src_step * elt_size), elt_size);
+          }
+          break;
+     }
+
+#undef    FD_TILED_COPY_LOOP
+}
+
+// }}}
+// fd_tiled_load() {{{
+/******************************************************************************
+
+                         FD_TILED_LOAD
+
+     Copy the matrix of a matrix file in a tiled matrix. Only the lines
+     already written in the file are copied, the other ones are null.
+     Return 0, or -1 with errno set.
+
+******************************************************************************/
+int fd_tiled_load(fd_ref_tiled tiled, fd_ref_mmap map, int order)
+{
+     int64_t              _i, _j, _nb, _ready;
+     char                *_line;
+
+     if (fd_tiled_create(tiled, map->n, map->p, map->elt_type, order) < 0) {
+          return -1;
+     }
+
+     _ready         = fd_mmap_ready(map);
+     for (_i = 1; _i <= _ready; _i++) {
+          _line          = map->data + ((_i - 1) * map->stride);
+
+          /* Copy the line one tile at a time
+             ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+          for (_j = 1; _j <= map->p; _j += FD_TILE_SIZE) {
+               _nb            = FD_MIN(FD_TILE_SIZE, map->p - _j + 1);
+               memcpy(fd_tiled_elt(tiled, _i, _j), _line + ((_j - 1) * map->elt_size),
+                      _nb * map->elt_size);
+          }
+     }
+
+     return 0;
+}
+
+// }}}
+// fd_tiled_value() {{{
+/******************************************************************************
+
+                         FD_TILED_VALUE
+
+     Return the value of element (i, j), numbered from 1.
+     Elements outside of the matrix are null.
+
+******************************************************************************/
+double fd_tiled_value(fd_ref_tiled tiled, int64_t i, int64_t j)
+{
+     double          _value;
+
+     if (i < 1 || i > tiled->n || j < 1 || j > tiled->p) {
+          return 0.0;
+     }
+
+     fd_elt_to_double(tiled->elt_type, fd_tiled_elt(tiled, i, j), 1, &_value);
+
+     return _value;
+}
+
+// }}}
+// fd_tiled_set_value() {{{
+/******************************************************************************
+
+                         FD_TILED_SET_VALUE
+
+     Set the value of element (i, j), numbered from 1.
+
+******************************************************************************/
+void fd_tiled_set_value(fd_ref_tiled tiled, int64_t i, int64_t j, double value)
+{
+     if (i < 1 || i > tiled->n || j < 1 || j > tiled->p) {
+          return;
+     }
+
+     fd_elt_from_double(tiled->elt_type, &value, 1, fd_tiled_elt(tiled, i, j));
+}
+
+// }}}
+// fd_tiled_fill_row() {{{
+/******************************************************************************
+
+                         FD_TILED_FILL_ROW
+
+     Copy the dx elements of line i starting at column j0 into elts, at
+     their native width, one contiguous segment per tile.
+
+******************************************************************************/
+void fd_tiled_fill_row(fd_ref_tiled tiled, int64_t i, int64_t j0, int64_t dx,
+                       void *elts)
+{
+     int64_t         _k, _j, _nb;
+     char           *_dst = elts;
+
+     if (i < 1 || i > tiled->n) {
+          memset(_dst, 0, dx * tiled->elt_size);
+          return;
+     }
+
+     for (_k = 0, _j = j0; _k < dx; _k += _nb, _j += _nb) {
+          if (_j < 1 || _j > tiled->p) {
+               memset(_dst + (_k * tiled->elt_size), 0, tiled->elt_size);
+               _nb            = 1;
+               continue;
+          }
+
+          _nb            = FD_MIN(dx - _k, FD_TILE_SIZE - ((_j - 1) & FD_TILE_MASK));
+          _nb            = FD_MIN(_nb, tiled->p - _j + 1);
+          fd_tiled_copy(_dst + (_k * tiled->elt_size), 1, fd_tiled_elt(tiled, i, _j), 1,
+                        _nb, tiled->elt_size);
+     }
+}
+
+// }}}
+// fd_tiled_fill() {{{
+/******************************************************************************
+
+                         FD_TILED_FILL
+
+     Copy the dy x dx elements of the sub-matrix starting at (i0, j0) into
+     elts, line by line. The address of each tile is computed once and the
+     parts of its lines are copied with no other lookup.
+
+******************************************************************************/
+void fd_tiled_fill(fd_ref_tiled tiled, int64_t i0, int64_t j0, int64_t dy, int64_t dx,
+                   void *elts)
+{
+     int64_t         _k, _i, _j, _l, _nb_i, _nb_j, _sz;
+     char           *_src, *_dst;
+
+     _sz            = tiled->elt_size;
+
+     /* Elements outside of the matrix are null
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     if (i0 < 1 || j0 < 1 || i0 + dy - 1 > tiled->n || j0 + dx - 1 > tiled->p) {
+          for (_k = 0; _k < dy; _k++) {
+               fd_tiled_fill_row(tiled, i0 + _k, j0, dx, (char *) elts + (_k * dx * _sz));
+          }
+          return;
+     }
+
+     for (_i = i0; _i < i0 + dy; _i += _nb_i) {
+          _nb_i          = FD_MIN(i0 + dy - _i, FD_TILE_SIZE - ((_i - 1) & FD_TILE_MASK));
+
+          for (_j = j0; _j < j0 + dx; _j += _nb_j) {
+               _nb_j          = FD_MIN(j0 + dx - _j, FD_TILE_SIZE - ((_j - 1) & FD_TILE_MASK));
+               _src           = fd_tiled_elt(tiled, _i, _j);
+               _dst           = (char *) elts + ((((_i - i0) * dx) + (_j - j0)) * _sz);
+
+               for (_l = 0; _l < _nb_i; _l++) {
+                    fd_tiled_copy(_dst, 1, _src, 1, _nb_j, _sz);
+                    _src          += FD_TILE_SIZE * _sz;
+                    _dst          += dx * _sz;
+               }
+          }
+     }
+}
+
+// }}}
+// fd_tiled_fill_col() {{{
+/******************************************************************************
+
+                         FD_TILED_FILL_COL
+
+     Copy the dy elements of column j starting at line i0 into elts, at
+     their native width.
+
+******************************************************************************/
+void fd_tiled_fill_col(fd_ref_tiled tiled, int64_t i0, int64_t j, int64_t dy,
+                       void *elts)
+{
+     int64_t         _k, _i, _nb;
+     char           *_dst = elts;
+
+     if (j < 1 || j > tiled->p) {
+          memset(_dst, 0, dy * tiled->elt_size);
+          return;
+     }
+
+     for (_k = 0, _i = i0; _k < dy; _k += _nb, _i += _nb) {
+          if (_i < 1 || _i > tiled->n) {
+               memset(_dst + (_k * tiled->elt_size), 0, tiled->elt_size);
+               _nb            = 1;
+               continue;
+          }
+
+          _nb            = FD_MIN(dy - _k, FD_TILE_SIZE - ((_i - 1) & FD_TILE_MASK));
+          _nb            = FD_MIN(_nb, tiled->n - _i + 1);
+          fd_tiled_copy(_dst + (_k * tiled->elt_size), 1, fd_tiled_elt(tiled, _i, j),
+                        FD_TILE_SIZE, _nb, tiled->elt_size);
+     }
+}
+
+// }}}
+// fd_tiled_free() {{{
+/******************************************************************************
+
+                         FD_TILED_FREE
+
+     Free the arrays of a tiled matrix.
+
+******************************************************************************/
+void fd_tiled_free(fd_ref_tiled tiled)
+{
+     free(tiled->tile);
+     free(tiled->data);
+     tiled->tile    = NULL;
+     tiled->data    = NULL;
+}
+
+// }}}
@@ -0,0 +1,83 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_tiled.h Version 1.1 du 24/07/28 -
+ *
+ *   In-memory matrices stored in square tiles.
+ */
+
+#ifndef FD_TILED_H
+#define FD_TILED_H
+
+// Includes {{{
+#include <stdint.h>
+#include "fd_mmap.h"
+
+// }}}
+// Macros definitions {{{
+/* Tiles geometry : a tile of 64 x 64 doubles uses 32 KB
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_TILE_SHIFT       (6)
+#define   FD_TILE_SIZE        (1 << FD_TILE_SHIFT)
+#define   FD_TILE_MASK        (FD_TILE_SIZE - 1)
+#define   FD_TILE_ELTS        (FD_TILE_SIZE * FD_TILE_SIZE)
+
+/* Order of the tiles in memory
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define   FD_TILED_ROW_MAJOR  (0)
+#define   FD_TILED_MORTON     (1)
+
+// }}}
+// Structures definitions {{{
+/* The elements of a tile are stored in row-major order. The tiles are
+ * stored either in row-major order or in Morton (Z) order of their
+ * coordinates in the grid of tiles ; tile[(ti * tp) + tj] is the index in
+ * data of the first element of tile (ti, tj), in elements of elt_size
+ * bytes. The tiles of the last line and of the last column of the grid
+ * are padded with zeros.
+ */
+struct fd_tiled {
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int64_t              tn;      // Number of lines of the grid of tiles
+     int64_t              tp;      // Number of columns of the grid of tiles
+     int                  order;   // Order of the tiles in memory
+     int                  elt_type; // Type of the elements
+     int                  elt_size; // Size of an element (in bytes)
+     int64_t             *tile;    // Offsets of the tiles
+     char                *data;    // Elements
+};
+typedef struct fd_tiled             fd_tiled;
+typedef struct fd_tiled            *fd_ref_tiled;
+
+// }}}
+// Functions prototypes {{{
+int       fd_tiled_create(fd_ref_tiled tiled, int64_t n, int64_t p, int elt_type,
+                          int order);
+int       fd_tiled_load(fd_ref_tiled tiled, fd_ref_mmap map, int order);
+double    fd_tiled_value(fd_ref_tiled tiled, int64_t i, int64_t j);
+void      fd_tiled_set_value(fd_ref_tiled tiled, int64_t i, int64_t j, double value);
+void      fd_tiled_fill_row(fd_ref_tiled tiled, int64_t i, int64_t j0, int64_t dx,
+                            void *elts);
+void      fd_tiled_fill(fd_ref_tiled tiled, int64_t i0, int64_t j0, int64_t dy,
+                        int64_t dx, void *elts);
+void      fd_tiled_fill_col(fd_ref_tiled tiled, int64_t i0, int64_t j, int64_t dy,
+                            void *elts);
+void      fd_tiled_free(fd_ref_tiled tiled);
+
+// }}}
+
+#endif	/* FD_TILED_H */
@@ -0,0 +1,443 @@
+/* ============================================================================
+ * Copyright (C) 2023-2024, Martial Bornet
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @(#)  [MB] fd_tiled_bench.c Version 1.1 du 24/07/28 -
+ *
+ *   Benchmark of the storage of in-memory matrices for the navigation
+ *   commands of rectangle.
+ *
+ *   The same matrix is stored in a row-major array, in tiles stored in
+ *   row-major order and in tiles stored in Morton order. For each command,
+ *   the viewport is moved steps times as rectangle does, and its dy x dx
+ *   elements are read after each move. The average time per
+ *   viewport is displayed, with a checksum of the values read, which must
+ *   be the same for the three layouts.
+ */
+
+// Includes {{{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "fd_tiled.h"
+
+// }}}
+// Macros definitions {{{
+#define   FD_NB_LAYOUTS       (3)
+#define   FD_NB_MOVES         (sizeof(fd_moves) / sizeof(fd_moves[0]))
+
+/* Kinds of moves
+   ~~~~~~~~~~~~~~ */
+#define   FD_MOVE_LINES       (1)      // Move of mult lines
+#define   FD_MOVE_COLS        (2)      // Move of mult columns
+#define   FD_MOVE_PAGES       (3)      // Move of mult x dy lines
+#define   FD_MOVE_TABS        (4)      // Move of mult x dx columns
+#define   FD_MOVE_GOTO_LINE   (5)      // Jump to a random line
+#define   FD_MOVE_GOTO_COL    (6)      // Jump to a random column
+
+// }}}
+// Structures definitions {{{
+struct fd_row_major {
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int                  elt_size; // Size of an element (in bytes)
+     char                *data;    // Elements
+};
+typedef struct fd_row_major         fd_row_major;
+typedef struct fd_row_major        *fd_ref_row_major;
+
+struct fd_move {
+     char                *name;    // Name of the command
+     int                  kind;    // Kind of move
+     int                  mult;    // Length and direction of the move
+};
+typedef struct fd_move              fd_move;
+typedef struct fd_move             *fd_ref_move;
+
+struct fd_bench {
+     int64_t              n;       // Matrix lines number
+     int64_t              p;       // Matrix columns number
+     int64_t              dy;      // Viewport height
+     int64_t              dx;      // Viewport width
+     long                 steps;   // Number of moves per command
+     int                  elt_type; // Type of the elements
+     int                  elt_size; // Size of an element (in bytes)
+     fd_row_major         rm;      // Row-major layout
+     fd_tiled             tiled;   // Tiled layouts
+     int                  layout;  // Current layout
+     char                *elts;    // Elements of the viewport
+};
+typedef struct fd_bench             fd_bench;
+typedef struct fd_bench            *fd_ref_bench;
+
+// }}}
+// Global variables {{{
+static fd_move                      fd_moves[] = {
+     { "Right",          FD_MOVE_COLS,         1 },
+     { "Left",           FD_MOVE_COLS,        -1 },
+     { "Down",           FD_MOVE_LINES,        1 },
+     { "Up",             FD_MOVE_LINES,       -1 },
+     { "NPage",          FD_MOVE_PAGES,        1 },
+     { "PPage",          FD_MOVE_PAGES,       -1 },
+     { "Tab",            FD_MOVE_TABS,         1 },
+     { "Shift-Tab",      FD_MOVE_TABS,        -1 },
+     { "nG",             FD_MOVE_GOTO_LINE,    0 },
+     { "n|",             FD_MOVE_GOTO_COL,     0 },
+};
+
+static char                        *fd_layout_names[FD_NB_LAYOUTS] = {
+     "row-major", "tiled", "morton"
+};
+
+// }}}
+
+// fd_gen_value() {{{
+/******************************************************************************
+
+                         FD_GEN_VALUE
+
+     Value of element (i, j) of the benchmark matrix (it fits in any type).
+
+******************************************************************************/
+static inline double fd_gen_value(int64_t i, int64_t j)
+{
+     return (double) (((i * 7919) ^ (j * 104729)) % 100);
+}
+
+// }}}
+// fd_rm_fill() {{{
+/******************************************************************************
+
+                         FD_RM_FILL
+
+     Copy the dy x dx elements of the sub-matrix of a row-major matrix
+     starting at (i0, j0) into elts, line by line (the sub-matrix is inside
+     the matrix).
+
+******************************************************************************/
+static void fd_rm_fill(fd_ref_row_major rm, int64_t i0, int64_t j0, int64_t dy,
+                       int64_t dx, char *elts)
+{
+     int64_t         _k;
+     char           *_src;
+
+     _src           = rm->data + ((((i0 - 1) * rm->p) + (j0 - 1)) * rm->elt_size);
+     for (_k = 0; _k < dy; _k++) {
+          memcpy(elts + (_k * dx * rm->elt_size), _src, dx * rm->elt_size);
+          _src          += rm->p * rm->elt_size;
+     }
+}
+
+// }}}
+// fd_bench_init_layout() {{{
+/******************************************************************************
+
+                         FD_BENCH_INIT_LAYOUT
+
+     Allocate and fill the matrix in the specified layout.
+
+******************************************************************************/
+static void fd_bench_init_layout(fd_ref_bench bench, int layout)
+{
+     int64_t              _i, _j;
+     double              *_line;
+
+     bench->layout  = layout;
+
+     if (layout == 0) {
+          bench->rm.n         = bench->n;
+          bench->rm.p         = bench->p;
+          bench->rm.elt_size  = bench->elt_size;
+          if ((bench->rm.data = malloc(bench->n * bench->p * bench->elt_size)) == NULL
+          ||  (_line = malloc(bench->p * sizeof(double))) == NULL) {
+               fprintf(stderr, "Malloc error !\n");
+               exit(1);
+          }
+          for (_i = 1; _i <= bench->n; _i++) {
+               for (_j = 1; _j <= bench->p; _j++) {
+                    _line[_j - 1]  = fd_gen_value(_i, _j);
+               }
+               fd_elt_from_double(bench->elt_type, _line, bench->p,
+                                  bench->rm.data + ((_i - 1) * bench->p * bench->elt_size));
+          }
+          free(_line);
+     }
+     else {
+          if (fd_tiled_create(&bench->tiled, bench->n, bench->p, bench->elt_type,
+                              layout == 1 ? FD_TILED_ROW_MAJOR : FD_TILED_MORTON) < 0) {
+               fprintf(stderr, "Malloc error !\n");
+               exit(1);
+          }
+          for (_i = 1; _i <= bench->n; _i++) {
+               for (_j = 1; _j <= bench->p; _j++) {
+                    fd_tiled_set_value(&bench->tiled, _i, _j, fd_gen_value(_i, _j));
+               }
+          }
+     }
+}
+
+// }}}
+// fd_bench_free_layout() {{{
+/******************************************************************************
+
+                         FD_BENCH_FREE_LAYOUT
+
+******************************************************************************/
+static void fd_bench_free_layout(fd_ref_bench bench)
+{
+     if (bench->layout == 0) {
+          free(bench->rm.data);
+     }
+     else {
+          fd_tiled_free(&bench->tiled);
+     }
+}
+
+// }}}
+// fd_bench_wrap() {{{
+/******************************************************************************
+
+                         FD_BENCH_WRAP
+
+     Keep the index of the first line or column of the viewport inside the
+     matrix. Unlike rectangle, which stops at the borders, a move beyond the
+     last position wraps around to the first one, so that the viewport keeps
+     moving.
+
+******************************************************************************/
+static int64_t fd_bench_wrap(int64_t idx, int64_t last)
+{
+     if (idx < 1) {
+          return last;
+     }
+     if (idx > last) {
+          return 1;
+     }
+     return idx;
+}
+
+// }}}
+// fd_bench_move() {{{
+/******************************************************************************
+
+                         FD_BENCH_MOVE
+
+     Run the steps moves of a command and return the checksum of the
+     values read. The elapsed time is returned in elapsed.
+
+******************************************************************************/
+static double fd_bench_move(fd_ref_bench bench, fd_ref_move move, double *elapsed)
+{
+     int64_t              _i, _j, _k, _di = 0, _dj = 0, _last_i, _last_j;
+     long                 _step;
+     double               _sum = 0.0, _ends[2];
+     char                *_line;
+     unsigned int         _seed = 1;
+     struct timespec      _t0, _t1;
+
+     _last_i        = bench->n - bench->dy + 1;
+     _last_j        = bench->p - bench->dx + 1;
+     _i             = (_last_i + 1) / 2;
+     _j             = (_last_j + 1) / 2;
+
+     switch (move->kind) {
+
+     case FD_MOVE_LINES:
+          _di            = move->mult;
+          break;
+
+     case FD_MOVE_COLS:
+          _dj            = move->mult;
+          break;
+
+     case FD_MOVE_PAGES:
+          _di            = move->mult * bench->dy;
+          break;
+
+     case FD_MOVE_TABS:
+          _dj            = move->mult * bench->dx;
+          break;
+     }
+
+     clock_gettime(CLOCK_MONOTONIC, &_t0);
+
+     for (_step = 0; _step < bench->steps; _step++) {
+          switch (move->kind) {
+
+          case FD_MOVE_GOTO_LINE:
+               _i             = (rand_r(&_seed) % _last_i) + 1;
+               break;
+
+          case FD_MOVE_GOTO_COL:
+               _j             = (rand_r(&_seed) % _last_j) + 1;
+               break;
+
+          default:
+               _i             = fd_bench_wrap(_i + _di, _last_i);
+               _j             = fd_bench_wrap(_j + _dj, _last_j);
+               break;
+          }
+
+          if (bench->layout == 0) {
+               fd_rm_fill(&bench->rm, _i, _j, bench->dy, bench->dx, bench->elts);
+          }
+          else {
+               fd_tiled_fill(&bench->tiled, _i, _j, bench->dy, bench->dx, bench->elts);
+          }
+          for (_k = 0; _k < bench->dy; _k++) {
+               _line          = bench->elts + (_k * bench->dx * bench->elt_size);
+               fd_elt_to_double(bench->elt_type, _line, 1, &_ends[0]);
+               fd_elt_to_double(bench->elt_type, _line + ((bench->dx - 1) * bench->elt_size),
+                                1, &_ends[1]);
+               _sum          += _ends[0] + _ends[1];
+          }
+     }
+
+     clock_gettime(CLOCK_MONOTONIC, &_t1);
+     *elapsed       = (_t1.tv_sec - _t0.tv_sec) + (_t1.tv_nsec - _t0.tv_nsec) / 1e9;
+
+     return _sum;
+}
+
+// }}}
+// fd_usage() {{{
+/******************************************************************************
+
+                              FD_USAGE
+
+******************************************************************************/
+void fd_usage(char *progname)
+{
+     fprintf(stderr, "Usage: %s [-n lines] [-p columns] [-y dy] [-x dx] [-s steps] [-e type]\n",
+             progname);
+     fprintf(stderr, "  -n : number of lines of the matrix (default : 8192)\n");
+     fprintf(stderr, "  -p : number of columns of the matrix (default : 8192)\n");
+     fprintf(stderr, "  -y : height of the viewport (default : 40)\n");
+     fprintf(stderr, "  -x : width of the viewport (default : 16)\n");
+     fprintf(stderr, "  -s : number of moves per command (default : 200000)\n");
+     fprintf(stderr, "  -e : type of the elements : int8, int16, int32, float32, float64\n");
+     fprintf(stderr, "       or complex128 (default : float64)\n");
+     exit(1);
+}
+
+// }}}
+// main() {{{
+/******************************************************************************
+
+                              MAIN
+
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+     int                  _opt, _layout;
+     size_t               _m;
+     fd_bench             _bench;
+     double               _elapsed[FD_NB_MOVES][FD_NB_LAYOUTS],
+                          _sums[FD_NB_MOVES][FD_NB_LAYOUTS];
+
+     _bench.n            = 8192;
+     _bench.p            = 8192;
+     _bench.dy           = 40;
+     _bench.dx           = 16;
+     _bench.steps        = 200000;
+     _bench.elt_type     = FD_ELT_FLOAT64;
+
+     while ((_opt = getopt(argc, argv, "n:p:y:x:s:e:")) != -1) {
+          switch (_opt) {
+
+          case 'n':
+               _bench.n            = atol(optarg);
+               break;
+
+          case 'p':
+               _bench.p            = atol(optarg);
+               break;
+
+          case 'y':
+               _bench.dy           = atol(optarg);
+               break;
+
+          case 'x':
+               _bench.dx           = atol(optarg);
+               break;
+
+          case 's':
+               _bench.steps        = atol(optarg);
+               break;
+
+          case 'e':
+               if ((_bench.elt_type = fd_elt_type(optarg)) == 0) {
+                    fd_usage(argv[0]);
+               }
+               break;
+
+          default:
+               fd_usage(argv[0]);
+               break;
+          }
+     }
+
+     if (optind != argc || _bench.dy < 1 || _bench.dx < 1 || _bench.steps < 1
+     ||  _bench.n < _bench.dy || _bench.p < _bench.dx) {
+          fd_usage(argv[0]);
+     }
+
+     _bench.elt_size     = fd_elt_size(_bench.elt_type);
+     if ((_bench.elts = malloc(_bench.dy * _bench.dx * _bench.elt_size)) == NULL) {
+          fprintf(stderr, "Malloc error !\n");
+          exit(1);
+     }
+
+     /* Only one layout is in memory at a time
+        ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+     for (_layout = 0; _layout < FD_NB_LAYOUTS; _layout++) {
+          fd_bench_init_layout(&_bench, _layout);
+          for (_m = 0; _m < FD_NB_MOVES; _m++) {
+               _sums[_m][_layout]  = fd_bench_move(&_bench, &fd_moves[_m],
+                                                   &_elapsed[_m][_layout]);
+          }
+          fd_bench_free_layout(&_bench);
+     }
+
+     printf("%ld x %ld matrix of %s, %ld x %ld viewport, %ld moves per command\n",
+            _bench.n, _bench.p, fd_elt_name(_bench.elt_type), _bench.dy, _bench.dx,
+            _bench.steps);
+     printf("%-12s", "ns/viewport");
+     for (_layout = 0; _layout < FD_NB_LAYOUTS; _layout++) {
+          printf(" %10s", fd_layout_names[_layout]);
+     }
+     printf("\n");
+
+     for (_m = 0; _m < FD_NB_MOVES; _m++) {
+          printf("%-12s", fd_moves[_m].name);
+          for (_layout = 0; _layout < FD_NB_LAYOUTS; _layout++) {
+               printf(" %10.1f", _elapsed[_m][_layout] * 1e9 / _bench.steps);
+          }
+          for (_layout = 1; _layout < FD_NB_LAYOUTS; _layout++) {
+               if (_sums[_m][_layout] != _sums[_m][0]) {
+                    printf("  checksum error (%s)", fd_layout_names[_layout]);
+               }
+          }
+          printf("\n");
+     }
+
+     free(_bench.elts);
+
+     return 0;
+}
+
+// }}}